@@ -5,9 +5,16 @@
 
 #pragma once
 #include <algorithm>
+#include <memory>
 #include <numeric>
+#include <tuple>
 #include <vector>
 
+#include "manavrion/segment_tree/functional.h"
+#include "manavrion/segment_tree/layout.h"
+#include "manavrion/segment_tree/mapped_segment_tree.h"
+#include "manavrion/segment_tree/storage.h"
+
 inline std::vector<int> get_numbers(size_t n) {
   std::vector<int> res(n);
   std::iota(res.begin(), res.end(), 0);
@@ -47,12 +54,14 @@ struct quad_mapper {
   quad operator()(int arg) const { return quad{arg, arg, arg, arg}; }
 };
 
-template <typename T>
-struct minimum {
-  T operator()(const T& lhs, const T& rhs) const { return std::min(lhs, rhs); }
+template <>
+struct manavrion::segment_tree::soa_fields<quad> {
+  static constexpr auto members =
+      std::make_tuple(&quad::sum, &quad::mul, &quad::min, &quad::max);
 };
 
-template <typename T>
-struct maximum {
-  T operator()(const T& lhs, const T& rhs) const { return std::max(lhs, rhs); }
-};
+// mapped_segment_tree of quad which stores every field in its own array.
+using soa_quad_segment_tree = manavrion::segment_tree::mapped_segment_tree<
+    int, quad_reducer, quad_mapper, std::allocator<int>, std::allocator<quad>,
+    manavrion::segment_tree::heap_layout,
+    manavrion::segment_tree::soa_storage>;
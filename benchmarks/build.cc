@@ -5,7 +5,16 @@
 
 #include <benchmark/benchmark.h>
 
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <string>
+
 #include "benchmark_helpers.h"
+#include "manavrion/segment_tree/checkpoint.h"
+#include "manavrion/segment_tree/compact_segment_tree.h"
+#include "manavrion/segment_tree/fenwick_tree.h"
+#include "manavrion/segment_tree/file_storage.h"
 #include "manavrion/segment_tree/mapped_segment_tree.h"
 #include "manavrion/segment_tree/naive_segment_tree.h"
 #include "manavrion/segment_tree/segment_tree.h"
@@ -19,9 +28,35 @@ static void BM_Build_Simple(benchmark::State& state) {
   for (auto _ : state) {
     st.assign(numbers.begin(), numbers.end());
   }
+  state.counters["bytes_used"] = st.bytes_used();
+}
+
+// 2^k + 1 elements is the worst case of padding to a power of two.
+BENCHMARK(BM_Build_Simple)->Range(2, 1 << 24)->Arg((1 << 24) + 1);
+
+static void BM_Build_Compact(benchmark::State& state) {
+  auto numbers = get_numbers(state.range(0));
+  compact_segment_tree<int> st;
+  st.reserve(numbers.size());
+  for (auto _ : state) {
+    st.assign(numbers.begin(), numbers.end());
+  }
+  state.counters["bytes_used"] = st.bytes_used();
+}
+
+BENCHMARK(BM_Build_Compact)->Range(2, 1 << 24)->Arg((1 << 24) + 1);
+
+static void BM_Build_Fenwick(benchmark::State& state) {
+  auto numbers = get_numbers(state.range(0));
+  fenwick_tree<int> st;
+  st.reserve(numbers.size());
+  for (auto _ : state) {
+    st.assign(numbers.begin(), numbers.end());
+  }
+  state.counters["bytes_used"] = st.bytes_used();
 }
 
-BENCHMARK(BM_Build_Simple)->Range(2, 1 << 24);
+BENCHMARK(BM_Build_Fenwick)->Range(2, 1 << 24)->Arg((1 << 24) + 1);
 
 static void BM_Build_Mapped(benchmark::State& state) {
   auto numbers = get_numbers(state.range(0));
@@ -44,3 +79,72 @@ static void BM_Build_Naive(benchmark::State& state) {
 }
 
 BENCHMARK(BM_Build_Naive)->Range(2, 1 << 24);
+
+static void BM_Build_Uniform(benchmark::State& state) {
+  segment_tree<int> st;
+  st.reserve(state.range(0));
+  for (auto _ : state) {
+    st.assign(state.range(0), 1);
+  }
+}
+
+BENCHMARK(BM_Build_Uniform)->Range(2, 1 << 24)->Arg((1 << 24) + 1);
+
+static void BM_Build_Uniform_Comb(benchmark::State& state) {
+  mapped_segment_tree<int, comb_reducer, comb_mapper> st;
+  st.reserve(state.range(0));
+  for (auto _ : state) {
+    st.assign(state.range(0), 1);
+  }
+}
+
+BENCHMARK(BM_Build_Uniform_Comb)->Range(2, 1 << 24);
+
+// Returns the path of a scratch file in $TMPDIR or /tmp.
+static std::string temp_path(const std::string& name) {
+  const char* directory = std::getenv("TMPDIR");
+  std::string path = directory && *directory ? directory : "/tmp";
+  if (path.back() != '/') {
+    path += '/';
+  }
+  return path + name;
+}
+
+#ifdef MANAVRION_SEGMENT_TREE_HAS_MMAP
+static void BM_Build_OpenFile(benchmark::State& state) {
+  auto numbers = get_numbers(state.range(0));
+  const std::string path = temp_path("segment_tree_benchmark.bin");
+  save_file(segment_tree<int>(numbers.begin(), numbers.end()), path);
+  for (auto _ : state) {
+    auto st = open_file<file_segment_tree<int>>(path);
+    benchmark::DoNotOptimize(st.query(0, st.size()));
+  }
+  std::remove(path.c_str());
+}
+
+BENCHMARK(BM_Build_OpenFile)->Range(2, 1 << 24);
+#endif
+
+// Recovery of 2^20 elements from a snapshot and a log of the given length.
+static void BM_Build_Recover(benchmark::State& state) {
+  auto numbers = get_numbers(1 << 20);
+  const std::string snapshot = temp_path("segment_tree.bin");
+  const std::string log = temp_path("segment_tree.log");
+  std::remove(snapshot.c_str());
+  {
+    checkpointed_tree<segment_tree<int>> st(
+        snapshot, log, segment_tree<int>(numbers.begin(), numbers.end()),
+        std::numeric_limits<size_t>::max());
+    for (size_t r = 0; r < static_cast<size_t>(state.range(0)); ++r) {
+      st.update(r * 7919 % numbers.size(), static_cast<int>(r));
+    }
+  }
+  for (auto _ : state) {
+    auto st = recover<segment_tree<int>>(snapshot, log);
+    benchmark::DoNotOptimize(st.query(0, st.size()));
+  }
+  std::remove(snapshot.c_str());
+  std::remove(log.c_str());
+}
+
+BENCHMARK(BM_Build_Recover)->Range(1, 1 << 22);
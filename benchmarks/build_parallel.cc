@@ -0,0 +1,44 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#include <benchmark/benchmark.h>
+
+#include "benchmark_helpers.h"
+#include "manavrion/segment_tree/mapped_segment_tree.h"
+#include "manavrion/segment_tree/segment_tree.h"
+
+using namespace manavrion::segment_tree;
+
+static void ParallelArgs(benchmark::internal::Benchmark* b) {
+  for (int n : {1 << 16, 1 << 20, 1 << 24}) {
+    for (int threads : {1, 2, 4, 8}) {
+      b->Args({n, threads});
+    }
+  }
+}
+
+static void BM_Build_Parallel(benchmark::State& state) {
+  auto numbers = get_numbers(state.range(0));
+  const parallel_build policy(state.range(1));
+  segment_tree<int> st;
+  st.reserve(numbers.size());
+  for (auto _ : state) {
+    st.assign(policy, numbers.begin(), numbers.end());
+  }
+}
+
+BENCHMARK(BM_Build_Parallel)->Apply(ParallelArgs)->UseRealTime();
+
+static void BM_Build_Parallel_Comb(benchmark::State& state) {
+  auto numbers = get_numbers(state.range(0));
+  const parallel_build policy(state.range(1));
+  mapped_segment_tree<int, comb_reducer, comb_mapper> st;
+  st.reserve(numbers.size());
+  for (auto _ : state) {
+    st.assign(policy, numbers.begin(), numbers.end());
+  }
+}
+
+BENCHMARK(BM_Build_Parallel_Comb)->Apply(ParallelArgs)->UseRealTime();
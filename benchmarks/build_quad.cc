@@ -43,6 +43,17 @@ static void BM_Build_Quad_Mapped(benchmark::State& state) {
 
 BENCHMARK(BM_Build_Quad_Mapped)->Range(2, 1 << 24);
 
+static void BM_Build_Quad_Mapped_SoA(benchmark::State& state) {
+  auto numbers = get_numbers(state.range(0));
+  soa_quad_segment_tree st;
+  st.reserve(numbers.size());
+  for (auto _ : state) {
+    st.assign(numbers.begin(), numbers.end());
+  }
+}
+
+BENCHMARK(BM_Build_Quad_Mapped_SoA)->Range(2, 1 << 24);
+
 static void BM_Build_Quad_Naive(benchmark::State& state) {
   auto numbers = get_numbers(state.range(0));
   naive_segment_tree<int, std::plus<int>> st1;
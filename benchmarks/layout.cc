@@ -0,0 +1,90 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "benchmark_helpers.h"
+#include "manavrion/segment_tree/layout.h"
+#include "manavrion/segment_tree/mapped_segment_tree.h"
+#include "manavrion/segment_tree/segment_tree.h"
+
+using namespace manavrion::segment_tree;
+
+namespace {
+
+constexpr size_t kOperationsPerIteration = 4096;
+
+std::vector<size_t> get_indexes(size_t n) {
+  std::mt19937 gen(n);
+  std::uniform_int_distribution<size_t> dist(0, n - 1);
+  std::vector<size_t> indexes(kOperationsPerIteration);
+  for (auto& index : indexes) {
+    index = dist(gen);
+  }
+  return indexes;
+}
+
+template <typename Layout>
+using simple_tree =
+    segment_tree<int, std::plus<int>, std::allocator<int>, Layout>;
+
+template <typename Layout>
+using mapped_tree =
+    mapped_segment_tree<int, std::plus<int>, details::default_mapper,
+                        std::allocator<int>, std::allocator<int>, Layout>;
+
+}  // namespace
+
+template <typename SegmentTree>
+static void BM_Layout_Update(benchmark::State& state) {
+  auto numbers = get_numbers(state.range(0));
+  SegmentTree st(numbers.begin(), numbers.end());
+  const auto indexes = get_indexes(st.size());
+  int value = 0;
+  for (auto _ : state) {
+    for (const size_t index : indexes) {
+      st.update(index, ++value);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * indexes.size());
+}
+
+template <typename SegmentTree>
+static void BM_Layout_Query(benchmark::State& state) {
+  auto numbers = get_numbers(state.range(0));
+  SegmentTree st(numbers.begin(), numbers.end());
+  const auto first_indexes = get_indexes(st.size());
+  const auto last_indexes = get_indexes(st.size() + 1);
+  for (auto _ : state) {
+    for (size_t i = 0; i < first_indexes.size(); ++i) {
+      const auto [first_index, last_index] =
+          std::minmax(first_indexes[i], last_indexes[i]);
+      benchmark::DoNotOptimize(st.query(first_index, last_index));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * first_indexes.size());
+}
+
+BENCHMARK_TEMPLATE(BM_Layout_Update, simple_tree<heap_layout>)
+    ->Range(1 << 20, 1 << 26);
+BENCHMARK_TEMPLATE(BM_Layout_Update, simple_tree<veb_layout>)
+    ->Range(1 << 20, 1 << 26);
+BENCHMARK_TEMPLATE(BM_Layout_Update, mapped_tree<heap_layout>)
+    ->Range(1 << 20, 1 << 26);
+BENCHMARK_TEMPLATE(BM_Layout_Update, mapped_tree<veb_layout>)
+    ->Range(1 << 20, 1 << 26);
+
+BENCHMARK_TEMPLATE(BM_Layout_Query, simple_tree<heap_layout>)
+    ->Range(1 << 20, 1 << 26);
+BENCHMARK_TEMPLATE(BM_Layout_Query, simple_tree<veb_layout>)
+    ->Range(1 << 20, 1 << 26);
+BENCHMARK_TEMPLATE(BM_Layout_Query, mapped_tree<heap_layout>)
+    ->Range(1 << 20, 1 << 26);
+BENCHMARK_TEMPLATE(BM_Layout_Query, mapped_tree<veb_layout>)
+    ->Range(1 << 20, 1 << 26);
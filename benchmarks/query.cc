@@ -5,10 +5,20 @@
 
 #include <benchmark/benchmark.h>
 
+#include <algorithm>
+#include <random>
+
 #include "benchmark_helpers.h"
+#include "manavrion/segment_tree/dynamic_segment_tree.h"
+#include "manavrion/segment_tree/fenwick_tree.h"
+#include "manavrion/segment_tree/fixed_segment_tree.h"
 #include "manavrion/segment_tree/mapped_segment_tree.h"
 #include "manavrion/segment_tree/naive_segment_tree.h"
+#include "manavrion/segment_tree/persistent_segment_tree.h"
 #include "manavrion/segment_tree/segment_tree.h"
+#include "manavrion/segment_tree/segment_tree_2d.h"
+#include "manavrion/segment_tree/wavelet_matrix.h"
+#include "manavrion/segment_tree/wide_segment_tree.h"
 
 using namespace manavrion::segment_tree;
 
@@ -48,6 +58,43 @@ static void BM_Query_Mapped(benchmark::State& state) {
 
 BENCHMARK(BM_Query_Mapped)->Range(2, 1 << 24);
 
+static void BM_Query_Fenwick(benchmark::State& state) {
+  auto numbers = get_numbers(state.range(0));
+  fenwick_tree<int> st;
+  st.assign(numbers.begin(), numbers.end());
+  size_t r = 0;
+  for (auto _ : state) {
+    size_t start = r % st.size();
+    if (start + st.size() / 2 >= st.size()) {
+      r = 0;
+      start = 0;
+    }
+    ++r;
+    benchmark::DoNotOptimize(st.query(start, start + st.size() / 2));
+  }
+}
+
+BENCHMARK(BM_Query_Fenwick)->Range(2, 1 << 24);
+
+static void BM_Query_Fixed(benchmark::State& state) {
+  constexpr size_t size = 4096;
+  auto numbers = get_numbers(size);
+  fixed_segment_tree<int, size> st(numbers.begin(), numbers.end());
+  size_t r = 0;
+  for (auto _ : state) {
+    size_t start = r % st.size();
+    if (start + st.size() / 2 >= st.size()) {
+      r = 0;
+      start = 0;
+    }
+    ++r;
+    benchmark::DoNotOptimize(st.query(start, start + st.size() / 2));
+  }
+}
+
+// Compare with BM_Query_Simple/4096.
+BENCHMARK(BM_Query_Fixed);
+
 static void BM_Query_Naive(benchmark::State& state) {
   auto numbers = get_numbers(state.range(0));
   naive_segment_tree<int> st;
@@ -65,3 +112,182 @@ static void BM_Query_Naive(benchmark::State& state) {
 }
 
 BENCHMARK(BM_Query_Naive)->Range(2, 1 << 24);
+
+static void BM_Query_Wide(benchmark::State& state) {
+  auto numbers = get_numbers(state.range(0));
+  wide_segment_tree<int> st;
+  st.assign(numbers.begin(), numbers.end());
+  size_t r = 0;
+  for (auto _ : state) {
+    size_t start = r % st.size();
+    if (start + st.size() / 2 >= st.size()) {
+      r = 0;
+      start = 0;
+    }
+    ++r;
+    benchmark::DoNotOptimize(st.query(start, start + st.size() / 2));
+  }
+}
+
+BENCHMARK(BM_Query_Wide)->Range(2, 1 << 24);
+
+static void BM_Query_Persistent(benchmark::State& state) {
+  auto numbers = get_numbers(state.range(0));
+  persistent_segment_tree<int> st(numbers.begin(), numbers.end());
+  for (size_t i = 0; i < 1024; ++i) {
+    st.update(i % st.size(), static_cast<int>(i));
+  }
+  size_t r = 0;
+  for (auto _ : state) {
+    size_t start = r % st.size();
+    if (start + st.size() / 2 >= st.size()) {
+      r = 0;
+      start = 0;
+    }
+    ++r;
+    benchmark::DoNotOptimize(
+        st.query(r % st.versions(), start, start + st.size() / 2));
+  }
+}
+
+BENCHMARK(BM_Query_Persistent)->Range(2, 1 << 24);
+
+static void BM_Query_Dynamic(benchmark::State& state) {
+  dynamic_segment_tree<int> st(state.range(0), 1);
+  size_t r = 0;
+  for (auto _ : state) {
+    size_t start = r % st.size();
+    if (start + st.size() / 2 >= st.size()) {
+      r = 0;
+      start = 0;
+    }
+    ++r;
+    benchmark::DoNotOptimize(st.query(start, start + st.size() / 2));
+  }
+}
+
+BENCHMARK(BM_Query_Dynamic)->Range(2, 1 << 24);
+
+static void BM_LowerBound_Simple(benchmark::State& state) {
+  const std::vector<int> ones(state.range(0), 1);
+  segment_tree<int> st(ones.begin(), ones.end());
+  size_t r = 0;
+  for (auto _ : state) {
+    const int target = static_cast<int>(r++ * 7919 % st.size()) + 1;
+    benchmark::DoNotOptimize(st.lower_bound_prefix(target));
+  }
+}
+
+BENCHMARK(BM_LowerBound_Simple)->Range(2, 1 << 24);
+
+// Binary search over query(0, i), which max_right() replaces.
+static void BM_LowerBound_BinarySearch(benchmark::State& state) {
+  const std::vector<int> ones(state.range(0), 1);
+  segment_tree<int> st(ones.begin(), ones.end());
+  size_t r = 0;
+  for (auto _ : state) {
+    const int target = static_cast<int>(r++ * 7919 % st.size()) + 1;
+    size_t first = 0;
+    size_t last = st.size();
+    while (first < last) {
+      const size_t middle = first + (last - first) / 2;
+      if (st.query(0, middle + 1) < target) {
+        first = middle + 1;
+      } else {
+        last = middle;
+      }
+    }
+    benchmark::DoNotOptimize(first);
+  }
+}
+
+BENCHMARK(BM_LowerBound_BinarySearch)->Range(2, 1 << 24);
+
+// The matrices are square, range(0) is the number of rows.
+static void BM_Query_2d(benchmark::State& state) {
+  const size_t side = state.range(0);
+  auto numbers = get_numbers(side * side);
+  segment_tree_2d<int> st(numbers.begin(), numbers.end(), side);
+  size_t r = 0;
+  for (auto _ : state) {
+    size_t start = r % side;
+    if (start + side / 2 >= side) {
+      r = 0;
+      start = 0;
+    }
+    ++r;
+    benchmark::DoNotOptimize(
+        st.query(start, start + side / 2, start, start + side / 2));
+  }
+}
+
+BENCHMARK(BM_Query_2d)->Range(2, 1 << 11);
+
+// One segment_tree per row, a rectangle takes a query in every row.
+static void BM_Query_2d_Rows(benchmark::State& state) {
+  const size_t side = state.range(0);
+  auto numbers = get_numbers(side);
+  std::vector<segment_tree<int>> rows(side);
+  for (auto& row : rows) {
+    row.assign(numbers.begin(), numbers.end());
+  }
+  size_t r = 0;
+  for (auto _ : state) {
+    size_t start = r % side;
+    if (start + side / 2 >= side) {
+      r = 0;
+      start = 0;
+    }
+    ++r;
+    int sum = 0;
+    for (size_t row = start; row < start + side / 2; ++row) {
+      sum += rows[row].query(start, start + side / 2);
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+}
+
+BENCHMARK(BM_Query_2d_Rows)->Range(2, 1 << 11);
+
+// The median of a half of the shuffled numbers.
+static void BM_Query_KthSmallest_Wavelet(benchmark::State& state) {
+  auto numbers = get_numbers(state.range(0));
+  std::shuffle(numbers.begin(), numbers.end(), std::mt19937(42));
+  wavelet_matrix<int> wm(numbers.begin(), numbers.end());
+  size_t r = 0;
+  for (auto _ : state) {
+    size_t start = r % wm.size();
+    if (start + wm.size() / 2 >= wm.size()) {
+      r = 0;
+      start = 0;
+    }
+    ++r;
+    benchmark::DoNotOptimize(
+        wm.kth_smallest(start, start + wm.size() / 2, wm.size() / 4));
+  }
+}
+
+BENCHMARK(BM_Query_KthSmallest_Wavelet)->Range(2, 1 << 24);
+
+// Copies the segment out and makes std::nth_element on it.
+static void BM_Query_KthSmallest_Sort(benchmark::State& state) {
+  auto numbers = get_numbers(state.range(0));
+  std::shuffle(numbers.begin(), numbers.end(), std::mt19937(42));
+  std::vector<int> buffer;
+  size_t r = 0;
+  for (auto _ : state) {
+    size_t start = r % numbers.size();
+    if (start + numbers.size() / 2 >= numbers.size()) {
+      r = 0;
+      start = 0;
+    }
+    ++r;
+    buffer.assign(numbers.begin() + start,
+                  numbers.begin() + start + numbers.size() / 2);
+    std::nth_element(buffer.begin(), buffer.begin() + numbers.size() / 4,
+                     buffer.end());
+    benchmark::DoNotOptimize(buffer[numbers.size() / 4]);
+  }
+}
+
+BENCHMARK(BM_Query_KthSmallest_Sort)->Range(2, 1 << 24);
@@ -0,0 +1,72 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "benchmark_helpers.h"
+#include "manavrion/segment_tree/mapped_segment_tree.h"
+#include "manavrion/segment_tree/segment_tree.h"
+
+using namespace manavrion::segment_tree;
+
+namespace {
+
+constexpr size_t kQueriesPerIteration = 4096;
+
+std::vector<std::pair<size_t, size_t>> get_queries(size_t n) {
+  std::mt19937 gen(n);
+  std::uniform_int_distribution<size_t> dist(0, n);
+  std::vector<std::pair<size_t, size_t>> queries(kQueriesPerIteration);
+  for (auto& [first_index, last_index] : queries) {
+    first_index = dist(gen);
+    last_index = dist(gen);
+    if (first_index > last_index) {
+      std::swap(first_index, last_index);
+    }
+  }
+  return queries;
+}
+
+}  // namespace
+
+template <typename SegmentTree>
+static void BM_Query_Scalar(benchmark::State& state) {
+  auto numbers = get_numbers(state.range(0));
+  SegmentTree st;
+  st.assign(numbers.begin(), numbers.end());
+  const auto queries = get_queries(st.size());
+  for (auto _ : state) {
+    for (const auto& [first_index, last_index] : queries) {
+      benchmark::DoNotOptimize(st.query(first_index, last_index));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * queries.size());
+}
+
+template <typename SegmentTree>
+static void BM_Query_Batch(benchmark::State& state) {
+  auto numbers = get_numbers(state.range(0));
+  SegmentTree st;
+  st.assign(numbers.begin(), numbers.end());
+  const auto queries = get_queries(st.size());
+  std::vector<int> results(queries.size());
+  for (auto _ : state) {
+    st.query_batch(queries.begin(), queries.end(), results.begin());
+    benchmark::DoNotOptimize(results.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * queries.size());
+}
+
+BENCHMARK_TEMPLATE(BM_Query_Scalar, segment_tree<int>)->Range(2, 1 << 24);
+BENCHMARK_TEMPLATE(BM_Query_Batch, segment_tree<int>)->Range(2, 1 << 24);
+BENCHMARK_TEMPLATE(BM_Query_Scalar, mapped_segment_tree<int>)
+    ->Range(2, 1 << 24);
+BENCHMARK_TEMPLATE(BM_Query_Batch, mapped_segment_tree<int>)
+    ->Range(2, 1 << 24);
@@ -9,6 +9,7 @@
 #include "manavrion/segment_tree/mapped_segment_tree.h"
 #include "manavrion/segment_tree/naive_segment_tree.h"
 #include "manavrion/segment_tree/segment_tree.h"
+#include "manavrion/segment_tree/sparse_table.h"
 
 using namespace manavrion::segment_tree;
 
@@ -59,6 +60,89 @@ static void BM_Query_Quad_Mapped(benchmark::State& state) {
 
 BENCHMARK(BM_Query_Quad_Mapped)->Range(2, 1 << 24);
 
+static void BM_Query_Quad_Mapped_SoA(benchmark::State& state) {
+  auto numbers = get_numbers(state.range(0));
+  soa_quad_segment_tree st;
+  st.assign(numbers.begin(), numbers.end());
+  size_t r = 0;
+  for (auto _ : state) {
+    size_t start = r % numbers.size();
+    if (start + numbers.size() / 2 >= numbers.size()) {
+      r = 0;
+      start = 0;
+    }
+    ++r;
+    auto res = st.query(start, start + st.size() / 2);
+    benchmark::DoNotOptimize(res.sum + res.mul + res.min + res.max);
+  }
+}
+
+BENCHMARK(BM_Query_Quad_Mapped_SoA)->Range(2, 1 << 24);
+
+// The tables take n log n values, so they are measured up to 2^20 elements.
+static void BM_Query_Quad_DisjointSparseTable(benchmark::State& state) {
+  auto numbers = get_numbers(state.range(0));
+  disjoint_sparse_table<int, quad_reducer, quad_mapper> st;
+  st.assign(numbers.begin(), numbers.end());
+  size_t r = 0;
+  for (auto _ : state) {
+    size_t start = r % numbers.size();
+    if (start + numbers.size() / 2 >= numbers.size()) {
+      r = 0;
+      start = 0;
+    }
+    ++r;
+    auto res = st.query(start, start + st.size() / 2);
+    benchmark::DoNotOptimize(res.sum + res.mul + res.min + res.max);
+  }
+}
+
+BENCHMARK(BM_Query_Quad_DisjointSparseTable)->Range(2, 1 << 20);
+
+static void BM_Query_MinMax_Simple(benchmark::State& state) {
+  auto numbers = get_numbers(state.range(0));
+  segment_tree<int, minimum<int>> st1;
+  segment_tree<int, maximum<int>> st2;
+  st1.assign(numbers.begin(), numbers.end());
+  st2.assign(numbers.begin(), numbers.end());
+  size_t r = 0;
+  for (auto _ : state) {
+    size_t start = r % numbers.size();
+    if (start + numbers.size() / 2 >= numbers.size()) {
+      r = 0;
+      start = 0;
+    }
+    ++r;
+    auto min = st1.query(start, start + st1.size() / 2);
+    auto max = st2.query(start, start + st1.size() / 2);
+    benchmark::DoNotOptimize(min + max);
+  }
+}
+
+BENCHMARK(BM_Query_MinMax_Simple)->Range(2, 1 << 20);
+
+static void BM_Query_MinMax_SparseTable(benchmark::State& state) {
+  auto numbers = get_numbers(state.range(0));
+  sparse_table<int, minimum<int>> st1;
+  sparse_table<int, maximum<int>> st2;
+  st1.assign(numbers.begin(), numbers.end());
+  st2.assign(numbers.begin(), numbers.end());
+  size_t r = 0;
+  for (auto _ : state) {
+    size_t start = r % numbers.size();
+    if (start + numbers.size() / 2 >= numbers.size()) {
+      r = 0;
+      start = 0;
+    }
+    ++r;
+    auto min = st1.query(start, start + st1.size() / 2);
+    auto max = st2.query(start, start + st1.size() / 2);
+    benchmark::DoNotOptimize(min + max);
+  }
+}
+
+BENCHMARK(BM_Query_MinMax_SparseTable)->Range(2, 1 << 20);
+
 static void BM_Query_Quad_Naive(benchmark::State& state) {
   auto numbers = get_numbers(state.range(0));
   naive_segment_tree<int, std::plus<int>> st1;
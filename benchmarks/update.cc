@@ -6,9 +6,16 @@
 #include <benchmark/benchmark.h>
 
 #include "benchmark_helpers.h"
+#include "manavrion/segment_tree/dynamic_segment_tree.h"
+#include "manavrion/segment_tree/fenwick_tree.h"
+#include "manavrion/segment_tree/fixed_segment_tree.h"
 #include "manavrion/segment_tree/mapped_segment_tree.h"
 #include "manavrion/segment_tree/naive_segment_tree.h"
+#include "manavrion/segment_tree/persistent_segment_tree.h"
+#include "manavrion/segment_tree/rope_segment_tree.h"
 #include "manavrion/segment_tree/segment_tree.h"
+#include "manavrion/segment_tree/segment_tree_2d.h"
+#include "manavrion/segment_tree/wide_segment_tree.h"
 
 using namespace manavrion::segment_tree;
 
@@ -38,6 +45,35 @@ static void BM_Update_Mapped(benchmark::State& state) {
 
 BENCHMARK(BM_Update_Mapped)->Range(2, 1 << 24);
 
+static void BM_Update_Fenwick(benchmark::State& state) {
+  auto numbers = get_numbers(state.range(0));
+  fenwick_tree<int> st;
+  st.assign(numbers.begin(), numbers.end());
+  size_t r = 0;
+  for (auto _ : state) {
+    size_t i = r % st.size();
+    st.update(i, r);
+  }
+}
+
+BENCHMARK(BM_Update_Fenwick)->Range(2, 1 << 24);
+
+static void BM_Update_Fixed(benchmark::State& state) {
+  constexpr size_t size = 4096;
+  auto numbers = get_numbers(size);
+  fixed_segment_tree<int, size> st(numbers.begin(), numbers.end());
+  size_t r = 0;
+  for (auto _ : state) {
+    size_t i = r % st.size();
+    st.update(i, r);
+    // The tree is never read otherwise, so the updates would be removed.
+    benchmark::DoNotOptimize(st);
+  }
+}
+
+// Compare with BM_Update_Simple/4096.
+BENCHMARK(BM_Update_Fixed);
+
 static void BM_Update_Naive(benchmark::State& state) {
   auto numbers = get_numbers(state.range(0));
   naive_segment_tree<int> st;
@@ -50,3 +86,111 @@ static void BM_Update_Naive(benchmark::State& state) {
 }
 
 BENCHMARK(BM_Update_Naive)->Range(2, 1 << 24);
+
+static void BM_Update_Wide(benchmark::State& state) {
+  auto numbers = get_numbers(state.range(0));
+  wide_segment_tree<int> st;
+  st.assign(numbers.begin(), numbers.end());
+  size_t r = 0;
+  for (auto _ : state) {
+    size_t i = r % st.size();
+    st.update(i, r);
+  }
+}
+
+BENCHMARK(BM_Update_Wide)->Range(2, 1 << 24);
+
+static void BM_Update_Persistent(benchmark::State& state) {
+  auto numbers = get_numbers(state.range(0));
+  persistent_segment_tree<int> st(numbers.begin(), numbers.end());
+  size_t r = 0;
+  for (auto _ : state) {
+    size_t i = r % st.size();
+    st.update(i, r);
+  }
+  state.counters["bytes_used"] = st.bytes_used();
+}
+
+// Every update keeps O(log n) nodes, so iterations are limited.
+BENCHMARK(BM_Update_Persistent)->Range(2, 1 << 24)->Iterations(1 << 18);
+
+static void BM_Update_Dynamic(benchmark::State& state) {
+  dynamic_segment_tree<int> st(state.range(0), 0);
+  size_t r = 0;
+  for (auto _ : state) {
+    size_t i = r % st.size();
+    st.update(i, r);
+  }
+}
+
+BENCHMARK(BM_Update_Dynamic)->Range(2, 1 << 24);
+
+static void BM_PushBack_Simple(benchmark::State& state) {
+  const size_t n = state.range(0);
+  segment_tree<int> st;
+  st.reserve(n);
+  size_t r = 0;
+  for (auto _ : state) {
+    if (st.size() == n) {
+      st.clear();
+    }
+    st.push_back(r++);
+  }
+}
+
+BENCHMARK(BM_PushBack_Simple)->Range(2, 1 << 24);
+
+static void BM_PushBack_Mapped(benchmark::State& state) {
+  const size_t n = state.range(0);
+  mapped_segment_tree<int> st;
+  st.reserve(n);
+  size_t r = 0;
+  for (auto _ : state) {
+    if (st.size() == n) {
+      st.clear();
+    }
+    st.push_back(r++);
+  }
+}
+
+BENCHMARK(BM_PushBack_Mapped)->Range(2, 1 << 24);
+
+static void BM_InsertErase_Rope(benchmark::State& state) {
+  auto numbers = get_numbers(state.range(0));
+  rope_segment_tree<int> st(numbers.begin(), numbers.end());
+  size_t r = 0;
+  for (auto _ : state) {
+    size_t i = r % st.size();
+    st.insert(i, r++);
+    st.erase(st.size() / 2);
+  }
+}
+
+BENCHMARK(BM_InsertErase_Rope)->Range(2, 1 << 24);
+
+static void BM_InsertErase_Naive(benchmark::State& state) {
+  auto numbers = get_numbers(state.range(0));
+  naive_segment_tree<int> st(numbers.begin(), numbers.end());
+  size_t r = 0;
+  for (auto _ : state) {
+    size_t i = r % st.size();
+    st.insert(st.begin() + i, r++);
+    st.erase(st.begin() + st.size() / 2);
+  }
+}
+
+BENCHMARK(BM_InsertErase_Naive)->Range(2, 1 << 24);
+
+// The matrix is square, range(0) is the number of rows.
+static void BM_Update_2d(benchmark::State& state) {
+  const size_t side = state.range(0);
+  auto numbers = get_numbers(side * side);
+  segment_tree_2d<int> st(numbers.begin(), numbers.end(), side);
+  size_t r = 0;
+  for (auto _ : state) {
+    st.update(r % side, (r / side) % side, r);
+    ++r;
+  }
+}
+
+BENCHMARK(BM_Update_2d)->Range(2, 1 << 11);
@@ -0,0 +1,48 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#include <benchmark/benchmark.h>
+
+#include <mutex>
+
+#include "benchmark_helpers.h"
+#include "manavrion/segment_tree/atomic_segment_tree.h"
+#include "manavrion/segment_tree/segment_tree.h"
+
+using namespace manavrion::segment_tree;
+
+namespace {
+
+constexpr size_t kSize = 1 << 20;
+
+}  // namespace
+
+// Threads share one tree and increment elements at the same time.
+static void BM_Update_Atomic(benchmark::State& state) {
+  static atomic_segment_tree<int> st(kSize);
+  size_t r = state.thread_index() * 7919;
+  for (auto _ : state) {
+    st.add(r++ % kSize, 1);
+  }
+}
+
+BENCHMARK(BM_Update_Atomic)->ThreadRange(1, 8)->UseRealTime();
+
+static void BM_Update_Mutex(benchmark::State& state) {
+  static std::mutex mutex;
+  static segment_tree<int> st = [] {
+    segment_tree<int> result;
+    result.assign(kSize, 0);
+    return result;
+  }();
+  size_t r = state.thread_index() * 7919;
+  for (auto _ : state) {
+    const size_t i = r++ % kSize;
+    const std::lock_guard<std::mutex> lock(mutex);
+    st.update(i, st[i] + 1);
+  }
+}
+
+BENCHMARK(BM_Update_Mutex)->ThreadRange(1, 8)->UseRealTime();
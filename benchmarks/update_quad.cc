@@ -47,6 +47,19 @@ static void BM_Update_Quad_Mapped(benchmark::State& state) {
 
 BENCHMARK(BM_Update_Quad_Mapped)->Range(2, 1 << 24);
 
+static void BM_Update_Quad_Mapped_SoA(benchmark::State& state) {
+  auto numbers = get_numbers(state.range(0));
+  soa_quad_segment_tree st;
+  st.assign(numbers.begin(), numbers.end());
+  size_t r = 0;
+  for (auto _ : state) {
+    size_t i = r % numbers.size();
+    st.update(i, r);
+  }
+}
+
+BENCHMARK(BM_Update_Quad_Mapped_SoA)->Range(2, 1 << 24);
+
 static void BM_Update_Quad_Naive(benchmark::State& state) {
   auto numbers = get_numbers(state.range(0));
   naive_segment_tree<int, std::plus<int>> st1;
@@ -0,0 +1,186 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#pragma once
+#include <atomic>
+#include <cassert>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "manavrion/segment_tree/details.h"
+
+namespace manavrion::segment_tree {
+
+// Lock-free sum segment tree over integers for concurrent point updates.
+//
+// The nodes are std::atomic<T> in the 2n layout of compact_segment_tree: the
+// elements are stored at [n, 2n) and the node i is the parent of 2i and
+// 2i + 1. Since the sum is commutative and invertible, a point update is
+// a fetch_add of the delta on the element and on each of its O(log n)
+// ancestors, so threads never wait for each other.
+//
+// All the operations use relaxed atomics. A query made concurrently with
+// updates sums O(log n) disjoint nodes which are read at different moments,
+// so each concurrent update is either counted fully or not counted at all,
+// and updates which were finished before the query started are always
+// counted. Relaxed atomics do not order updates of different elements made
+// by different threads, so a query may count an update and miss another one
+// which was finished before it.
+template <typename T>
+class atomic_segment_tree {
+  static_assert(std::is_integral_v<T>);
+
+ public:
+  using value_type = T;
+  using size_type = size_t;
+  using difference_type = std::ptrdiff_t;
+
+ private:
+  size_t parent(size_t node_index) const {
+    assert(node_index > 1);
+    return node_index / 2;
+  }
+
+  size_t left_child(size_t node_index) const { return node_index * 2; }
+
+  template <typename InputIt>
+  void init_tree(InputIt first, InputIt last) {
+    const size_t n = size();
+    for (size_t i = n; first != last; ++first, ++i) {
+      tree_[i].store(*first, std::memory_order_relaxed);
+    }
+    for (size_t i = n; i-- > 1;) {
+      const size_t child = left_child(i);
+      tree_[i].store(tree_[child].load(std::memory_order_relaxed) +
+                         tree_[child + 1].load(std::memory_order_relaxed),
+                     std::memory_order_relaxed);
+    }
+  }
+
+  // Adds delta to ancestors of the element.
+  // Time complexity - O(log n).
+  void add_ancestors(size_t i, T delta) {
+    for (i += size(); i > 1;) {
+      i = parent(i);
+      tree_[i].fetch_add(delta, std::memory_order_relaxed);
+    }
+  }
+
+ public:
+  atomic_segment_tree() = default;
+
+  // Creates the tree of n zeros.
+  // Time complexity - O(n).
+  explicit atomic_segment_tree(size_type n) : tree_(2 * n) {}
+
+  // Time complexity - O(n).
+  template <typename InputIt, typename = details::require_input_iter<InputIt>>
+  atomic_segment_tree(InputIt first, InputIt last)
+      : tree_(2 * std::distance(first, last)) {
+    init_tree(first, last);
+  }
+
+  // Time complexity - O(n).
+  atomic_segment_tree(std::initializer_list<T> init_list)
+      : tree_(2 * init_list.size()) {
+    init_tree(init_list.begin(), init_list.end());
+  }
+
+  // The tree must not be updated while it is copied.
+  // Time complexity - O(n).
+  atomic_segment_tree(const atomic_segment_tree& other)
+      : tree_(other.tree_.size()) {
+    for (size_t i = 0; i < tree_.size(); ++i) {
+      tree_[i].store(other.tree_[i].load(std::memory_order_relaxed),
+                     std::memory_order_relaxed);
+    }
+  }
+
+  atomic_segment_tree(atomic_segment_tree&& other) noexcept = default;
+
+  // Time complexity - O(n).
+  atomic_segment_tree& operator=(const atomic_segment_tree& other) {
+    if (this != &other) {
+      *this = atomic_segment_tree(other);
+    }
+    return *this;
+  }
+
+  atomic_segment_tree& operator=(atomic_segment_tree&& other) noexcept =
+      default;
+
+  // Time complexity - O(1).
+  [[nodiscard]] T at(size_type pos) const {
+    if (pos >= size()) {
+      throw std::out_of_range("atomic_segment_tree::at");
+    }
+    return operator[](pos);
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] T operator[](size_type pos) const {
+    assert(pos < size());
+    return tree_[pos + size()].load(std::memory_order_relaxed);
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] bool empty() const noexcept { return tree_.empty(); }
+
+  // Time complexity - O(1).
+  [[nodiscard]] size_type size() const noexcept { return tree_.size() / 2; }
+
+  // Adds delta to the element, it is safe to call concurrently.
+  // Time complexity - O(log n).
+  void add(size_t index, T delta) {
+    assert(index < size());
+    tree_[index + size()].fetch_add(delta, std::memory_order_relaxed);
+    add_ancestors(index, delta);
+  }
+
+  // Replaces the element, it is safe to call concurrently. Ancestors get the
+  // difference with the replaced value, so concurrent updates of the same
+  // element leave the tree consistent. The difference is taken modulo 2^N,
+  // as fetch_add wraps around, so it does not overflow for signed T.
+  // Time complexity - O(log n).
+  void update(size_t index, T value) {
+    assert(index < size());
+    const T old_value =
+        tree_[index + size()].exchange(value, std::memory_order_relaxed);
+    using unsigned_type = std::make_unsigned_t<T>;
+    add_ancestors(index, static_cast<T>(static_cast<unsigned_type>(value) -
+                                        static_cast<unsigned_type>(old_value)));
+  }
+
+  // Make a query on [first_index, last_index) segment, it is safe to call
+  // concurrently with updates.
+  // Time complexity - O(log n).
+  [[nodiscard]] T query(size_t first_index, size_t last_index) const {
+    assert(first_index <= last_index);
+    assert(last_index <= size());
+
+    T result = 0;
+    size_t first = first_index + size();
+    size_t last = last_index + size();
+    while (first < last) {
+      if (first % 2 != 0) {
+        result += tree_[first++].load(std::memory_order_relaxed);
+      }
+      if (last % 2 != 0) {
+        result += tree_[--last].load(std::memory_order_relaxed);
+      }
+      first /= 2;
+      last /= 2;
+    }
+    return result;
+  }
+
+ private:
+  std::vector<std::atomic<T>> tree_;
+};
+
+}  // namespace manavrion::segment_tree
@@ -0,0 +1,319 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#pragma once
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "manavrion/segment_tree/details.h"
+#include "manavrion/segment_tree/file_storage.h"
+
+namespace manavrion::segment_tree {
+
+// A tree is kept recoverable as a snapshot written by save_file() and an
+// append-only log of the updates made after the snapshot. An entry of the log
+// is the index as uint64_t followed by the bytes of the value, so a log which
+// was cut in the middle of an entry is read up to the last whole entry.
+// Entries are absolute writes, so replaying a log over a newer snapshot gives
+// the same tree.
+//
+// The log is written ahead: an entry is written before the tree is updated,
+// and it survives a crash of the process once flush() returns and a power
+// loss once sync() returns. A snapshot is synced to the disk before the log
+// is cleared.
+
+inline constexpr uint32_t log_format_version = 1;
+
+namespace details {
+
+inline constexpr char log_magic[8] = {'S', 'E', 'G', 'D', 'E', 'L', 'T', 'A'};
+
+struct log_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t value_size;
+  uint64_t value_tag;
+};
+
+template <typename T>
+log_header make_log_header() {
+  static_assert(std::is_trivially_copyable_v<T>);
+  log_header header{};
+  std::memcpy(header.magic, log_magic, sizeof(header.magic));
+  header.version = log_format_version;
+  header.value_size = sizeof(T);
+  header.value_tag = type_tag<T>();
+  return header;
+}
+
+// Reads the whole entries of the log, the indexes must be less than size. A
+// missing log has no entries.
+// Time complexity - O(k) where k is the number of entries.
+template <typename T>
+std::vector<std::pair<size_t, T>> read_log(const std::string& path,
+                                           size_t size) {
+  std::vector<std::pair<size_t, T>> entries;
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    return entries;
+  }
+  in.seekg(0, std::ios::end);
+  std::vector<char> bytes(static_cast<size_t>(in.tellg()));
+  in.seekg(0);
+  in.read(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+  const log_header expected = make_log_header<T>();
+  if (bytes.size() < sizeof(log_header)) {
+    return entries;
+  }
+  if (std::memcmp(bytes.data(), &expected, sizeof(log_header)) != 0) {
+    throw std::runtime_error("segment_tree: log has values of other type");
+  }
+
+  constexpr size_t entry_size = sizeof(uint64_t) + sizeof(T);
+  const size_t count = (bytes.size() - sizeof(log_header)) / entry_size;
+  entries.reserve(count);
+  const char* entry = bytes.data() + sizeof(log_header);
+  for (size_t i = 0; i < count; ++i, entry += entry_size) {
+    uint64_t index;
+    T value;
+    std::memcpy(&index, entry, sizeof(index));
+    std::memcpy(&value, entry + sizeof(index), sizeof(T));
+    if (index >= size) {
+      throw std::runtime_error("segment_tree: log is corrupted");
+    }
+    entries.emplace_back(static_cast<size_t>(index), value);
+  }
+  return entries;
+}
+
+// Writes the file or the directory at path to the disk. Where POSIX is not
+// available, the data is left to the operating system.
+inline void sync_path(const std::string& path) {
+#ifdef MANAVRION_SEGMENT_TREE_HAS_MMAP
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::system_error(errno, std::generic_category(), "open");
+  }
+  const int result = ::fsync(fd);
+  const int error = errno;
+  ::close(fd);
+  if (result != 0) {
+    throw std::system_error(error, std::generic_category(), "fsync");
+  }
+#else
+  (void)path;
+#endif
+}
+
+// Cuts the file at path to size bytes. Where POSIX is not available, the
+// first size bytes are read and the file is rewritten.
+inline void truncate_file(const std::string& path, size_t size) {
+#ifdef MANAVRION_SEGMENT_TREE_HAS_MMAP
+  if (::truncate(path.c_str(), static_cast<off_t>(size)) != 0) {
+    throw std::system_error(errno, std::generic_category(), "truncate");
+  }
+#else
+  std::vector<char> bytes(size);
+  std::ifstream in(path, std::ios::binary);
+  in.read(bytes.data(), static_cast<std::streamsize>(size));
+  if (!in) {
+    throw std::runtime_error("segment_tree: cannot read " + path);
+  }
+  in.close();
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(bytes.data(), static_cast<std::streamsize>(size));
+  if (!out) {
+    throw std::runtime_error("segment_tree: cannot write " + path);
+  }
+#endif
+}
+
+// Returns the directory of the file at path, "." for a relative file name.
+inline std::string parent_directory(const std::string& path) {
+  const size_t slash = path.find_last_of("/\\");
+  if (slash == std::string::npos) {
+    return ".";
+  }
+  return slash == 0 ? path.substr(0, 1) : path.substr(0, slash);
+}
+
+// Applies the entries to the tree. A few entries are applied by
+// update_batch(), which recomputes every affected node once. Otherwise all
+// the elements are written first and the tree is rebuilt in one pass.
+// Time complexity - O(k + min(n, k log n)) where k is the number of entries.
+template <typename Tree, typename T>
+void apply_log(Tree& tree, const std::vector<std::pair<size_t, T>>& entries) {
+  if (entries.empty()) {
+    return;
+  }
+  if (entries.size() * (floor_log2(tree.size()) + 1) < tree.size()) {
+    tree.update_batch(entries.begin(), entries.end());
+    return;
+  }
+  const auto elements = tree.begin();
+  for (const auto& [index, value] : entries) {
+    elements[index] = value;
+  }
+  tree.update_range(tree.cbegin(), tree.cend());
+}
+
+}  // namespace details
+
+// Applies the updates of the log to the tree.
+// Time complexity - O(k + min(n, k log n)) where k is the number of entries.
+template <typename Tree>
+void replay_log(Tree& tree, const std::string& log_path) {
+  using value_type = typename Tree::value_type;
+  details::apply_log(
+      tree, details::read_log<value_type>(log_path, tree.size()));
+}
+
+// Loads the snapshot and replays the log over it.
+// Time complexity - O(n + k) where k is the number of entries.
+template <typename Tree>
+[[nodiscard]] Tree recover(const std::string& snapshot_path,
+                           const std::string& log_path) {
+  Tree tree = load_file<Tree>(snapshot_path);
+  replay_log(tree, log_path);
+  return tree;
+}
+
+// segment_tree or mapped_segment_tree which logs its updates and writes a
+// snapshot every checkpoint_interval updates.
+template <typename Tree>
+class checkpointed_tree {
+ public:
+  using tree_type = Tree;
+  using value_type = typename Tree::value_type;
+
+  static constexpr size_t default_checkpoint_interval = size_t{1} << 20;
+
+  // Recovers the tree from the snapshot and the log if the snapshot exists,
+  // otherwise starts from the given tree and writes its snapshot.
+  checkpointed_tree(std::string snapshot_path, std::string log_path,
+                    Tree tree = {},
+                    size_t checkpoint_interval = default_checkpoint_interval)
+      : snapshot_path_(std::move(snapshot_path)),
+        log_path_(std::move(log_path)),
+        checkpoint_interval_(checkpoint_interval) {
+    if (!std::ifstream(snapshot_path_).is_open()) {
+      tree_ = std::move(tree);
+      checkpoint();
+      return;
+    }
+    tree_ = load_file<Tree>(snapshot_path_);
+    const auto entries =
+        details::read_log<value_type>(log_path_, tree_.size());
+    if (entries.empty()) {
+      start_log();
+      return;
+    }
+    details::apply_log(tree_, entries);
+    log_size_ = entries.size();
+    // A partially written entry is cut, so the next entries are aligned.
+    details::truncate_file(log_path_, sizeof(details::log_header) +
+                                          log_size_ * entry_size);
+    log_.open(log_path_, std::ios::binary | std::ios::app);
+    check_log();
+  }
+
+  checkpointed_tree(const checkpointed_tree&) = delete;
+  checkpointed_tree& operator=(const checkpointed_tree&) = delete;
+
+  // Time complexity - O(1).
+  [[nodiscard]] const Tree& tree() const noexcept { return tree_; }
+
+  // Returns the number of updates after the last snapshot.
+  // Time complexity - O(1).
+  [[nodiscard]] size_t log_size() const noexcept { return log_size_; }
+
+  // Throws std::out_of_range before anything is logged if index is not less
+  // than the size of the tree.
+  // Time complexity - O(log n) amortized.
+  template <typename V>
+  void update(size_t index, V&& v) {
+    if (index >= tree_.size()) {
+      throw std::out_of_range("segment_tree: update index is out of range");
+    }
+    const value_type value(std::forward<V>(v));
+    const uint64_t logged_index = index;
+    log_.write(reinterpret_cast<const char*>(&logged_index),
+               sizeof(logged_index));
+    log_.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    check_log();
+    tree_.update(index, value);
+    if (++log_size_ >= checkpoint_interval_) {
+      checkpoint();
+    }
+  }
+
+  // Passes the buffered entries of the log to the operating system.
+  void flush() {
+    log_.flush();
+    check_log();
+  }
+
+  // Writes the entries of the log to the disk.
+  void sync() {
+    flush();
+    details::sync_path(log_path_);
+  }
+
+  // Writes the snapshot and starts a new log. The snapshot is written to a
+  // temporary file, which is synced and replaces the previous snapshot, and
+  // the log is cleared only after the rename is synced too.
+  // Time complexity - O(n).
+  void checkpoint() {
+    const std::string temporary_path = snapshot_path_ + ".tmp";
+    save_file(tree_, temporary_path);
+    details::sync_path(temporary_path);
+#ifndef MANAVRION_SEGMENT_TREE_HAS_MMAP
+    // std::rename does not replace an existing file on Windows.
+    std::remove(snapshot_path_.c_str());
+#endif
+    if (std::rename(temporary_path.c_str(), snapshot_path_.c_str()) != 0) {
+      throw std::system_error(errno, std::generic_category(), "rename");
+    }
+    details::sync_path(details::parent_directory(snapshot_path_));
+    start_log();
+  }
+
+ private:
+  static constexpr size_t entry_size = sizeof(uint64_t) + sizeof(value_type);
+
+  void start_log() {
+    log_.close();
+    log_.open(log_path_, std::ios::binary | std::ios::trunc);
+    const details::log_header header = details::make_log_header<value_type>();
+    log_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    log_.flush();
+    check_log();
+    log_size_ = 0;
+  }
+
+  void check_log() const {
+    if (!log_) {
+      throw std::runtime_error("segment_tree: cannot write " + log_path_);
+    }
+  }
+
+  Tree tree_;
+  std::string snapshot_path_;
+  std::string log_path_;
+  std::ofstream log_;
+  size_t log_size_ = 0;
+  size_t checkpoint_interval_;
+};
+
+}  // namespace manavrion::segment_tree
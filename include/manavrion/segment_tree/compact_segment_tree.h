@@ -0,0 +1,372 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "manavrion/segment_tree/details.h"
+#include "manavrion/segment_tree/simd.h"
+
+namespace manavrion::segment_tree {
+
+// Segment tree of 2n nodes without padding to a power of two.
+//
+// The elements are stored at [n, 2n) and the node i is the parent of 2i and
+// 2i + 1, the node 0 is not used. If n is not a power of two, some nodes
+// reduce elements of both ends of the sequence, queries never use them. The
+// tree takes 2n values where segment_tree takes up to 3n.
+template <typename T, typename Reducer = std::plus<T>,
+          typename Allocator = std::allocator<T>>
+class compact_segment_tree : private Reducer {
+ public:
+  using allocator_type = Allocator;
+  using value_type = T;
+  using container_type = std::vector<value_type, allocator_type>;
+  using size_type = typename container_type::size_type;
+  using difference_type = typename container_type::difference_type;
+  using reference = typename container_type::reference;
+  using const_reference = typename container_type::const_reference;
+  using pointer = typename container_type::pointer;
+  using const_pointer = typename container_type::const_pointer;
+  using iterator = typename container_type::iterator;
+  using const_iterator = typename container_type::const_iterator;
+  using reverse_iterator = typename container_type::reverse_iterator;
+  using const_reverse_iterator =
+      typename container_type::const_reverse_iterator;
+
+  using reducer_type = Reducer;
+
+ private:
+  const Reducer& reducer() const& { return *static_cast<const Reducer*>(this); }
+  Reducer&& reducer() && { return std::move(*static_cast<Reducer*>(this)); }
+
+  size_t parent(size_t node_index) const {
+    assert(node_index > 1);
+    return node_index / 2;
+  }
+
+  size_t left_child(size_t node_index) const { return node_index * 2; }
+
+  void init_tree_impl(size_t n) {
+    tree_.clear();
+    tree_.resize(2 * n);
+  }
+
+  template <typename InputIt>
+  void init_tree(InputIt first, InputIt last) {
+    const size_t n = std::distance(first, last);
+    init_tree_impl(n);
+    std::copy(first, last, std::next(tree_.begin(), n));
+  }
+
+  void init_tree(size_t n, const T& value) {
+    init_tree_impl(n);
+    std::fill(std::next(tree_.begin(), n), tree_.end(), value);
+  }
+
+  // Creates segment tree nodes, time complexity - O(n).
+  void build_tree() {
+    const auto& reduce = reducer();
+
+    // Children of [first, last) are not less than last if 2 * first >= last,
+    // so such nodes are computed at once.
+    for (size_t last = size(); last > 1;) {
+      const size_t first = (last + 1) / 2;
+      details::reduce_pairs(tree_.data() + left_child(first),
+                            tree_.data() + first, last - first, reduce);
+      last = first;
+    }
+  }
+
+  // Recomputes the node from its children.
+  // Time complexity - O(1).
+  void update_node(size_t i) {
+    const size_t child = left_child(i);
+    tree_[i] = reducer()(tree_[child], tree_[child + 1]);
+  }
+
+  // Updates unique element.
+  // Time complexity - O(log n).
+  void update(size_t i) {
+    for (i += size(); i > 1;) {
+      i = parent(i);
+      update_node(i);
+    }
+  }
+
+  // Recomputes ancestors of [first_index, last_index) elements.
+  // Time complexity - O(k + log n) where k is (last_index - first_index).
+  void update_range(size_t first_index, size_t last_index) {
+    assert(first_index <= last_index);
+    assert(last_index <= size());
+    if (first_index == last_index) {
+      return;
+    }
+    size_t first = first_index + size();
+    size_t last = last_index - 1 + size();
+    while (first > 1) {
+      first = parent(first);
+      last = parent(last);
+      for (size_t i = first; i <= last; ++i) {
+        update_node(i);
+      }
+    }
+  }
+
+  // Make a query on [first_index, last_index) segment.
+  // Time complexity - O(log n).
+  T query_impl(size_t first_index, size_t last_index) const {
+    assert(first_index <= last_index);
+    assert(last_index <= size());
+
+    details::segment_accumulator<T, Reducer> result(reducer());
+
+    // Both nodes exist while first < last, so they are taken without
+    // branches.
+    size_t first = first_index + size();
+    size_t last = last_index + size();
+    while (first < last) {
+      const bool take_first = first % 2 != 0;
+      result.add_left_if(take_first, tree_[first]);
+      first += take_first;
+      const bool take_last = last % 2 != 0;
+      result.add_right_if(take_last, tree_[last - 1]);
+      last -= take_last;
+      first /= 2;
+      last /= 2;
+    }
+
+    return std::move(result).result();
+  }
+
+ public:
+  compact_segment_tree() = default;
+
+  explicit compact_segment_tree(const Allocator& allocator)
+      : tree_(allocator) {}
+
+  explicit compact_segment_tree(Reducer reducer,
+                                const Allocator& allocator = {})
+      : Reducer(std::move(reducer)), tree_(allocator) {}
+
+  // Time complexity - O(n).
+  template <typename InputIt, typename = details::require_input_iter<InputIt>>
+  compact_segment_tree(InputIt first, InputIt last, Reducer reducer = {},
+                       const Allocator& allocator = {})
+      : Reducer(std::move(reducer)), tree_(allocator) {
+    init_tree(first, last);
+    build_tree();
+  }
+
+  // Time complexity - O(n).
+  template <typename InputIt, typename = details::require_input_iter<InputIt>>
+  compact_segment_tree(InputIt first, InputIt last, const Allocator& allocator)
+      : tree_(allocator) {
+    init_tree(first, last);
+    build_tree();
+  }
+
+  // Time complexity - O(n).
+  compact_segment_tree(std::initializer_list<T> init_list,
+                       Reducer reducer = {}, const Allocator& allocator = {})
+      : Reducer(std::move(reducer)), tree_(allocator) {
+    init_tree(init_list.begin(), init_list.end());
+    build_tree();
+  }
+
+  // Time complexity - O(n).
+  compact_segment_tree(std::initializer_list<T> init_list,
+                       const Allocator& allocator)
+      : tree_(allocator) {
+    init_tree(init_list.begin(), init_list.end());
+    build_tree();
+  }
+
+  // Time complexity - O(n).
+  compact_segment_tree(const compact_segment_tree& other) = default;
+  compact_segment_tree(compact_segment_tree&& other) noexcept = default;
+
+  // Time complexity - O(n).
+  compact_segment_tree& operator=(const compact_segment_tree& other) = default;
+  compact_segment_tree& operator=(compact_segment_tree&& other) = default;
+
+  // Time complexity - O(n).
+  compact_segment_tree& operator=(std::initializer_list<T> init_list) {
+    init_tree(init_list.begin(), init_list.end());
+    build_tree();
+    return *this;
+  }
+
+  // Time complexity - O(n).
+  void assign(size_type count, const T& value) {
+    init_tree(count, value);
+    build_tree();
+  }
+
+  // Time complexity - O(n).
+  template <class InputIt, typename = details::require_input_iter<InputIt>>
+  void assign(InputIt first, InputIt last) {
+    init_tree(first, last);
+    build_tree();
+  }
+
+  // Time complexity - O(n).
+  void assign(std::initializer_list<T> init_list) { operator=(init_list); }
+
+  // Time complexity - O(1).
+  [[nodiscard]] allocator_type get_allocator() const noexcept {
+    return tree_.get_allocator();
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_reference at(size_type pos) const {
+    if (pos >= size()) {
+      throw std::out_of_range("compact_segment_tree::at");
+    }
+    return tree_[pos + size()];
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_reference operator[](size_type pos) const {
+    assert(pos < size());
+    return tree_[pos + size()];
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_reference front() const { return tree_[size()]; }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_reference back() const { return tree_.back(); }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const T* data() const noexcept {
+    return tree_.data() + size();
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] iterator begin() noexcept { return tree_.begin() + size(); }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_iterator begin() const noexcept {
+    return tree_.begin() + size();
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_iterator cbegin() const noexcept {
+    return tree_.cbegin() + size();
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] iterator end() noexcept { return tree_.end(); }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_iterator end() const noexcept { return tree_.end(); }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_iterator cend() const noexcept { return tree_.cend(); }
+
+  // Time complexity - O(1).
+  [[nodiscard]] reverse_iterator rbegin() noexcept { return tree_.rbegin(); }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_reverse_iterator rbegin() const noexcept {
+    return tree_.rbegin();
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_reverse_iterator crbegin() const noexcept {
+    return tree_.crbegin();
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] reverse_iterator rend() noexcept {
+    return tree_.rend() - size();
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_reverse_iterator rend() const noexcept {
+    return tree_.rend() - size();
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_reverse_iterator crend() const noexcept {
+    return tree_.crend() - size();
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] bool empty() const noexcept { return tree_.empty(); }
+
+  // Time complexity - O(1).
+  [[nodiscard]] size_type size() const noexcept { return tree_.size() / 2; }
+
+  // Time complexity - O(1).
+  [[nodiscard]] size_type max_size() const noexcept {
+    return tree_.max_size() / 2;
+  }
+
+  // Returns the number of bytes allocated for the elements and the nodes.
+  // Time complexity - O(1).
+  [[nodiscard]] size_t bytes_used() const noexcept {
+    return tree_.capacity() * sizeof(T);
+  }
+
+  // Time complexity - O(n).
+  void clear() noexcept { tree_.clear(); }
+
+  void reserve(size_type size) { tree_.reserve(2 * size); }
+
+  // Time complexity - O(1).
+  void swap(compact_segment_tree& other) noexcept {
+    auto tmp = std::move(other);
+    other = std::move(*this);
+    *this = std::move(tmp);
+  }
+
+  // Time complexity - O(log n).
+  template <typename V>
+  void update(size_t index, V&& v) {
+    assert(index < size());
+    tree_[index + size()] = std::forward<V>(v);
+    update(index);
+  }
+
+  // Make a query on [first_index, last_index) segment.
+  // Time complexity - O(log n).
+  [[nodiscard]] T query(size_t first_index, size_t last_index) const {
+    return query_impl(first_index, last_index);
+  }
+
+  // Time complexity - O(k + log n) where k is std::distance(first, last).
+  void update_range(const_iterator first, const_iterator last) {
+    update_range(std::distance(cbegin(), first), std::distance(cbegin(), last));
+  }
+
+  template <typename T1, typename T2, typename R, typename A>
+  friend bool operator==(const compact_segment_tree<T1, R, A>& lhs,
+                         const compact_segment_tree<T2, R, A>& rhs);
+
+ private:
+  std::vector<T, Allocator> tree_;
+};
+
+template <typename T1, typename T2, typename R, typename A>
+bool operator==(const compact_segment_tree<T1, R, A>& lhs,
+                const compact_segment_tree<T2, R, A>& rhs) {
+  return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+}
+
+template <typename T1, typename T2, typename R, typename A>
+bool operator!=(const compact_segment_tree<T1, R, A>& lhs,
+                const compact_segment_tree<T2, R, A>& rhs) {
+  return !(lhs == rhs);
+}
+
+}  // namespace manavrion::segment_tree
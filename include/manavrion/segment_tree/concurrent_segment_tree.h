@@ -0,0 +1,211 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#pragma once
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "manavrion/segment_tree/details.h"
+
+namespace manavrion::segment_tree {
+
+// Segment tree for a single writer and many readers.
+//
+// The tree keeps two versions of SegmentTree, which is segment_tree or
+// mapped_segment_tree. Readers query the published version without locks,
+// every read is wait-free and sees a consistent version. The writer buffers
+// updates and applies them to the other version by update_batch() in
+// publish(), then publishes it with a single atomic store.
+//
+// Readers announce the epoch they started in, so before the writer reuses the
+// version which was published earlier, it waits until the readers which could
+// still see that version are finished. Updates are applied to each version
+// once, so a publication costs O(k log n) where k is the number of updates
+// since the previous publication, and there are no full copies of the tree.
+template <typename SegmentTree>
+class concurrent_segment_tree {
+ public:
+  using tree_type = SegmentTree;
+  using value_type = typename SegmentTree::value_type;
+  using size_type = typename SegmentTree::size_type;
+
+ private:
+  static constexpr uint64_t idle_epoch = std::numeric_limits<uint64_t>::max();
+
+  static constexpr size_t default_max_readers = 64;
+
+  struct alignas(details::cache_line_size) reader_slot {
+    std::atomic<uint64_t> epoch{idle_epoch};
+    std::atomic<bool> used{false};
+  };
+
+  // Waits until no reader started before the current epoch.
+  // Time complexity - O(r) where r is the number of reader slots, if readers
+  // are not blocked.
+  void synchronize() const {
+    const uint64_t epoch = epoch_.load(std::memory_order_seq_cst);
+    for (size_t i = 0; i < max_readers_; ++i) {
+      while (slots_[i].epoch.load(std::memory_order_seq_cst) < epoch) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+ public:
+  // Reader handle, it owns a reader slot and must be used by one thread at a
+  // time.
+  class reader {
+   public:
+    reader(reader&& other) noexcept
+        : tree_(std::exchange(other.tree_, nullptr)), slot_(other.slot_) {}
+
+    reader& operator=(reader&& other) noexcept {
+      if (this != &other) {
+        release();
+        tree_ = std::exchange(other.tree_, nullptr);
+        slot_ = other.slot_;
+      }
+      return *this;
+    }
+
+    reader(const reader&) = delete;
+    reader& operator=(const reader&) = delete;
+
+    ~reader() { release(); }
+
+    // Calls f with the published version of the tree, the version is not
+    // changed while f is running.
+    // Time complexity - O(1) plus f.
+    template <typename F>
+    decltype(auto) read(F&& f) const {
+      assert(tree_);
+      struct guard {
+        ~guard() { slot->store(idle_epoch, std::memory_order_release); }
+        std::atomic<uint64_t>* slot;
+      };
+      slot_->epoch.store(tree_->epoch_.load(std::memory_order_seq_cst),
+                         std::memory_order_seq_cst);
+      const guard g{&slot_->epoch};
+      const SegmentTree& version =
+          *tree_->published_.load(std::memory_order_seq_cst);
+      return std::forward<F>(f)(version);
+    }
+
+    // Make a query on [first_index, last_index) segment of the published
+    // version.
+    // Time complexity - O(log n).
+    [[nodiscard]] auto query(size_t first_index, size_t last_index) const {
+      return read([&](const SegmentTree& version) {
+        return version.query(first_index, last_index);
+      });
+    }
+
+    // Time complexity - O(1).
+    [[nodiscard]] size_type size() const {
+      return read([](const SegmentTree& version) { return version.size(); });
+    }
+
+   private:
+    friend class concurrent_segment_tree;
+
+    reader(const concurrent_segment_tree* tree, reader_slot* slot)
+        : tree_(tree), slot_(slot) {}
+
+    void release() noexcept {
+      if (tree_) {
+        slot_->used.store(false, std::memory_order_release);
+        tree_ = nullptr;
+      }
+    }
+
+    const concurrent_segment_tree* tree_;
+    reader_slot* slot_;
+  };
+
+  // Time complexity - O(n).
+  explicit concurrent_segment_tree(SegmentTree tree,
+                                   size_t max_readers = default_max_readers)
+      : versions_{tree, std::move(tree)},
+        slots_(std::make_unique<reader_slot[]>(max_readers)),
+        max_readers_(max_readers),
+        published_(&versions_[0]) {}
+
+  concurrent_segment_tree(const concurrent_segment_tree&) = delete;
+  concurrent_segment_tree& operator=(const concurrent_segment_tree&) = delete;
+
+  // Registers a reader, it can be called from any thread. Throws
+  // std::length_error if all the reader slots are taken.
+  // Time complexity - O(r) where r is the number of reader slots.
+  [[nodiscard]] reader make_reader() const {
+    for (size_t i = 0; i < max_readers_; ++i) {
+      bool used = false;
+      if (slots_[i].used.compare_exchange_strong(used, true,
+                                                 std::memory_order_acquire)) {
+        return reader(this, &slots_[i]);
+      }
+    }
+    throw std::length_error("concurrent_segment_tree::make_reader");
+  }
+
+  // Buffers the update until the next publish(), only the writer may call it.
+  // Time complexity - O(1) amortized.
+  template <typename V>
+  void update(size_t index, V&& v) {
+    assert(index < versions_[0].size());
+    pending_.emplace_back(index, std::forward<V>(v));
+  }
+
+  // Applies buffered updates to the unpublished version and publishes it,
+  // only the writer may call it. Waits for readers of the version published
+  // before the current one.
+  // Time complexity - O(k log n) where k is the number of updates since the
+  // previous publish().
+  void publish() {
+    if (pending_.empty()) {
+      return;
+    }
+    synchronize();
+
+    SegmentTree& next = versions_[1 - published_index_];
+    lagging_.insert(lagging_.end(), pending_.begin(), pending_.end());
+    next.update_batch(lagging_.begin(), lagging_.end());
+
+    published_.store(&next, std::memory_order_seq_cst);
+    epoch_.fetch_add(1, std::memory_order_seq_cst);
+    published_index_ = 1 - published_index_;
+
+    // The previous version misses the updates which are published now.
+    lagging_.swap(pending_);
+    pending_.clear();
+  }
+
+  // Returns the published version, only the writer may call it.
+  // Time complexity - O(1).
+  [[nodiscard]] const SegmentTree& published() const {
+    return versions_[published_index_];
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] size_type size() const { return versions_[0].size(); }
+
+ private:
+  std::vector<std::pair<size_t, value_type>> pending_;
+  std::vector<std::pair<size_t, value_type>> lagging_;
+  SegmentTree versions_[2];
+  size_t published_index_ = 0;
+  std::unique_ptr<reader_slot[]> slots_;
+  size_t max_readers_;
+  std::atomic<const SegmentTree*> published_;
+  std::atomic<uint64_t> epoch_{0};
+};
+
+}  // namespace manavrion::segment_tree
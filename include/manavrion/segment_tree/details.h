@@ -4,11 +4,197 @@
 //
 
 #pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <iterator>
+#include <memory>
+#include <new>
 #include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+#include "manavrion/segment_tree/functional.h"
 
 namespace manavrion::segment_tree::details {
 
+// Hints the processor to fetch the cache line containing address.
+inline void prefetch(const void* address) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(address);
+#elif defined(_M_X64) || defined(_M_IX86)
+  _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#else
+  (void)address;
+#endif
+}
+
+// Returns the index of the most significant set bit of n.
+inline size_t floor_log2(size_t n) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+  return sizeof(unsigned long long) * 8 - 1 - __builtin_clzll(n);
+#else
+  size_t result = 0;
+  while (n >>= 1) {
+    ++result;
+  }
+  return result;
+#endif
+}
+
+// Returns the number of set bits of n.
+inline size_t popcount(uint64_t n) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_popcountll(n);
+#else
+  size_t result = 0;
+  for (; n != 0; n &= n - 1) {
+    ++result;
+  }
+  return result;
+#endif
+}
+
+inline constexpr size_t cache_line_size = 64;
+
+// Allocates memory aligned to Alignment bytes.
+template <typename T, size_t Alignment = cache_line_size>
+struct aligned_allocator {
+  using value_type = T;
+
+  template <typename U>
+  struct rebind {
+    using other = aligned_allocator<U, Alignment>;
+  };
+
+  aligned_allocator() noexcept = default;
+
+  template <typename U>
+  aligned_allocator(const aligned_allocator<U, Alignment>&) noexcept {}
+
+  T* allocate(size_t n) {
+    return static_cast<T*>(
+        ::operator new(n * sizeof(T), std::align_val_t{Alignment}));
+  }
+
+  void deallocate(T* p, size_t) noexcept {
+    ::operator delete(p, std::align_val_t{Alignment});
+  }
+
+  template <typename U>
+  bool operator==(const aligned_allocator<U, Alignment>&) const noexcept {
+    return true;
+  }
+
+  template <typename U>
+  bool operator!=(const aligned_allocator<U, Alignment>&) const noexcept {
+    return false;
+  }
+};
+
+// Creates objects in blocks of geometrically growing size and destroys them
+// all at once, so a creation is a pointer bump unless the block is full.
+// Objects are never moved.
+template <typename T, typename Allocator = std::allocator<T>>
+class bump_arena {
+  using allocator_traits =
+      typename std::allocator_traits<Allocator>::template rebind_traits<T>;
+  using allocator_type = typename allocator_traits::allocator_type;
+
+  struct block {
+    T* data;
+    size_t size;
+    size_t used;
+  };
+
+  void add_block(size_t size) {
+    blocks_.reserve(blocks_.size() + 1);
+    T* data = allocator_traits::allocate(allocator_, size);
+    blocks_.push_back(block{data, size, 0});
+  }
+
+ public:
+  static constexpr size_t min_block_size = 256;
+
+  explicit bump_arena(const Allocator& allocator = {})
+      : allocator_(allocator) {}
+
+  bump_arena(bump_arena&& other) noexcept
+      : allocator_(std::move(other.allocator_)),
+        blocks_(std::exchange(other.blocks_, {})),
+        size_(std::exchange(other.size_, 0)) {}
+
+  bump_arena& operator=(bump_arena&& other) noexcept {
+    if (this != &other) {
+      clear();
+      allocator_ = std::move(other.allocator_);
+      blocks_ = std::exchange(other.blocks_, {});
+      size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+  }
+
+  ~bump_arena() { clear(); }
+
+  // Time complexity - O(1) amortized.
+  template <typename... Args>
+  T* create(Args&&... args) {
+    if (blocks_.empty() || blocks_.back().used == blocks_.back().size) {
+      add_block(std::max(min_block_size, size_));
+    }
+    block& last = blocks_.back();
+    T* result = last.data + last.used;
+    allocator_traits::construct(allocator_, result,
+                                std::forward<Args>(args)...);
+    ++last.used;
+    ++size_;
+    return result;
+  }
+
+  // Makes sure the next count creations do not allocate memory.
+  void reserve(size_t count) {
+    if (blocks_.empty() ||
+        blocks_.back().size - blocks_.back().used < count) {
+      add_block(std::max({min_block_size, size_, count}));
+    }
+  }
+
+  // Destroys all the objects and frees the memory.
+  // Time complexity - O(n).
+  void clear() noexcept {
+    for (block& b : blocks_) {
+      for (size_t i = 0; i < b.used; ++i) {
+        allocator_traits::destroy(allocator_, b.data + i);
+      }
+      allocator_traits::deallocate(allocator_, b.data, b.size);
+    }
+    blocks_.clear();
+    size_ = 0;
+  }
+
+  // Returns the number of created objects.
+  size_t size() const noexcept { return size_; }
+
+  // Returns the number of bytes allocated for the objects.
+  size_t bytes_used() const noexcept {
+    size_t result = 0;
+    for (const block& b : blocks_) {
+      result += b.size * sizeof(T);
+    }
+    return result;
+  }
+
+ private:
+  allocator_type allocator_;
+  std::vector<block> blocks_;
+  size_t size_ = 0;
+};
+
 template <typename InputIt>
 using require_input_iter = std::enable_if_t<std::is_convertible_v<
     typename std::iterator_traits<InputIt>::iterator_category,
@@ -30,4 +216,104 @@ struct deduce_mapper<T, Reducer,
                          T, std::invoke_result_t<Reducer, T, T>>>>
     : public default_mapper {};
 
+template <typename T, typename Action, typename E = void>
+struct deduce_tag {
+  using type = T;
+};
+
+template <typename T, typename Action>
+struct deduce_tag<T, Action, std::void_t<typename Action::tag_type>> {
+  using type = typename Action::tag_type;
+};
+
+// Returns the result of a query on an empty segment, which is the identity
+// if it is known and T{} otherwise.
+template <typename Reducer, typename T>
+constexpr T empty_result() {
+  if constexpr (monoid_traits<Reducer, T>::has_identity) {
+    return monoid_traits<Reducer, T>::identity();
+  } else {
+    return T{};
+  }
+}
+
+// Reduces values, which are taken from both ends of a segment: the values of
+// the left end are added from left to right and the values of the right end
+// are added from right to left. If the identity is known, values are taken
+// by add_left_if() and add_right_if() without branches, and a commutative
+// reducer keeps a single value for both ends.
+template <typename T, typename Reducer>
+class segment_accumulator {
+  using traits = monoid_traits<Reducer, T>;
+  static constexpr bool has_identity = traits::has_identity;
+  static constexpr bool is_single = traits::is_commutative;
+
+ public:
+  constexpr explicit segment_accumulator(const Reducer& reduce)
+      : reduce_(reduce),
+        left_(empty_result<Reducer, T>()),
+        right_(empty_result<Reducer, T>()) {}
+
+  constexpr void add_left(const T& value) {
+    if constexpr (has_identity) {
+      left_ = reduce_(std::move(left_), value);
+    } else {
+      left_ = has_left_ ? T(reduce_(std::move(left_), value)) : value;
+      has_left_ = true;
+    }
+  }
+
+  constexpr void add_right(const T& value) {
+    if constexpr (is_single) {
+      add_left(value);
+    } else if constexpr (has_identity) {
+      right_ = reduce_(value, std::move(right_));
+    } else {
+      right_ = has_right_ ? T(reduce_(value, std::move(right_))) : value;
+      has_right_ = true;
+    }
+  }
+
+  constexpr void add_left_if(bool take, const T& value) {
+    if constexpr (has_identity) {
+      left_ = reduce_(std::move(left_), take ? value : traits::identity());
+    } else if (take) {
+      add_left(value);
+    }
+  }
+
+  constexpr void add_right_if(bool take, const T& value) {
+    if constexpr (is_single) {
+      add_left_if(take, value);
+    } else if constexpr (has_identity) {
+      right_ = reduce_(take ? value : traits::identity(), std::move(right_));
+    } else if (take) {
+      add_right(value);
+    }
+  }
+
+  constexpr T result() && {
+    if constexpr (is_single) {
+      return std::move(left_);
+    } else if constexpr (has_identity) {
+      return reduce_(std::move(left_), std::move(right_));
+    } else {
+      if (has_left_ && has_right_) {
+        return reduce_(std::move(left_), std::move(right_));
+      }
+      return has_left_ ? std::move(left_) : std::move(right_);
+    }
+  }
+
+ private:
+  const Reducer& reduce_;
+  T left_;
+  T right_;
+  bool has_left_ = false;
+  bool has_right_ = false;
+};
+
+// Saves trees to files and opens them, see file_storage.h.
+struct file_access;
+
 }  // namespace manavrion::segment_tree::details
@@ -0,0 +1,219 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#pragma once
+#include <array>
+#include <cassert>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "manavrion/segment_tree/details.h"
+
+namespace manavrion::segment_tree {
+
+// Segment tree over a huge index space where few elements are updated.
+//
+// All the elements are equal to the fill value until they are updated. The
+// tree covers [0, 2^h) where 2^h is not less than the size, and a node is
+// created only when an update passes through it. A missing node of height k
+// has the value reduced from 2^k fill values, which are precomputed for every
+// height. Nodes are created in a bump arena and are freed all at once by
+// assign() or clear(), so the memory is O(m log U) where m is the number of
+// updates and U is the size.
+template <typename T, typename Reducer = std::plus<T>,
+          typename Allocator = std::allocator<T>>
+class dynamic_segment_tree : private Reducer {
+ public:
+  using allocator_type = Allocator;
+  using value_type = T;
+  using size_type = size_t;
+  using difference_type = std::ptrdiff_t;
+
+  using reducer_type = Reducer;
+
+ private:
+  struct node {
+    T value;
+    node* children[2] = {nullptr, nullptr};
+  };
+
+  static constexpr size_t max_height = 63;
+
+  const Reducer& reducer() const { return *static_cast<const Reducer*>(this); }
+
+  // Returns the value of the node of the given height.
+  const T& node_value(const node* n, size_t height) const {
+    return n ? n->value : fills_[height];
+  }
+
+  // Reduces nodes of [first_index, last_index) segment from the left to the
+  // right into result, n covers [first, first + 2^height).
+  // Time complexity - O(log U).
+  void query_impl(const node* n, size_t height, size_t first,
+                  size_t first_index, size_t last_index,
+                  std::optional<T>& result) const {
+    const size_t last = first + (size_t{1} << height);
+    if (first_index <= first && last <= last_index) {
+      if (result) {
+        result.emplace(reducer()(std::move(*result), node_value(n, height)));
+      } else {
+        result.emplace(node_value(n, height));
+      }
+      return;
+    }
+    const size_t middle = first + (size_t{1} << (height - 1));
+    if (first_index < middle) {
+      query_impl(n ? n->children[0] : nullptr, height - 1, first, first_index,
+                 last_index, result);
+    }
+    if (middle < last_index) {
+      query_impl(n ? n->children[1] : nullptr, height - 1, middle,
+                 first_index, last_index, result);
+    }
+  }
+
+ public:
+  explicit dynamic_segment_tree(Reducer reducer = {},
+                                const Allocator& allocator = {})
+      : Reducer(std::move(reducer)), arena_(allocator) {}
+
+  // Time complexity - O(log U).
+  explicit dynamic_segment_tree(size_type count, const T& value = T{},
+                                Reducer reducer = {},
+                                const Allocator& allocator = {})
+      : Reducer(std::move(reducer)), arena_(allocator) {
+    assign(count, value);
+  }
+
+  // Nodes are owned by the arena, so the tree is only movable.
+  dynamic_segment_tree(dynamic_segment_tree&& other) noexcept
+      : Reducer(std::move(other)),
+        arena_(std::move(other.arena_)),
+        fills_(std::move(other.fills_)),
+        root_(std::exchange(other.root_, nullptr)),
+        height_(std::exchange(other.height_, 0)),
+        size_(std::exchange(other.size_, 0)) {}
+
+  dynamic_segment_tree& operator=(dynamic_segment_tree&& other) noexcept {
+    if (this != &other) {
+      Reducer::operator=(std::move(other));
+      arena_ = std::move(other.arena_);
+      fills_ = std::move(other.fills_);
+      root_ = std::exchange(other.root_, nullptr);
+      height_ = std::exchange(other.height_, 0);
+      size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+  }
+
+  // Makes count elements equal to value, no nodes are created.
+  // Time complexity - O(log U + k) where k is the number of the previous nodes.
+  void assign(size_type count, const T& value) {
+    clear();
+    height_ = count > 1 ? details::floor_log2(count - 1) + 1 : 0;
+    assert(height_ <= max_height);
+    size_ = count;
+    fills_.clear();
+    fills_.push_back(value);
+    for (size_t i = 0; i < height_; ++i) {
+      fills_.push_back(reducer()(fills_[i], fills_[i]));
+    }
+  }
+
+  // Time complexity - O(log U).
+  [[nodiscard]] T at(size_type pos) const {
+    if (pos >= size()) {
+      throw std::out_of_range("dynamic_segment_tree::at");
+    }
+    return operator[](pos);
+  }
+
+  // Time complexity - O(log U).
+  [[nodiscard]] T operator[](size_type pos) const {
+    assert(pos < size());
+    const node* n = root_;
+    for (size_t height = height_; n && height != 0; --height) {
+      n = n->children[(pos >> (height - 1)) & 1];
+    }
+    return node_value(n, 0);
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+
+  // Time complexity - O(1).
+  [[nodiscard]] size_type size() const noexcept { return size_; }
+
+  // Returns the number of created nodes.
+  // Time complexity - O(1).
+  [[nodiscard]] size_t nodes() const noexcept { return arena_.size(); }
+
+  // Returns the number of bytes allocated for the nodes.
+  // Time complexity - O(b) where b is the number of arena blocks.
+  [[nodiscard]] size_t bytes_used() const noexcept {
+    return arena_.bytes_used() + fills_.capacity() * sizeof(T);
+  }
+
+  // Removes all the nodes, the elements are equal to the fill value again.
+  // Time complexity - O(k) where k is the number of nodes.
+  void clear() noexcept {
+    arena_.clear();
+    root_ = nullptr;
+  }
+
+  // Time complexity - O(log U).
+  template <typename V>
+  void update(size_t index, V&& v) {
+    assert(index < size());
+    std::array<node*, max_height + 1> path;
+    node** link = &root_;
+    for (size_t height = height_;; --height) {
+      if (!*link) {
+        *link = arena_.create(node{fills_[height]});
+      }
+      path[height] = *link;
+      if (height == 0) {
+        break;
+      }
+      link = &(*link)->children[(index >> (height - 1)) & 1];
+    }
+
+    path[0]->value = std::forward<V>(v);
+    const auto& reduce = reducer();
+    for (size_t height = 1; height <= height_; ++height) {
+      node* n = path[height];
+      n->value = reduce(node_value(n->children[0], height - 1),
+                        node_value(n->children[1], height - 1));
+    }
+  }
+
+  // Make a query on [first_index, last_index) segment.
+  // Time complexity - O(log U).
+  [[nodiscard]] T query(size_t first_index, size_t last_index) const {
+    assert(first_index <= last_index);
+    assert(last_index <= size());
+    std::optional<T> result;
+    if (first_index < last_index) {
+      query_impl(root_, height_, 0, first_index, last_index, result);
+    }
+    if (result) {
+      return std::move(*result);
+    }
+    return details::empty_result<Reducer, T>();
+  }
+
+ private:
+  details::bump_arena<node, Allocator> arena_;
+  // fills_[k] is the value of 2^k fill values.
+  std::vector<T> fills_;
+  node* root_ = nullptr;
+  size_t height_ = 0;
+  size_t size_ = 0;
+};
+
+}  // namespace manavrion::segment_tree
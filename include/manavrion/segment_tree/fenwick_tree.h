@@ -0,0 +1,652 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "manavrion/segment_tree/details.h"
+
+namespace manavrion::segment_tree {
+
+namespace details {
+
+// The slot i of a Fenwick tree reduces the elements [i & (i + 1), i].
+
+// Turns the elements into the slots in place.
+// Time complexity - O(n).
+template <typename T, typename Op>
+void fenwick_build(T* data, size_t n, const Op& op) {
+  for (size_t i = 0; i < n; ++i) {
+    const size_t parent = i | (i + 1);
+    if (parent < n) {
+      data[parent] = op(data[parent], data[i]);
+    }
+  }
+}
+
+// Adds the delta to the element i.
+// Time complexity - O(log n).
+template <typename T, typename Op>
+void fenwick_add(T* data, size_t n, size_t i, const T& delta, const Op& op) {
+  for (; i < n; i |= i + 1) {
+    data[i] = op(data[i], delta);
+  }
+}
+
+// Reduces the first k elements.
+// Time complexity - O(log n).
+template <typename T, typename Op>
+T fenwick_prefix(const T* data, size_t k, const Op& op) {
+  T result{};
+  for (; k > 0; k &= k - 1) {
+    result = op(result, data[k - 1]);
+  }
+  return result;
+}
+
+}  // namespace details
+
+// Fenwick (binary indexed) tree of n slots.
+//
+// Op must be commutative, T{} must be its identity and Inverse(op(a, b), b)
+// must give a, so a query on [first, last) is the inverse of two prefixes.
+// The elements are not stored apart from the slots, an element is computed
+// from O(log n) slots, so the iterators give proxies which read and update
+// the elements.
+template <typename T, typename Op = std::plus<T>,
+          typename Inverse = std::minus<T>,
+          typename Allocator = std::allocator<T>>
+class fenwick_tree : private Op {
+  template <bool IsConst>
+  class basic_iterator;
+
+ public:
+  using allocator_type = Allocator;
+  using value_type = T;
+  using container_type = std::vector<value_type, allocator_type>;
+  using size_type = typename container_type::size_type;
+  using difference_type = typename container_type::difference_type;
+
+  // Element of the tree, assignments update the tree.
+  class reference {
+   public:
+    // Time complexity - O(log n).
+    operator T() const { return tree_->at(index_); }
+
+    // Time complexity - O(log n).
+    reference& operator=(const T& value) {
+      tree_->update(index_, value);
+      return *this;
+    }
+
+    // Time complexity - O(log n).
+    reference& operator=(const reference& other) {
+      return operator=(static_cast<T>(other));
+    }
+
+   private:
+    friend class fenwick_tree;
+
+    reference(fenwick_tree* tree, size_t index) : tree_(tree), index_(index) {}
+
+    fenwick_tree* tree_;
+    size_t index_;
+  };
+
+  using const_reference = T;
+  using iterator = basic_iterator<false>;
+  using const_iterator = basic_iterator<true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  using op_type = Op;
+  using inverse_type = Inverse;
+
+ private:
+  // Random access iterator over the elements.
+  template <bool IsConst>
+  class basic_iterator {
+    using tree_pointer =
+        std::conditional_t<IsConst, const fenwick_tree*, fenwick_tree*>;
+
+   public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = T;
+    using difference_type = typename fenwick_tree::difference_type;
+    using pointer = void;
+    using reference =
+        std::conditional_t<IsConst, T, typename fenwick_tree::reference>;
+
+    basic_iterator() = default;
+
+    template <bool OtherIsConst,
+              typename = std::enable_if_t<IsConst && !OtherIsConst>>
+    basic_iterator(const basic_iterator<OtherIsConst>& other)
+        : tree_(other.tree_), index_(other.index_) {}
+
+    reference operator*() const {
+      if constexpr (IsConst) {
+        return tree_->at(index_);
+      } else {
+        return typename fenwick_tree::reference(tree_, index_);
+      }
+    }
+
+    reference operator[](difference_type n) const { return *(*this + n); }
+
+    basic_iterator& operator++() {
+      ++index_;
+      return *this;
+    }
+
+    basic_iterator operator++(int) {
+      basic_iterator copy = *this;
+      ++index_;
+      return copy;
+    }
+
+    basic_iterator& operator--() {
+      --index_;
+      return *this;
+    }
+
+    basic_iterator operator--(int) {
+      basic_iterator copy = *this;
+      --index_;
+      return copy;
+    }
+
+    basic_iterator& operator+=(difference_type n) {
+      index_ += n;
+      return *this;
+    }
+
+    basic_iterator& operator-=(difference_type n) {
+      index_ -= n;
+      return *this;
+    }
+
+    friend basic_iterator operator+(basic_iterator it, difference_type n) {
+      return it += n;
+    }
+
+    friend basic_iterator operator+(difference_type n, basic_iterator it) {
+      return it += n;
+    }
+
+    friend basic_iterator operator-(basic_iterator it, difference_type n) {
+      return it -= n;
+    }
+
+    friend difference_type operator-(const basic_iterator& lhs,
+                                     const basic_iterator& rhs) {
+      return static_cast<difference_type>(lhs.index_) -
+             static_cast<difference_type>(rhs.index_);
+    }
+
+    friend bool operator==(const basic_iterator& lhs,
+                           const basic_iterator& rhs) {
+      return lhs.index_ == rhs.index_;
+    }
+
+    friend bool operator!=(const basic_iterator& lhs,
+                           const basic_iterator& rhs) {
+      return lhs.index_ != rhs.index_;
+    }
+
+    friend bool operator<(const basic_iterator& lhs,
+                          const basic_iterator& rhs) {
+      return lhs.index_ < rhs.index_;
+    }
+
+    friend bool operator>(const basic_iterator& lhs,
+                          const basic_iterator& rhs) {
+      return lhs.index_ > rhs.index_;
+    }
+
+    friend bool operator<=(const basic_iterator& lhs,
+                           const basic_iterator& rhs) {
+      return lhs.index_ <= rhs.index_;
+    }
+
+    friend bool operator>=(const basic_iterator& lhs,
+                           const basic_iterator& rhs) {
+      return lhs.index_ >= rhs.index_;
+    }
+
+   private:
+    friend class fenwick_tree;
+    template <bool>
+    friend class basic_iterator;
+
+    basic_iterator(tree_pointer tree, size_t index)
+        : tree_(tree), index_(index) {}
+
+    tree_pointer tree_ = nullptr;
+    size_t index_ = 0;
+  };
+
+  const Op& op() const { return *static_cast<const Op*>(this); }
+
+  // Op and Inverse may be the same type, so the inverse is a member.
+  const Inverse& inverse() const { return inverse_; }
+
+  // Creates the slots, time complexity - O(n).
+  void build_tree() { details::fenwick_build(tree_.data(), size(), op()); }
+
+  // Reduces the first k elements.
+  // Time complexity - O(log n).
+  T prefix(size_t k) const {
+    assert(k <= size());
+    return details::fenwick_prefix(tree_.data(), k, op());
+  }
+
+  // Time complexity - O(log n).
+  T element(size_t index) const {
+    // The slot reduces [index & (index + 1), index], the slots which end
+    // before index and start at the same element are taken away.
+    T result = tree_[index];
+    const size_t first = index & (index + 1);
+    for (size_t i = index; i > first; i &= i - 1) {
+      result = inverse()(result, tree_[i - 1]);
+    }
+    return result;
+  }
+
+ public:
+  fenwick_tree() = default;
+
+  explicit fenwick_tree(const Allocator& allocator) : tree_(allocator) {}
+
+  explicit fenwick_tree(Op op, Inverse inverse = {},
+                        const Allocator& allocator = {})
+      : Op(std::move(op)), inverse_(std::move(inverse)), tree_(allocator) {}
+
+  // Time complexity - O(n).
+  template <typename InputIt, typename = details::require_input_iter<InputIt>>
+  fenwick_tree(InputIt first, InputIt last, Op op = {}, Inverse inverse = {},
+               const Allocator& allocator = {})
+      : Op(std::move(op)),
+        inverse_(std::move(inverse)),
+        tree_(first, last, allocator) {
+    build_tree();
+  }
+
+  // Time complexity - O(n).
+  template <typename InputIt, typename = details::require_input_iter<InputIt>>
+  fenwick_tree(InputIt first, InputIt last, const Allocator& allocator)
+      : tree_(first, last, allocator) {
+    build_tree();
+  }
+
+  // Time complexity - O(n).
+  fenwick_tree(std::initializer_list<T> init_list, Op op = {},
+               Inverse inverse = {}, const Allocator& allocator = {})
+      : Op(std::move(op)),
+        inverse_(std::move(inverse)),
+        tree_(init_list, allocator) {
+    build_tree();
+  }
+
+  // Time complexity - O(n).
+  fenwick_tree(std::initializer_list<T> init_list, const Allocator& allocator)
+      : tree_(init_list, allocator) {
+    build_tree();
+  }
+
+  // Time complexity - O(n).
+  fenwick_tree(const fenwick_tree& other) = default;
+  fenwick_tree(fenwick_tree&& other) noexcept = default;
+
+  // Time complexity - O(n).
+  fenwick_tree& operator=(const fenwick_tree& other) = default;
+  fenwick_tree& operator=(fenwick_tree&& other) = default;
+
+  // Time complexity - O(n).
+  fenwick_tree& operator=(std::initializer_list<T> init_list) {
+    tree_.assign(init_list);
+    build_tree();
+    return *this;
+  }
+
+  // Time complexity - O(n).
+  void assign(size_type count, const T& value) {
+    tree_.assign(count, value);
+    build_tree();
+  }
+
+  // Time complexity - O(n).
+  template <class InputIt, typename = details::require_input_iter<InputIt>>
+  void assign(InputIt first, InputIt last) {
+    tree_.assign(first, last);
+    build_tree();
+  }
+
+  // Time complexity - O(n).
+  void assign(std::initializer_list<T> init_list) { operator=(init_list); }
+
+  // Time complexity - O(1).
+  [[nodiscard]] allocator_type get_allocator() const noexcept {
+    return tree_.get_allocator();
+  }
+
+  // Time complexity - O(log n).
+  [[nodiscard]] T at(size_type pos) const {
+    if (pos >= size()) {
+      throw std::out_of_range("fenwick_tree::at");
+    }
+    return element(pos);
+  }
+
+  // Time complexity - O(log n).
+  [[nodiscard]] T operator[](size_type pos) const {
+    assert(pos < size());
+    return element(pos);
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] reference operator[](size_type pos) {
+    assert(pos < size());
+    return reference(this, pos);
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] iterator begin() noexcept { return iterator(this, 0); }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_iterator begin() const noexcept { return cbegin(); }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_iterator cbegin() const noexcept {
+    return const_iterator(this, 0);
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] iterator end() noexcept { return iterator(this, size()); }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_iterator end() const noexcept { return cend(); }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_iterator cend() const noexcept {
+    return const_iterator(this, size());
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] reverse_iterator rbegin() noexcept {
+    return reverse_iterator(end());
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_reverse_iterator rbegin() const noexcept {
+    return crbegin();
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_reverse_iterator crbegin() const noexcept {
+    return const_reverse_iterator(cend());
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] reverse_iterator rend() noexcept {
+    return reverse_iterator(begin());
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_reverse_iterator rend() const noexcept {
+    return crend();
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_reverse_iterator crend() const noexcept {
+    return const_reverse_iterator(cbegin());
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] bool empty() const noexcept { return tree_.empty(); }
+
+  // Time complexity - O(1).
+  [[nodiscard]] size_type size() const noexcept { return tree_.size(); }
+
+  // Time complexity - O(1).
+  [[nodiscard]] size_type max_size() const noexcept {
+    return tree_.max_size();
+  }
+
+  // Returns the number of bytes allocated for the slots.
+  // Time complexity - O(1).
+  [[nodiscard]] size_t bytes_used() const noexcept {
+    return tree_.capacity() * sizeof(T);
+  }
+
+  // Time complexity - O(n).
+  void clear() noexcept { tree_.clear(); }
+
+  void reserve(size_type size) { tree_.reserve(size); }
+
+  // Time complexity - O(1).
+  void swap(fenwick_tree& other) noexcept {
+    auto tmp = std::move(other);
+    other = std::move(*this);
+    *this = std::move(tmp);
+  }
+
+  // Adds the delta to the element.
+  // Time complexity - O(log n).
+  void add(size_t index, const T& delta) {
+    assert(index < size());
+    details::fenwick_add(tree_.data(), size(), index, delta, op());
+  }
+
+  // Time complexity - O(log n).
+  template <typename V>
+  void update(size_t index, V&& v) {
+    assert(index < size());
+    add(index, inverse()(T(std::forward<V>(v)), element(index)));
+  }
+
+  // Make a query on [first_index, last_index) segment.
+  // Time complexity - O(log n).
+  [[nodiscard]] T query(size_t first_index, size_t last_index) const {
+    assert(first_index <= last_index);
+    assert(last_index <= size());
+    return inverse()(prefix(last_index), prefix(first_index));
+  }
+
+  // Elements written through the iterators are already in the tree, so there
+  // is nothing to recompute.
+  // Time complexity - O(1).
+  void update_range(const_iterator first, const_iterator last) {
+    assert(first <= last);
+    assert(cbegin() <= first && last <= cend());
+    static_cast<void>(first);
+    static_cast<void>(last);
+  }
+
+ private:
+  Inverse inverse_;
+  std::vector<T, Allocator> tree_;
+};
+
+template <typename T1, typename T2, typename O, typename I, typename A>
+bool operator==(const fenwick_tree<T1, O, I, A>& lhs,
+                const fenwick_tree<T2, O, I, A>& rhs) {
+  return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+}
+
+template <typename T1, typename T2, typename O, typename I, typename A>
+bool operator!=(const fenwick_tree<T1, O, I, A>& lhs,
+                const fenwick_tree<T2, O, I, A>& rhs) {
+  return !(lhs == rhs);
+}
+
+// Fenwick tree of sums with addition on a range, it keeps two arrays of n
+// slots. The first one holds the differences d[i] = a[i] - a[i - 1] and the
+// second one holds d[i] * i, the sum of the first k elements is
+// k * (d[0] + ... + d[k - 1]) - (0 * d[0] + ... + (k - 1) * d[k - 1]).
+template <typename T, typename Allocator = std::allocator<T>>
+class range_fenwick_tree {
+ public:
+  using allocator_type = Allocator;
+  using value_type = T;
+  using size_type = size_t;
+
+ private:
+  template <typename InputIt>
+  void init_tree(InputIt first, InputIt last) {
+    differences_.assign(first, last);
+    const size_t n = differences_.size();
+    weighted_.resize(n);
+    // Backwards, so every difference takes the element before it.
+    for (size_t i = n; i-- > 1;) {
+      differences_[i] -= differences_[i - 1];
+    }
+    for (size_t i = 0; i < n; ++i) {
+      weighted_[i] = differences_[i] * static_cast<T>(i);
+    }
+    details::fenwick_build(differences_.data(), n, std::plus<T>());
+    details::fenwick_build(weighted_.data(), n, std::plus<T>());
+  }
+
+  // Adds the delta to the elements from the index to the end.
+  // Time complexity - O(log n).
+  void add_suffix(size_t index, const T& delta) {
+    const size_t n = size();
+    details::fenwick_add(differences_.data(), n, index, delta, std::plus<T>());
+    details::fenwick_add(weighted_.data(), n, index,
+                         delta * static_cast<T>(index), std::plus<T>());
+  }
+
+  // Sums the first k elements.
+  // Time complexity - O(log n).
+  T prefix(size_t k) const {
+    assert(k <= size());
+    return static_cast<T>(k) * details::fenwick_prefix(differences_.data(), k,
+                                                      std::plus<T>()) -
+           details::fenwick_prefix(weighted_.data(), k, std::plus<T>());
+  }
+
+ public:
+  range_fenwick_tree() = default;
+
+  explicit range_fenwick_tree(const Allocator& allocator)
+      : differences_(allocator), weighted_(allocator) {}
+
+  // Time complexity - O(n).
+  template <typename InputIt, typename = details::require_input_iter<InputIt>>
+  range_fenwick_tree(InputIt first, InputIt last,
+                     const Allocator& allocator = {})
+      : differences_(allocator), weighted_(allocator) {
+    init_tree(first, last);
+  }
+
+  // Time complexity - O(n).
+  range_fenwick_tree(std::initializer_list<T> init_list,
+                     const Allocator& allocator = {})
+      : differences_(allocator), weighted_(allocator) {
+    init_tree(init_list.begin(), init_list.end());
+  }
+
+  // Time complexity - O(n).
+  void assign(size_type count, const T& value) {
+    differences_.assign(count, T{});
+    weighted_.assign(count, T{});
+    if (count != 0) {
+      add_suffix(0, value);
+    }
+  }
+
+  // Time complexity - O(n).
+  template <class InputIt, typename = details::require_input_iter<InputIt>>
+  void assign(InputIt first, InputIt last) {
+    init_tree(first, last);
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] allocator_type get_allocator() const noexcept {
+    return differences_.get_allocator();
+  }
+
+  // Time complexity - O(log n).
+  [[nodiscard]] T at(size_type pos) const {
+    if (pos >= size()) {
+      throw std::out_of_range("range_fenwick_tree::at");
+    }
+    return (*this)[pos];
+  }
+
+  // Time complexity - O(log n).
+  [[nodiscard]] T operator[](size_type pos) const {
+    assert(pos < size());
+    return details::fenwick_prefix(differences_.data(), pos + 1,
+                                   std::plus<T>());
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] bool empty() const noexcept { return differences_.empty(); }
+
+  // Time complexity - O(1).
+  [[nodiscard]] size_type size() const noexcept {
+    return differences_.size();
+  }
+
+  // Returns the number of bytes allocated for the slots.
+  // Time complexity - O(1).
+  [[nodiscard]] size_t bytes_used() const noexcept {
+    return (differences_.capacity() + weighted_.capacity()) * sizeof(T);
+  }
+
+  // Time complexity - O(n).
+  void clear() noexcept {
+    differences_.clear();
+    weighted_.clear();
+  }
+
+  void reserve(size_type size) {
+    differences_.reserve(size);
+    weighted_.reserve(size);
+  }
+
+  // Adds the value to the elements of [first_index, last_index) segment.
+  // Time complexity - O(log n).
+  void add(size_t first_index, size_t last_index, const T& value) {
+    assert(first_index <= last_index);
+    assert(last_index <= size());
+    if (first_index == last_index) {
+      return;
+    }
+    add_suffix(first_index, value);
+    if (last_index < size()) {
+      add_suffix(last_index, -value);
+    }
+  }
+
+  // Time complexity - O(log n).
+  template <typename V>
+  void update(size_t index, V&& v) {
+    add(index, index + 1, T(std::forward<V>(v)) - (*this)[index]);
+  }
+
+  // Make a query on [first_index, last_index) segment.
+  // Time complexity - O(log n).
+  [[nodiscard]] T query(size_t first_index, size_t last_index) const {
+    assert(first_index <= last_index);
+    assert(last_index <= size());
+    return prefix(last_index) - prefix(first_index);
+  }
+
+ private:
+  std::vector<T, Allocator> differences_;
+  std::vector<T, Allocator> weighted_;
+};
+
+}  // namespace manavrion::segment_tree
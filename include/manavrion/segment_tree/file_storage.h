@@ -0,0 +1,539 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <typeinfo>
+#include <vector>
+
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MANAVRION_SEGMENT_TREE_HAS_MMAP 1
+#endif
+
+#include "manavrion/segment_tree/details.h"
+#include "manavrion/segment_tree/layout.h"
+#include "manavrion/segment_tree/mapped_segment_tree.h"
+#include "manavrion/segment_tree/segment_tree.h"
+
+namespace manavrion::segment_tree {
+
+// A tree is saved as file_header followed by its arrays exactly as they are
+// in memory, each one aligned to a cache line. On POSIX systems the file can
+// be opened over a memory mapping, so the tree is ready to query without
+// reading or building anything, and pages are read when they are touched.
+//
+// Values must be trivially copyable. The type tags in the header are hashes
+// of the type names, so a file is readable by the program built with the same
+// compiler on a machine with the same byte order.
+
+inline constexpr uint32_t file_format_version = 1;
+
+namespace details {
+
+inline constexpr char file_magic[8] = "SEGTREE";
+
+struct file_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;
+  // Hash of the element and the node types.
+  uint64_t value_tag;
+  // Hash of the reducer and the mapper types.
+  uint64_t reducer_tag;
+  uint64_t layout_tag;
+  uint64_t size;
+  uint64_t shift;
+  // Elements of mapped_segment_tree, which are stored apart from the nodes.
+  uint64_t data_offset;
+  uint64_t data_count;
+  uint64_t tree_offset;
+  uint64_t tree_count;
+};
+
+// FNV-1a hash of the type names.
+template <typename... Ts>
+uint64_t type_tag() {
+  uint64_t hash = 14695981039346656037ull;
+  for (const char* name : {typeid(Ts).name()...}) {
+    // The terminating zero separates the names.
+    do {
+      hash = (hash ^ static_cast<unsigned char>(*name)) * 1099511628211ull;
+    } while (*name++ != '\0');
+  }
+  return hash;
+}
+
+inline uint64_t align_to_cache_line(uint64_t offset) {
+  return (offset + cache_line_size - 1) / cache_line_size * cache_line_size;
+}
+
+}  // namespace details
+
+#ifdef MANAVRION_SEGMENT_TREE_HAS_MMAP
+
+enum class open_mode {
+  // The tree must not be modified.
+  read_only,
+  // Modifications are private to the process and are not written to the file.
+  copy_on_write,
+  // Modifications are written to the file.
+  read_write,
+};
+
+namespace details {
+
+// Memory mapping of the whole file.
+class file_mapping {
+  [[noreturn]] static void throw_error(int error, const char* what) {
+    throw std::system_error(error, std::generic_category(), what);
+  }
+
+ public:
+  file_mapping(const std::string& path, open_mode mode) {
+    const bool writable = mode == open_mode::read_write;
+    const int fd = ::open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+    if (fd < 0) {
+      throw_error(errno, "open");
+    }
+    struct stat file_stat;
+    if (::fstat(fd, &file_stat) != 0) {
+      const int error = errno;
+      ::close(fd);
+      throw_error(error, "fstat");
+    }
+    size_ = static_cast<size_t>(file_stat.st_size);
+    const int protection =
+        mode == open_mode::read_only ? PROT_READ : PROT_READ | PROT_WRITE;
+    const int flags =
+        mode == open_mode::copy_on_write ? MAP_PRIVATE : MAP_SHARED;
+    void* data = size_ == 0
+                     ? nullptr
+                     : ::mmap(nullptr, size_, protection, flags, fd, 0);
+    const int error = errno;
+    ::close(fd);
+    if (data == MAP_FAILED) {
+      throw_error(error, "mmap");
+    }
+    data_ = static_cast<char*>(data);
+  }
+
+  file_mapping(const file_mapping&) = delete;
+  file_mapping& operator=(const file_mapping&) = delete;
+
+  ~file_mapping() {
+    if (data_) {
+      ::munmap(data_, size_);
+    }
+  }
+
+  char* data() const noexcept { return data_; }
+  size_t size() const noexcept { return size_; }
+
+  // Writes the modified pages to the file.
+  void flush() const {
+    if (data_ && ::msync(data_, size_, MS_SYNC) != 0) {
+      throw_error(errno, "msync");
+    }
+  }
+
+ private:
+  char* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+// Array of a tree in the mapping, it is given to the first allocation which
+// fits.
+struct mapped_region {
+  std::shared_ptr<file_mapping> mapping;
+  char* data = nullptr;
+  size_t bytes = 0;
+  bool taken = false;
+};
+
+}  // namespace details
+
+// Allocator of a tree opened by open_file(). The array from the file is
+// allocated once, all the other allocations are made by std::allocator, so a
+// tree which grows beyond its file moves to the heap. Copies of a tree are
+// made on the heap too. The mapping is released with the last allocator
+// which refers to it.
+template <typename T>
+class mapping_allocator {
+ public:
+  using value_type = T;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  mapping_allocator() noexcept = default;
+
+  explicit mapping_allocator(
+      std::shared_ptr<details::mapped_region> region) noexcept
+      : region_(std::move(region)) {}
+
+  template <typename U>
+  mapping_allocator(const mapping_allocator<U>& other) noexcept
+      : region_(other.region_) {}
+
+  T* allocate(size_t n) {
+    if (region_ && !region_->taken && n * sizeof(T) <= region_->bytes) {
+      region_->taken = true;
+      return reinterpret_cast<T*>(region_->data);
+    }
+    return std::allocator<T>().allocate(n);
+  }
+
+  void deallocate(T* p, size_t n) noexcept {
+    if (region_ && reinterpret_cast<char*>(p) == region_->data) {
+      return;
+    }
+    std::allocator<T>().deallocate(p, n);
+  }
+
+  // Values inserted without arguments into the array from the file are not
+  // constructed at all, so resizing the vector over it keeps the values, even
+  // of types with default member initializers, and does not touch the pages.
+  // Elsewhere such values are default-initialized rather than
+  // value-initialized.
+  template <typename U, typename... Args>
+  void construct(U* p, Args&&... args) {
+    if constexpr (sizeof...(Args) == 0) {
+      const char* bytes = reinterpret_cast<const char*>(p);
+      if (region_ && bytes >= region_->data &&
+          bytes < region_->data + region_->bytes) {
+        return;
+      }
+      ::new (static_cast<void*>(p)) U;
+    } else {
+      ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+    }
+  }
+
+  mapping_allocator select_on_container_copy_construction() const noexcept {
+    return {};
+  }
+
+  // Writes the modified pages of the file to the disk.
+  void flush() const {
+    if (region_) {
+      region_->mapping->flush();
+    }
+  }
+
+  template <typename U>
+  bool operator==(const mapping_allocator<U>& other) const noexcept {
+    return region_ == other.region_;
+  }
+
+  template <typename U>
+  bool operator!=(const mapping_allocator<U>& other) const noexcept {
+    return !(*this == other);
+  }
+
+ private:
+  template <typename U>
+  friend class mapping_allocator;
+
+  std::shared_ptr<details::mapped_region> region_;
+};
+
+template <typename T, typename Reducer = std::plus<T>,
+          typename Layout = heap_layout>
+using file_segment_tree =
+    segment_tree<T, Reducer, mapping_allocator<T>, Layout>;
+
+template <typename T, typename Reducer = std::plus<T>,
+          typename Mapper = details::deduce_mapper<T, Reducer>,
+          typename Layout = heap_layout>
+using file_mapped_segment_tree = mapped_segment_tree<
+    T, Reducer, Mapper, mapping_allocator<T>,
+    mapping_allocator<std::decay_t<std::invoke_result_t<Mapper, T>>>,
+    Layout>;
+
+#endif  // MANAVRION_SEGMENT_TREE_HAS_MMAP
+
+namespace details {
+
+struct file_access {
+  template <typename Value, typename Node, typename Reducer, typename Mapper,
+            typename Layout>
+  static file_header make_header(uint64_t size, uint64_t shift,
+                                 uint64_t data_count, uint64_t tree_count) {
+    static_assert(std::is_trivially_copyable_v<Value>);
+    static_assert(std::is_trivially_copyable_v<Node>);
+    file_header header{};
+    std::memcpy(header.magic, file_magic, sizeof(header.magic));
+    header.version = file_format_version;
+    header.header_size = sizeof(file_header);
+    header.value_tag = type_tag<Value, Node>();
+    header.reducer_tag = type_tag<Reducer, Mapper>();
+    header.layout_tag = type_tag<Layout>();
+    header.size = size;
+    header.shift = shift;
+    header.data_offset = align_to_cache_line(sizeof(file_header));
+    header.data_count = data_count;
+    header.tree_offset =
+        align_to_cache_line(header.data_offset + data_count * sizeof(Value));
+    header.tree_count = tree_count;
+    return header;
+  }
+
+  template <typename Value, typename Node>
+  static void write_file(const std::string& path, const file_header& header,
+                         const Value* data, const Node* nodes) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    const std::vector<char> padding(cache_line_size);
+    auto write = [&](const void* bytes, uint64_t count) {
+      out.write(static_cast<const char*>(bytes),
+                static_cast<std::streamsize>(count));
+    };
+    auto pad_to = [&](uint64_t offset) {
+      const uint64_t position = static_cast<uint64_t>(out.tellp());
+      write(padding.data(), offset - position);
+    };
+    write(&header, sizeof(header));
+    pad_to(header.data_offset);
+    write(data, header.data_count * sizeof(Value));
+    pad_to(header.tree_offset);
+    write(nodes, header.tree_count * sizeof(Node));
+    out.close();
+    if (!out) {
+      throw std::runtime_error("segment_tree: cannot write " + path);
+    }
+  }
+
+  template <typename T, typename R, typename A, typename L>
+  static void save(const segment_tree<T, R, A, L>& tree,
+                   const std::string& path) {
+    const file_header header = make_header<T, T, R, void, L>(
+        tree.size(), tree.shift_, 0, tree.tree_.size());
+    write_file<T, T>(path, header, nullptr, tree.tree_.data());
+  }
+
+  template <typename T, typename R, typename M, typename A, typename TA,
+            typename L>
+  static void save(const mapped_segment_tree<T, R, M, A, TA, L>& tree,
+                   const std::string& path) {
+    using node = typename mapped_segment_tree<T, R, M, A, TA, L>::
+        tree_value_type;
+    const file_header header = make_header<T, node, R, M, L>(
+        tree.size(), tree.shift_, tree.data_.size(), tree.tree_.size());
+    write_file(path, header, tree.data_.data(), tree.tree_.data());
+  }
+
+  // Returns 2^k - 1 for the smallest 2^k >= size, the shift of the tree of
+  // size elements.
+  static uint64_t expected_shift(uint64_t size) {
+    return size <= 1 ? 0 : (uint64_t{2} << floor_log2(size - 1)) - 1;
+  }
+
+  // Checks that the header describes a tree of the expected types, which
+  // fits into the file. Nodes of segment_tree are followed by its elements,
+  // and elements of mapped_segment_tree are stored apart. The header is
+  // trusted for node indexing afterwards, so the shift and the number of
+  // nodes must be exactly the ones of a tree of its size. pop_back() halves
+  // the leaves only when a quarter of them are used, so the shift may also be
+  // the one of a tree of twice the size.
+  template <typename Value, typename Node, typename Layout>
+  static file_header check_header(const char* bytes, uint64_t file_size,
+                                  const file_header& expected,
+                                  bool is_mapped) {
+    auto fail = [](const char* what) {
+      throw std::runtime_error(std::string("segment_tree: ") + what);
+    };
+    file_header header;
+    if (file_size < sizeof(header)) {
+      fail("file is too small");
+    }
+    std::memcpy(&header, bytes, sizeof(header));
+    if (std::memcmp(header.magic, file_magic, sizeof(header.magic)) != 0) {
+      fail("not a segment tree file");
+    }
+    if (header.version != file_format_version ||
+        header.header_size != sizeof(file_header)) {
+      fail("unsupported file version");
+    }
+    if (header.value_tag != expected.value_tag ||
+        header.reducer_tag != expected.reducer_tag ||
+        header.layout_tag != expected.layout_tag) {
+      fail("file has a tree of other types");
+    }
+    auto fits = [file_size](uint64_t offset, uint64_t count, size_t bytes) {
+      return offset <= file_size && count <= (file_size - offset) / bytes;
+    };
+    if (header.data_offset % alignof(Value) != 0 ||
+        header.tree_offset % alignof(Node) != 0 ||
+        !fits(header.data_offset, header.data_count, sizeof(Value)) ||
+        !fits(header.tree_offset, header.tree_count, sizeof(Node))) {
+      fail("file is truncated");
+    }
+    // Every element takes at least one byte of the file, so the sums below
+    // do not overflow.
+    if (header.size > file_size) {
+      fail("file is corrupted");
+    }
+    const uint64_t shift = expected_shift(header.size);
+    if (header.shift != shift &&
+        (header.size == 0 || header.shift != 2 * shift + 1)) {
+      fail("file is corrupted");
+    }
+    uint64_t tree_count = 0;
+    if (!is_mapped) {
+      tree_count = header.size == 0 ? 0 : header.shift + header.size;
+    } else if (Layout::is_level_order) {
+      tree_count = (header.shift + header.size) / 2;
+    } else {
+      tree_count = header.shift;
+    }
+    if (header.data_count != (is_mapped ? header.size : 0) ||
+        header.tree_count != tree_count) {
+      fail("file is corrupted");
+    }
+    return header;
+  }
+
+  template <typename Value, typename Node, typename Layout>
+  static file_header read_header(std::ifstream& in, const std::string& path,
+                                 const file_header& expected,
+                                 bool is_mapped) {
+    if (!in) {
+      throw std::runtime_error("segment_tree: cannot read " + path);
+    }
+    in.seekg(0, std::ios::end);
+    const uint64_t file_size = static_cast<uint64_t>(in.tellg());
+    in.seekg(0);
+    char bytes[sizeof(file_header)] = {};
+    in.read(bytes, std::min<uint64_t>(file_size, sizeof(bytes)));
+    return check_header<Value, Node, Layout>(bytes, file_size, expected,
+                                             is_mapped);
+  }
+
+  // Reads count values at offset of the file.
+  template <typename V, typename A>
+  static void read_values(std::ifstream& in, std::vector<V, A>& values,
+                          uint64_t offset, uint64_t count) {
+    values.resize(count);
+    in.seekg(static_cast<std::streamoff>(offset));
+    in.read(reinterpret_cast<char*>(values.data()),
+            static_cast<std::streamsize>(count * sizeof(V)));
+  }
+
+  template <typename T, typename R, typename A, typename L>
+  static void load(segment_tree<T, R, A, L>& tree, const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    const file_header header = read_header<T, T, L>(
+        in, path, make_header<T, T, R, void, L>(0, 0, 0, 0), false);
+    tree.shift_ = header.shift;
+    read_values(in, tree.tree_, header.tree_offset, header.tree_count);
+    if (!in) {
+      throw std::runtime_error("segment_tree: cannot read " + path);
+    }
+  }
+
+  template <typename T, typename R, typename M, typename A, typename TA,
+            typename L>
+  static void load(mapped_segment_tree<T, R, M, A, TA, L>& tree,
+                   const std::string& path) {
+    using node = typename mapped_segment_tree<T, R, M, A, TA, L>::
+        tree_value_type;
+    std::ifstream in(path, std::ios::binary);
+    const file_header header = read_header<T, node, L>(
+        in, path, make_header<T, node, R, M, L>(0, 0, 0, 0), true);
+    tree.shift_ = header.shift;
+    read_values(in, tree.data_, header.data_offset, header.data_count);
+    read_values(in, tree.tree_, header.tree_offset, header.tree_count);
+    if (!in) {
+      throw std::runtime_error("segment_tree: cannot read " + path);
+    }
+  }
+
+#ifdef MANAVRION_SEGMENT_TREE_HAS_MMAP
+  // Makes the vector refer to count values at offset of the mapping.
+  // Time complexity - O(1) page faults.
+  template <typename V>
+  static void adopt(std::vector<V, mapping_allocator<V>>& values,
+                    const std::shared_ptr<file_mapping>& mapping,
+                    uint64_t offset, uint64_t count) {
+    auto region = std::make_shared<mapped_region>();
+    region->mapping = mapping;
+    region->data = mapping->data() + offset;
+    region->bytes = count * sizeof(V);
+    values = std::vector<V, mapping_allocator<V>>(mapping_allocator<V>(region));
+    values.resize(count);
+  }
+
+  template <typename T, typename R, typename L>
+  static void open(segment_tree<T, R, mapping_allocator<T>, L>& tree,
+                   const std::string& path, open_mode mode) {
+    auto mapping = std::make_shared<file_mapping>(path, mode);
+    const file_header header = check_header<T, T, L>(
+        mapping->data(), mapping->size(),
+        make_header<T, T, R, void, L>(0, 0, 0, 0), false);
+    tree.shift_ = header.shift;
+    adopt(tree.tree_, mapping, header.tree_offset, header.tree_count);
+  }
+
+  template <typename T, typename R, typename M, typename N, typename L>
+  static void open(mapped_segment_tree<T, R, M, mapping_allocator<T>,
+                                       mapping_allocator<N>, L>& tree,
+                   const std::string& path, open_mode mode) {
+    auto mapping = std::make_shared<file_mapping>(path, mode);
+    const file_header header = check_header<T, N, L>(
+        mapping->data(), mapping->size(),
+        make_header<T, N, R, M, L>(0, 0, 0, 0), true);
+    tree.shift_ = header.shift;
+    adopt(tree.data_, mapping, header.data_offset, header.data_count);
+    adopt(tree.tree_, mapping, header.tree_offset, header.tree_count);
+  }
+#endif  // MANAVRION_SEGMENT_TREE_HAS_MMAP
+};
+
+}  // namespace details
+
+// Writes segment_tree or mapped_segment_tree to the file at path. The file
+// must not be mapped by an opened tree.
+// Time complexity - O(n).
+template <typename Tree>
+void save_file(const Tree& tree, const std::string& path) {
+  details::file_access::save(tree, path);
+}
+
+// Reads the tree written by save_file() into memory.
+// Time complexity - O(n).
+template <typename Tree>
+[[nodiscard]] Tree load_file(const std::string& path) {
+  Tree tree;
+  details::file_access::load(tree, path);
+  return tree;
+}
+
+#ifdef MANAVRION_SEGMENT_TREE_HAS_MMAP
+// Opens the tree written by save_file() over a memory mapping of the file.
+// Tree is file_segment_tree or file_mapped_segment_tree with the same types
+// as the saved tree, otherwise std::runtime_error is thrown.
+// Time complexity - O(1) page faults.
+template <typename Tree>
+[[nodiscard]] Tree open_file(const std::string& path,
+                             open_mode mode = open_mode::read_only) {
+  Tree tree;
+  details::file_access::open(tree, path, mode);
+  return tree;
+}
+#endif  // MANAVRION_SEGMENT_TREE_HAS_MMAP
+
+}  // namespace manavrion::segment_tree
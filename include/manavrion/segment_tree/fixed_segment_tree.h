@@ -0,0 +1,303 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#pragma once
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "manavrion/segment_tree/details.h"
+
+namespace manavrion::segment_tree {
+
+namespace details {
+
+// Calls f(std::integral_constant<size_t, I>{}) for I in [0, Count) without a
+// loop.
+template <typename F, size_t... Is>
+constexpr void unroll_impl(F&& f, std::index_sequence<Is...>) {
+  (f(std::integral_constant<size_t, Is>{}), ...);
+}
+
+template <size_t Count, typename F>
+constexpr void unroll(F&& f) {
+  unroll_impl(std::forward<F>(f), std::make_index_sequence<Count>{});
+}
+
+}  // namespace details
+
+// Segment tree of N elements in std::array, the nodes are stored as in
+// segment_tree with heap_layout. The height is known at compile time, so the
+// loops over the levels are unrolled, and all the member functions are
+// constexpr, so a tree can be built at compile time. T must be a literal type
+// and T{} is the value of the nodes which cover no elements.
+template <typename T, size_t N, typename Reducer = std::plus<T>>
+class fixed_segment_tree : private Reducer {
+  static_assert(N > 0, "fixed_segment_tree must have elements");
+
+  // Returns the number of nodes above n leaves, which is 2^ceil(log n) - 1.
+  static constexpr size_t get_shift(size_t n) {
+    size_t leaves = 1;
+    while (leaves < n) {
+      leaves *= 2;
+    }
+    return leaves - 1;
+  }
+
+  // Returns the number of levels above the leaves.
+  static constexpr size_t get_height(size_t shift) {
+    size_t height = 0;
+    for (; shift != 0; shift /= 2) {
+      ++height;
+    }
+    return height;
+  }
+
+  static constexpr size_t shift_ = get_shift(N);
+  static constexpr size_t tree_size_ = shift_ + N;
+  static constexpr size_t height_ = get_height(shift_);
+
+  using container_type = std::array<T, tree_size_>;
+
+ public:
+  using value_type = T;
+  using size_type = size_t;
+  using difference_type = typename container_type::difference_type;
+  using const_reference = typename container_type::const_reference;
+  using const_pointer = typename container_type::const_pointer;
+  using const_iterator = typename container_type::const_iterator;
+  using const_reverse_iterator =
+      typename container_type::const_reverse_iterator;
+
+  using reducer_type = Reducer;
+
+ private:
+  constexpr const Reducer& reducer() const {
+    return *static_cast<const Reducer*>(this);
+  }
+
+  static constexpr size_t parent(size_t node_index) {
+    return (node_index - 1) / 2;
+  }
+
+  static constexpr size_t left_child(size_t node_index) {
+    return node_index * 2 + 1;
+  }
+
+  // Recomputes the node from its children.
+  // Time complexity - O(1).
+  constexpr void update_node(size_t i) {
+    const size_t child_1 = left_child(i);
+    const size_t child_2 = child_1 + 1;
+    if (child_2 < tree_size_) {
+      tree_[i] = reducer()(tree_[child_1], tree_[child_2]);
+    } else {
+      tree_[i] = tree_[child_1];
+    }
+  }
+
+  // Creates segment tree nodes, time complexity - O(n).
+  constexpr void build_tree() {
+    if (tree_size_ == 1) {
+      return;
+    }
+    // The nodes after the parent of the last element cover no elements.
+    for (size_t i = parent(tree_size_ - 1) + 1; i-- != 0;) {
+      update_node(i);
+    }
+  }
+
+  template <typename InputIt>
+  constexpr void init_tree(InputIt first, InputIt last) {
+    for (size_t i = shift_; first != last; ++first, ++i) {
+      assert(i < tree_size_);
+      tree_[i] = *first;
+    }
+    build_tree();
+  }
+
+ public:
+  constexpr fixed_segment_tree() = default;
+
+  explicit constexpr fixed_segment_tree(Reducer reducer)
+      : Reducer(std::move(reducer)) {}
+
+  // The elements after the given ones are T{}.
+  // Time complexity - O(n).
+  template <typename InputIt, typename = details::require_input_iter<InputIt>>
+  constexpr fixed_segment_tree(InputIt first, InputIt last,
+                               Reducer reducer = {})
+      : Reducer(std::move(reducer)) {
+    init_tree(first, last);
+  }
+
+  // Time complexity - O(n).
+  constexpr fixed_segment_tree(std::initializer_list<T> init_list,
+                               Reducer reducer = {})
+      : Reducer(std::move(reducer)) {
+    init_tree(init_list.begin(), init_list.end());
+  }
+
+  // Time complexity - O(n).
+  constexpr fixed_segment_tree(const std::array<T, N>& elements,
+                               Reducer reducer = {})
+      : Reducer(std::move(reducer)) {
+    init_tree(elements.begin(), elements.end());
+  }
+
+  // Time complexity - O(n).
+  template <class InputIt, typename = details::require_input_iter<InputIt>>
+  constexpr void assign(InputIt first, InputIt last) {
+    tree_ = {};
+    init_tree(first, last);
+  }
+
+  // Time complexity - O(n).
+  constexpr void assign(std::initializer_list<T> init_list) {
+    assign(init_list.begin(), init_list.end());
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] constexpr const_reference at(size_type pos) const {
+    if (pos >= N) {
+      throw std::out_of_range("fixed_segment_tree::at");
+    }
+    return tree_[shift_ + pos];
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] constexpr const_reference operator[](size_type pos) const {
+    assert(pos < N);
+    return tree_[shift_ + pos];
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] constexpr const T* data() const noexcept {
+    return tree_.data() + shift_;
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] constexpr const_iterator begin() const noexcept {
+    return cbegin();
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] constexpr const_iterator cbegin() const noexcept {
+    return tree_.cbegin() + shift_;
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] constexpr const_iterator end() const noexcept {
+    return cend();
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] constexpr const_iterator cend() const noexcept {
+    return tree_.cend();
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] constexpr const_reverse_iterator rbegin() const noexcept {
+    return crbegin();
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] constexpr const_reverse_iterator crbegin() const noexcept {
+    return tree_.crbegin();
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] constexpr const_reverse_iterator rend() const noexcept {
+    return crend();
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] constexpr const_reverse_iterator crend() const noexcept {
+    return tree_.crend() - shift_;
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] static constexpr bool empty() noexcept { return false; }
+
+  // Time complexity - O(1).
+  [[nodiscard]] static constexpr size_type size() noexcept { return N; }
+
+  // Returns the number of bytes of the elements and the nodes.
+  // Time complexity - O(1).
+  [[nodiscard]] static constexpr size_t bytes_used() noexcept {
+    return sizeof(container_type);
+  }
+
+  // Time complexity - O(log n).
+  template <typename V>
+  constexpr void update(size_t index, V&& v) {
+    assert(index < N);
+    size_t i = shift_ + index;
+    tree_[i] = std::forward<V>(v);
+    details::unroll<height_>([&](auto) {
+      i = parent(i);
+      update_node(i);
+    });
+  }
+
+  // Make a query on [first_index, last_index) segment.
+  // Time complexity - O(log n).
+  [[nodiscard]] constexpr T query(size_t first_index,
+                                  size_t last_index) const {
+    assert(first_index <= last_index);
+    assert(last_index <= N);
+
+    details::segment_accumulator<T, Reducer> result(reducer());
+
+    // The nodes of a level are [shift, 2 * shift], [first_index, last_index)
+    // are indexes in the level. The first node is taken if it is a right
+    // child and the last node is taken if it is a left child, so both
+    // indexes are even and the rest of the segment is covered by the parents.
+    details::unroll<height_ + 1>([&](auto level) {
+      constexpr size_t shift = shift_ >> decltype(level)::value;
+      if (first_index < last_index) {
+        const bool take_first = first_index % 2 != 0;
+        result.add_left_if(take_first, tree_[shift + first_index]);
+        first_index += take_first;
+        const bool take_last =
+            (first_index < last_index) & (last_index % 2 != 0);
+        result.add_right_if(take_last, tree_[shift + last_index - 1]);
+        last_index -= take_last;
+      }
+      first_index /= 2;
+      last_index /= 2;
+    });
+
+    return std::move(result).result();
+  }
+
+ private:
+  container_type tree_{};
+};
+
+template <typename T, size_t N, typename R>
+constexpr bool operator==(const fixed_segment_tree<T, N, R>& lhs,
+                          const fixed_segment_tree<T, N, R>& rhs) {
+  for (size_t i = 0; i < N; ++i) {
+    if (!(lhs[i] == rhs[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename T, size_t N, typename R>
+constexpr bool operator!=(const fixed_segment_tree<T, N, R>& lhs,
+                          const fixed_segment_tree<T, N, R>& rhs) {
+  return !(lhs == rhs);
+}
+
+}  // namespace manavrion::segment_tree
@@ -0,0 +1,165 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#pragma once
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <type_traits>
+
+namespace manavrion::segment_tree {
+
+template <typename T>
+struct minimum {
+  constexpr T operator()(const T& lhs, const T& rhs) const {
+    return std::min(lhs, rhs);
+  }
+};
+
+template <typename T>
+struct maximum {
+  constexpr T operator()(const T& lhs, const T& rhs) const {
+    return std::max(lhs, rhs);
+  }
+};
+
+template <typename T>
+struct gcd {
+  constexpr T operator()(const T& lhs, const T& rhs) const {
+    return std::gcd(lhs, rhs);
+  }
+};
+
+// Describes Reducer on T: identity() is the value e such that
+// reduce(e, a) == reduce(a, e) == a, and the flags tell if reduce(a, b) ==
+// reduce(b, a), if reduce(a, a) == a, so overlapping ranges may be reduced,
+// and if inverse_type takes b away from reduce(a, b). Specialize it for other
+// reducers.
+template <typename Reducer, typename T, typename = void>
+struct monoid_traits {
+  static constexpr bool has_identity = false;
+  static constexpr bool is_commutative = false;
+  static constexpr bool is_idempotent = false;
+  static constexpr bool is_invertible = false;
+};
+
+namespace details {
+
+template <typename T>
+using require_arithmetic =
+    std::enable_if_t<std::is_arithmetic_v<T> && !std::is_same_v<T, bool>>;
+
+template <typename T>
+using require_integral = std::enable_if_t<std::is_integral_v<T>>;
+
+template <typename T>
+struct plus_traits {
+  static constexpr bool has_identity = true;
+  static constexpr bool is_commutative = true;
+  static constexpr bool is_idempotent = false;
+  static constexpr bool is_invertible = true;
+  using inverse_type = std::minus<T>;
+  static constexpr T identity() { return T(0); }
+};
+
+template <typename T>
+struct multiplies_traits {
+  static constexpr bool has_identity = true;
+  static constexpr bool is_commutative = true;
+  static constexpr bool is_idempotent = false;
+  static constexpr bool is_invertible = false;
+  static constexpr T identity() { return T(1); }
+};
+
+template <typename T>
+struct minimum_traits {
+  static constexpr bool has_identity = true;
+  static constexpr bool is_commutative = true;
+  static constexpr bool is_idempotent = true;
+  static constexpr bool is_invertible = false;
+  static constexpr T identity() {
+    if constexpr (std::numeric_limits<T>::has_infinity) {
+      return std::numeric_limits<T>::infinity();
+    } else {
+      return std::numeric_limits<T>::max();
+    }
+  }
+};
+
+template <typename T>
+struct maximum_traits {
+  static constexpr bool has_identity = true;
+  static constexpr bool is_commutative = true;
+  static constexpr bool is_idempotent = true;
+  static constexpr bool is_invertible = false;
+  static constexpr T identity() {
+    if constexpr (std::numeric_limits<T>::has_infinity) {
+      return -std::numeric_limits<T>::infinity();
+    } else {
+      return std::numeric_limits<T>::lowest();
+    }
+  }
+};
+
+// Commutative and idempotent reducers, such as gcd and bitwise operations,
+// whose identity is value.
+template <typename T, T value>
+struct semilattice_traits {
+  static constexpr bool has_identity = true;
+  static constexpr bool is_commutative = true;
+  static constexpr bool is_idempotent = true;
+  static constexpr bool is_invertible = false;
+  static constexpr T identity() { return value; }
+};
+
+}  // namespace details
+
+template <typename T>
+struct monoid_traits<std::plus<T>, T, details::require_arithmetic<T>>
+    : details::plus_traits<T> {};
+
+template <typename T>
+struct monoid_traits<std::plus<>, T, details::require_arithmetic<T>>
+    : details::plus_traits<T> {};
+
+template <typename T>
+struct monoid_traits<std::multiplies<T>, T, details::require_arithmetic<T>>
+    : details::multiplies_traits<T> {};
+
+template <typename T>
+struct monoid_traits<std::multiplies<>, T, details::require_arithmetic<T>>
+    : details::multiplies_traits<T> {};
+
+template <typename T>
+struct monoid_traits<minimum<T>, T, details::require_arithmetic<T>>
+    : details::minimum_traits<T> {};
+
+template <typename T>
+struct monoid_traits<maximum<T>, T, details::require_arithmetic<T>>
+    : details::maximum_traits<T> {};
+
+// gcd(a, a) and gcd(0, a) are -a for negative a.
+template <typename T>
+struct monoid_traits<gcd<T>, T, std::enable_if_t<std::is_unsigned_v<T>>>
+    : details::semilattice_traits<T, T(0)> {};
+
+template <typename T>
+struct monoid_traits<std::bit_and<T>, T, details::require_integral<T>>
+    : details::semilattice_traits<T, static_cast<T>(~T(0))> {};
+
+template <typename T>
+struct monoid_traits<std::bit_and<>, T, details::require_integral<T>>
+    : details::semilattice_traits<T, static_cast<T>(~T(0))> {};
+
+template <typename T>
+struct monoid_traits<std::bit_or<T>, T, details::require_integral<T>>
+    : details::semilattice_traits<T, T(0)> {};
+
+template <typename T>
+struct monoid_traits<std::bit_or<>, T, details::require_integral<T>>
+    : details::semilattice_traits<T, T(0)> {};
+
+}  // namespace manavrion::segment_tree
@@ -0,0 +1,161 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+#include "manavrion/segment_tree/details.h"
+
+namespace manavrion::segment_tree {
+
+// Node layouts of a complete binary tree of nodes nodes, where the node is
+// given by its level-order index. Indexes which are not less than nodes are
+// kept as is, so the leaves stored after the tree are not moved.
+//
+// position(node, nodes) returns the storage index of the node.
+// ancestor_positions(node, nodes, positions, siblings) writes storage indexes
+// of the node ancestors from the root to the node itself to positions, and
+// storage indexes of their siblings to siblings, and returns the depth of the
+// node. The node may be a leaf stored after the tree.
+
+// Level-order layout, the children of the node i are 2i + 1 and 2i + 2.
+struct heap_layout {
+  static constexpr bool is_level_order = true;
+
+  static constexpr size_t position(size_t node, size_t) noexcept {
+    return node;
+  }
+
+  static size_t ancestor_positions(size_t node, size_t, size_t* positions,
+                                   size_t* siblings) noexcept {
+    const size_t depth = details::floor_log2(node + 1);
+    for (size_t i = 0; i <= depth; ++i) {
+      const size_t ancestor = (node + 1) >> (depth - i);
+      positions[i] = ancestor - 1;
+      siblings[i] = (ancestor ^ 1) - 1;
+    }
+    return depth;
+  }
+};
+
+namespace details {
+
+// The van Emde Boas layout splits the tree of height h into the top tree of
+// height h / 2 and the bottom trees below it. A node at depth d is the root
+// of a bottom tree in exactly one of the recursive splits, veb_split
+// describes that split.
+struct veb_split {
+  uint8_t top_depth = 0;
+  uint8_t top_height = 0;
+  uint8_t bottom_height = 0;
+};
+
+inline constexpr size_t max_veb_height = 64;
+
+using veb_splits = std::array<veb_split, max_veb_height>;
+
+constexpr void fill_veb_splits(veb_splits& splits, size_t depth,
+                               size_t height) {
+  if (height <= 1) {
+    return;
+  }
+  const size_t top_height = height / 2;
+  const size_t bottom_height = height - top_height;
+  auto& split = splits[depth + top_height];
+  split.top_depth = static_cast<uint8_t>(depth);
+  split.top_height = static_cast<uint8_t>(top_height);
+  split.bottom_height = static_cast<uint8_t>(bottom_height);
+  fill_veb_splits(splits, depth, top_height);
+  fill_veb_splits(splits, depth + top_height, bottom_height);
+}
+
+constexpr std::array<veb_splits, max_veb_height> make_veb_splits() {
+  std::array<veb_splits, max_veb_height> result{};
+  for (size_t height = 1; height < max_veb_height; ++height) {
+    fill_veb_splits(result[height], 0, height);
+  }
+  return result;
+}
+
+// Splits for trees of every height, indexed by the height and the depth.
+inline constexpr std::array<veb_splits, max_veb_height> veb_split_table =
+    make_veb_splits();
+
+}  // namespace details
+
+// Van Emde Boas layout. The top tree and every bottom tree are stored
+// contiguously in the same layout, so a root-to-leaf path touches
+// O(log_B n) cache lines of B nodes without knowing B. Positions are computed
+// with per-depth tables as described by Brodal, Fagerberg and Jacob.
+struct veb_layout {
+  static constexpr bool is_level_order = false;
+
+  // Time complexity - O(log log n).
+  static size_t position(size_t node, size_t nodes) noexcept {
+    if (node >= nodes) {
+      return node;
+    }
+    const auto& splits = details::veb_split_table[height(nodes)];
+    const size_t node_depth = details::floor_log2(node + 1);
+    size_t result = 0;
+    for (size_t depth = node_depth; depth != 0;) {
+      const auto& split = splits[depth];
+      const size_t ancestor = (node + 1) >> (node_depth - depth);
+      result += offset(split, ancestor);
+      depth = split.top_depth;
+    }
+    return result;
+  }
+
+  // Time complexity - O(log n).
+  static size_t ancestor_positions(size_t node, size_t nodes,
+                                   size_t* positions,
+                                   size_t* siblings) noexcept {
+    const size_t tree_height = height(nodes);
+    const auto& splits = details::veb_split_table[tree_height];
+    const size_t node_depth = details::floor_log2(node + 1);
+    assert(node_depth <= tree_height);
+    const size_t last_depth = std::min(node_depth, tree_height - 1);
+    positions[0] = 0;
+    siblings[0] = 0;
+    for (size_t depth = 1; depth <= last_depth; ++depth) {
+      const auto& split = splits[depth];
+      const size_t ancestor = (node + 1) >> (node_depth - depth);
+      const size_t top_position = positions[split.top_depth];
+      // Siblings are roots of the adjacent bottom trees of the same split.
+      positions[depth] = top_position + offset(split, ancestor);
+      siblings[depth] = top_position + offset(split, ancestor ^ 1);
+    }
+    if (node >= nodes) {
+      positions[node_depth] = node;
+      siblings[node_depth] = ((node + 1) ^ 1) - 1;
+    }
+    return node_depth;
+  }
+
+ private:
+  static size_t height(size_t nodes) noexcept {
+    const size_t result = details::floor_log2(nodes + 1);
+    assert(nodes + 1 == size_t{1} << result);
+    assert(result < details::max_veb_height);
+    return result;
+  }
+
+  // Returns the position of the bottom tree root, which is the node of the
+  // heap index (ancestor - 1), relative to the root of the top tree.
+  static size_t offset(const details::veb_split& split,
+                       size_t ancestor) noexcept {
+    const size_t top_size = (size_t{1} << split.top_height) - 1;
+    const size_t bottom_size = (size_t{1} << split.bottom_height) - 1;
+    const size_t bottom_tree = ancestor & top_size;
+    return top_size + bottom_tree * bottom_size;
+  }
+};
+
+}  // namespace manavrion::segment_tree
@@ -0,0 +1,488 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "manavrion/segment_tree/details.h"
+
+namespace manavrion::segment_tree {
+
+// Adds tag to each element of a segment. Expects std::plus reducer.
+template <typename T>
+struct add_action {
+  using tag_type = T;
+  T operator()(const T& value, const T& tag, size_t count) const {
+    return value + tag * static_cast<T>(count);
+  }
+};
+
+template <typename T>
+struct add_compose {
+  T operator()(const T& new_tag, const T& old_tag) const {
+    return new_tag + old_tag;
+  }
+};
+
+// Assigns tag to each element of a segment. Expects std::plus reducer.
+template <typename T>
+struct assign_action {
+  using tag_type = T;
+  T operator()(const T&, const T& tag, size_t count) const {
+    return tag * static_cast<T>(count);
+  }
+};
+
+template <typename T>
+struct assign_compose {
+  T operator()(const T& new_tag, const T&) const { return new_tag; }
+};
+
+// Replaces each element x of a segment with (tag.first * x + tag.second).
+// Expects std::plus reducer.
+template <typename T>
+struct affine_action {
+  using tag_type = std::pair<T, T>;
+  T operator()(const T& value, const tag_type& tag, size_t count) const {
+    return tag.first * value + tag.second * static_cast<T>(count);
+  }
+};
+
+template <typename T>
+struct affine_compose {
+  using tag_type = std::pair<T, T>;
+  tag_type operator()(const tag_type& new_tag, const tag_type& old_tag) const {
+    return {new_tag.first * old_tag.first,
+            new_tag.first * old_tag.second + new_tag.second};
+  }
+};
+
+// Segment tree with lazy propagation of range updates.
+//
+// Action is invoked as action(value, tag, count) and must return the reduced
+// value of count elements after the tag has been applied to each of them.
+// Compose is invoked as compose(new_tag, old_tag) and must return a tag that
+// is equivalent to applying old_tag first and new_tag after it.
+template <typename T, typename Reducer = std::plus<T>,
+          typename Action = add_action<T>, typename Compose = add_compose<T>,
+          typename Allocator = std::allocator<T>>
+class lazy_segment_tree : private Reducer, private Action, private Compose {
+ public:
+  using allocator_type = Allocator;
+  using value_type = T;
+  using container_type = std::vector<value_type, allocator_type>;
+  using size_type = typename container_type::size_type;
+  using difference_type = typename container_type::difference_type;
+  using reference = typename container_type::reference;
+  using const_reference = typename container_type::const_reference;
+
+  using reducer_type = Reducer;
+  using action_type = Action;
+  using compose_type = Compose;
+  using tag_type = typename details::deduce_tag<T, Action>::type;
+
+  static_assert(std::is_invocable_v<Action, T, tag_type, size_t>);
+  static_assert(std::is_invocable_v<Compose, tag_type, tag_type>);
+
+ private:
+  using tag_allocator_type = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<std::optional<tag_type>>;
+
+  const Reducer& reducer() const& { return *static_cast<const Reducer*>(this); }
+  Reducer&& reducer() && { return std::move(*static_cast<Reducer*>(this)); }
+
+  const Action& action() const& { return *static_cast<const Action*>(this); }
+  Action&& action() && { return std::move(*static_cast<Action*>(this)); }
+
+  const Compose& compose() const& {
+    return *static_cast<const Compose*>(this);
+  }
+  Compose&& compose() && { return std::move(*static_cast<Compose*>(this)); }
+
+  size_t parent(size_t node_index) const {
+    assert(node_index != 0);
+    return (node_index - 1) / 2;
+  }
+
+  size_t left_child(size_t node_index) const { return node_index * 2 + 1; }
+  size_t right_child(size_t node_index) const { return node_index * 2 + 2; }
+
+  size_t shift_up(size_t shift) const { return shift / 2; }
+
+  size_t get_shift(size_t n) const {
+    if (n == 0) return 0;
+    return std::pow(2, std::ceil(std::log2(n))) - 1;
+  }
+
+  size_t get_tree_size(size_t shift, size_t n) const { return shift + n; }
+
+  void init_tree_impl(size_t n) {
+    tree_.clear();
+    tags_.clear();
+
+    shift_ = get_shift(n);
+    tree_.resize(get_tree_size(shift_, n));
+    tags_.resize(shift_);
+  }
+
+  template <typename InputIt>
+  void init_tree(InputIt first, InputIt last) {
+    init_tree_impl(std::distance(first, last));
+    std::copy(first, last, std::next(tree_.begin(), shift_));
+  }
+
+  void init_tree(size_t n, const T& value) {
+    init_tree_impl(n);
+    std::fill(std::next(tree_.begin(), shift_), tree_.end(), value);
+  }
+
+  // Creates segment tree nodes, time complexity - O(n).
+  void build_tree() {
+    const size_t tree_size = tree_.size();
+    const auto& reduce = reducer();
+
+    size_t last = tree_size ? tree_size - 1 : 0;
+    size_t shift = shift_;
+    assert(shift <= last);
+
+    while (last != 0) {
+      const size_t prev_last = last;
+      last = parent(last);
+      shift = shift_up(shift);
+      for (size_t i = shift; i <= last; ++i) {
+        const size_t child_1 = left_child(i);
+        const size_t child_2 = child_1 + 1;
+        assert(child_2 == right_child(i));
+        if (child_2 <= prev_last) {
+          tree_[i] = reduce(tree_[child_1], tree_[child_2]);
+        } else if (child_1 <= prev_last) {
+          tree_[i] = tree_[child_1];
+        }
+      }
+    }
+  }
+
+  // Returns the number of elements in [first_index, last_index) which are
+  // actually stored in the tree.
+  size_t count(size_t first_index, size_t last_index) const {
+    const size_t n = size();
+    if (first_index >= n) return 0;
+    return std::min(last_index, n) - first_index;
+  }
+
+  // Applies tag to the node, which covers count elements.
+  void apply_tag(size_t node_index, const tag_type& tag, size_t count) {
+    tree_[node_index] = action()(tree_[node_index], tag, count);
+    if (node_index < shift_) {
+      auto& pending = tags_[node_index];
+      if (pending) {
+        pending.emplace(compose()(tag, *pending));
+      } else {
+        pending.emplace(tag);
+      }
+    }
+  }
+
+  // Moves a pending tag of the node, which covers [first_index, last_index),
+  // to its children.
+  void push(size_t node_index, size_t first_index, size_t last_index) {
+    assert(node_index < shift_);
+    auto& pending = tags_[node_index];
+    if (!pending) {
+      return;
+    }
+    const tag_type tag = std::move(*pending);
+    pending.reset();
+
+    const size_t middle_index = first_index + (last_index - first_index) / 2;
+    apply_tag(left_child(node_index), tag, count(first_index, middle_index));
+    if (middle_index < size()) {
+      apply_tag(right_child(node_index), tag, count(middle_index, last_index));
+    }
+  }
+
+  // Recomputes the node from its children.
+  void pull(size_t node_index, size_t middle_index) {
+    const size_t child_1 = left_child(node_index);
+    const size_t child_2 = child_1 + 1;
+    assert(child_2 == right_child(node_index));
+    if (middle_index < size()) {
+      tree_[node_index] = reducer()(tree_[child_1], tree_[child_2]);
+    } else {
+      tree_[node_index] = tree_[child_1];
+    }
+  }
+
+  // The node covers [node_first, node_last) segment.
+  // Time complexity - O(log n).
+  void apply_impl(size_t node_index, size_t node_first, size_t node_last,
+                  size_t first_index, size_t last_index, const tag_type& tag) {
+    if (last_index <= node_first || node_last <= first_index ||
+        size() <= node_first) {
+      return;
+    }
+    if (first_index <= node_first && node_last <= last_index) {
+      apply_tag(node_index, tag, count(node_first, node_last));
+      return;
+    }
+    push(node_index, node_first, node_last);
+    const size_t node_middle = node_first + (node_last - node_first) / 2;
+    apply_impl(left_child(node_index), node_first, node_middle, first_index,
+               last_index, tag);
+    apply_impl(right_child(node_index), node_middle, node_last, first_index,
+               last_index, tag);
+    pull(node_index, node_middle);
+  }
+
+  // The node covers [node_first, node_last) segment.
+  // Time complexity - O(log n).
+  template <typename V>
+  void update_impl(size_t node_index, size_t node_first, size_t node_last,
+                   size_t index, V&& v) {
+    if (node_first + 1 == node_last) {
+      assert(node_index >= shift_);
+      tree_[node_index] = std::forward<V>(v);
+      return;
+    }
+    push(node_index, node_first, node_last);
+    const size_t node_middle = node_first + (node_last - node_first) / 2;
+    if (index < node_middle) {
+      update_impl(left_child(node_index), node_first, node_middle, index,
+                  std::forward<V>(v));
+    } else {
+      update_impl(right_child(node_index), node_middle, node_last, index,
+                  std::forward<V>(v));
+    }
+    pull(node_index, node_middle);
+  }
+
+  // Pending tags are applied to the partial results on the way up, so the
+  // query does not modify the tree.
+  // Time complexity - O(log n).
+  std::optional<T> query_impl(size_t node_index, size_t node_first,
+                              size_t node_last, size_t first_index,
+                              size_t last_index) const {
+    if (last_index <= node_first || node_last <= first_index ||
+        size() <= node_first) {
+      return std::nullopt;
+    }
+    if (first_index <= node_first && node_last <= last_index) {
+      return tree_[node_index];
+    }
+
+    const size_t node_middle = node_first + (node_last - node_first) / 2;
+    std::optional<T> result = query_impl(left_child(node_index), node_first,
+                                         node_middle, first_index, last_index);
+    std::optional<T> right_result =
+        query_impl(right_child(node_index), node_middle, node_last,
+                   first_index, last_index);
+    if (!result) {
+      result = std::move(right_result);
+    } else if (right_result) {
+      result.emplace(reducer()(std::move(*result), *right_result));
+    }
+
+    const auto& pending = tags_[node_index];
+    if (result && pending) {
+      const size_t result_count =
+          count(std::max(node_first, first_index),
+                std::min(node_last, last_index));
+      result.emplace(action()(std::move(*result), *pending, result_count));
+    }
+    return result;
+  }
+
+ public:
+  lazy_segment_tree() = default;
+
+  explicit lazy_segment_tree(const Allocator& allocator)
+      : tree_(allocator), tags_(allocator) {}
+
+  explicit lazy_segment_tree(Reducer reducer, Action action = {},
+                             Compose compose = {},
+                             const Allocator& allocator = {})
+      : Reducer(std::move(reducer)),
+        Action(std::move(action)),
+        Compose(std::move(compose)),
+        tree_(allocator),
+        tags_(allocator) {}
+
+  // Time complexity - O(n).
+  template <typename InputIt, typename = details::require_input_iter<InputIt>>
+  lazy_segment_tree(InputIt first, InputIt last, Reducer reducer = {},
+                    Action action = {}, Compose compose = {},
+                    const Allocator& allocator = {})
+      : Reducer(std::move(reducer)),
+        Action(std::move(action)),
+        Compose(std::move(compose)),
+        tree_(allocator),
+        tags_(allocator) {
+    init_tree(first, last);
+    build_tree();
+  }
+
+  // Time complexity - O(n).
+  template <typename InputIt, typename = details::require_input_iter<InputIt>>
+  lazy_segment_tree(InputIt first, InputIt last, const Allocator& allocator)
+      : tree_(allocator), tags_(allocator) {
+    init_tree(first, last);
+    build_tree();
+  }
+
+  // Time complexity - O(n).
+  lazy_segment_tree(std::initializer_list<T> init_list, Reducer reducer = {},
+                    Action action = {}, Compose compose = {},
+                    const Allocator& allocator = {})
+      : Reducer(std::move(reducer)),
+        Action(std::move(action)),
+        Compose(std::move(compose)),
+        tree_(allocator),
+        tags_(allocator) {
+    init_tree(init_list.begin(), init_list.end());
+    build_tree();
+  }
+
+  // Time complexity - O(n).
+  lazy_segment_tree(std::initializer_list<T> init_list,
+                    const Allocator& allocator)
+      : tree_(allocator), tags_(allocator) {
+    init_tree(init_list.begin(), init_list.end());
+    build_tree();
+  }
+
+  // Time complexity - O(n).
+  lazy_segment_tree(const lazy_segment_tree& other) = default;
+  lazy_segment_tree(lazy_segment_tree&& other) noexcept = default;
+
+  // Time complexity - O(n).
+  lazy_segment_tree& operator=(const lazy_segment_tree& other) = default;
+  lazy_segment_tree& operator=(lazy_segment_tree&& other) = default;
+
+  // Time complexity - O(n).
+  lazy_segment_tree& operator=(std::initializer_list<T> init_list) {
+    init_tree(init_list.begin(), init_list.end());
+    build_tree();
+    return *this;
+  }
+
+  // Time complexity - O(n).
+  void assign(size_type count, const T& value) {
+    init_tree(count, value);
+    build_tree();
+  }
+
+  // Time complexity - O(n).
+  template <class InputIt, typename = details::require_input_iter<InputIt>>
+  void assign(InputIt first, InputIt last) {
+    init_tree(first, last);
+    build_tree();
+  }
+
+  // Time complexity - O(n).
+  void assign(std::initializer_list<T> init_list) { operator=(init_list); }
+
+  // Time complexity - O(1).
+  [[nodiscard]] allocator_type get_allocator() const noexcept {
+    return tree_.get_allocator();
+  }
+
+  // Time complexity - O(log n).
+  [[nodiscard]] T at(size_type pos) const {
+    if (pos >= size()) {
+      throw std::out_of_range("lazy_segment_tree::at");
+    }
+    return operator[](pos);
+  }
+
+  // Time complexity - O(log n).
+  [[nodiscard]] T operator[](size_type pos) const {
+    assert(pos < size());
+    size_t i = pos + shift_;
+    T result = tree_[i];
+    while (i != 0) {
+      i = parent(i);
+      if (const auto& pending = tags_[i]) {
+        result = action()(std::move(result), *pending, 1);
+      }
+    }
+    return result;
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] bool empty() const noexcept { return tree_.empty(); }
+
+  // Time complexity - O(1).
+  [[nodiscard]] size_type size() const noexcept {
+    return tree_.size() - shift_;
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] size_type max_size() const noexcept { return tree_.max_size(); }
+
+  // Time complexity - O(n).
+  void clear() noexcept {
+    tree_.clear();
+    tags_.clear();
+    shift_ = 0;
+  }
+
+  // Time complexity - O(1).
+  void swap(lazy_segment_tree& other) noexcept {
+    auto tmp = std::move(other);
+    other = std::move(*this);
+    *this = std::move(tmp);
+  }
+
+  // Time complexity - O(log n).
+  template <typename V>
+  void update(size_t index, V&& v) {
+    assert(index < size());
+    update_impl(0, 0, shift_ + 1, index, std::forward<V>(v));
+  }
+
+  // Applies tag to each element of [first_index, last_index) segment.
+  // Time complexity - O(log n).
+  void apply(size_t first_index, size_t last_index, const tag_type& tag) {
+    assert(first_index <= last_index);
+    assert(last_index <= size());
+    if (first_index == last_index) {
+      return;
+    }
+    apply_impl(0, 0, shift_ + 1, first_index, last_index, tag);
+  }
+
+  // Make a query on [first_index, last_index) segment.
+  // Time complexity - O(log n).
+  [[nodiscard]] T query(size_t first_index, size_t last_index) const {
+    assert(first_index <= last_index);
+    assert(last_index <= size());
+
+    std::optional<T> result;
+    if (first_index < last_index) {
+      result = query_impl(0, 0, shift_ + 1, first_index, last_index);
+    }
+    if (!result) {
+      result.emplace(details::empty_result<Reducer, T>());
+    }
+    return std::move(*result);
+  }
+
+ private:
+  std::vector<T, Allocator> tree_;
+  std::vector<std::optional<tag_type>, tag_allocator_type> tags_;
+  size_t shift_ = 0;
+};
+
+}  // namespace manavrion::segment_tree
@@ -3,24 +3,36 @@
 // This file is part of the mapped_segment_tree header-only library.
 //
 
+#pragma once
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cmath>
 #include <functional>
 #include <iterator>
+#include <limits>
 #include <optional>
 #include <type_traits>
 #include <vector>
 
 #include "manavrion/segment_tree/details.h"
+#include "manavrion/segment_tree/layout.h"
+#include "manavrion/segment_tree/parallel.h"
+#include "manavrion/segment_tree/simd.h"
+#include "manavrion/segment_tree/storage.h"
 
 namespace manavrion::segment_tree {
 
+// Layout is the storage order of the tree nodes, see layout.h. The elements
+// are stored contiguously in any layout. Storage is aos_storage or
+// soa_storage, which keeps every field of the nodes in its own array, see
+// storage.h.
 template <typename T, typename Reducer = std::plus<T>,
           typename Mapper = details::deduce_mapper<T, Reducer>,
           typename Allocator = std::allocator<T>,
           typename TreeAllocator =
-              std::allocator<std::decay_t<std::invoke_result_t<Mapper, T>>>>
+              std::allocator<std::decay_t<std::invoke_result_t<Mapper, T>>>,
+          typename Layout = heap_layout, typename Storage = aos_storage>
 class mapped_segment_tree : private Reducer, private Mapper {
   static_assert(std::is_invocable_v<Mapper, T>);
   using mapper_result = std::decay_t<std::invoke_result_t<Mapper, T>>;
@@ -47,7 +59,9 @@ class mapped_segment_tree : private Reducer, private Mapper {
 
   using tree_allocator_type = TreeAllocator;
   using tree_value_type = mapper_result;
-  using tree_container_type = std::vector<tree_value_type, tree_allocator_type>;
+  using tree_container_type =
+      typename Storage::template container<tree_value_type,
+                                           tree_allocator_type>;
   using tree_size_type = typename tree_container_type::size_type;
   using tree_difference_type = typename tree_container_type::difference_type;
   using tree_reference = typename tree_container_type::reference;
@@ -62,6 +76,8 @@ class mapped_segment_tree : private Reducer, private Mapper {
 
   using mapper_type = Mapper;
   using reducer_type = Reducer;
+  using layout_type = Layout;
+  using storage_type = Storage;
 
  private:
   const Reducer& reducer() const& { return *static_cast<const Reducer*>(this); }
@@ -112,6 +128,32 @@ class mapped_segment_tree : private Reducer, private Mapper {
 
   size_t get_tree_size(size_t shift, size_t n) const { return (shift + n) / 2; }
 
+  // Number of nodes, which have data descendants.
+  size_t tree_size() const { return get_tree_size(shift_, data_.size()); }
+
+  // Returns the node by its level-order index.
+  // Time complexity - O(1) for heap_layout, O(log log n) for veb_layout.
+  tree_reference node(size_t node_index) {
+    return tree_[Layout::position(node_index, shift_)];
+  }
+  tree_const_reference node(size_t node_index) const {
+    return tree_[Layout::position(node_index, shift_)];
+  }
+
+  // Hints the processor to fetch the node by its level-order index.
+  void prefetch_node(size_t node_index) const {
+    details::prefetch_node(tree_, Layout::position(node_index, shift_));
+  }
+
+  // Returns the node by its level-order index, the nodes from shift_ are the
+  // mapped elements.
+  tree_value_type node_or_element(size_t node_index) const {
+    if (node_index >= shift_) {
+      return mapper()(data_[node_index - shift_]);
+    }
+    return node(node_index);
+  }
+
   size_t get_tree_capacity(size_t shift) const { return shift; }
 
   void init_tree() {
@@ -119,64 +161,215 @@ class mapped_segment_tree : private Reducer, private Mapper {
     const size_t n = data_.size();
 
     shift_ = get_shift(n);
-    tree_.resize(get_tree_size(shift_, n));
+    // Nodes without data descendants are placed among the other nodes in
+    // layouts other than the level-order one, so all the nodes are stored.
+    tree_.resize(Layout::is_level_order ? get_tree_size(shift_, n) : shift_);
   }
 
-  void rebuild_tree() {
+  void rebuild_tree(size_t threads = 1) {
     tree_.clear();
-    build_tree();
+    build_tree(threads);
   }
 
-  // Creates segment tree nodes, time complexity - O(n).
-  void build_tree() {
-    init_tree();
-    const size_t tree_size = tree_.size();
-    const size_t data_size = data_.size();
+  // Computes parents of [first, last) data elements, where first is even.
+  // Time complexity - O(k) where k is (last - first).
+  void build_data_nodes(size_t first, size_t last) {
+    assert(first % 2 == 0);
     const auto& reduce = reducer();
     const auto& map = mapper();
 
-    for (size_t i = shift_up(shift_); i < tree_size; ++i) {
-      const size_t child_1 = left_data_child(i);
-      const size_t child_2 = child_1 + 1;
-      assert(child_2 == right_data_child(i));
-      if (child_2 < data_size) {
-        tree_[i] = reduce(map(data_[child_1]), map(data_[child_2]));
-      } else if (child_1 < data_size) {
-        tree_[i] = map(data_[child_1]);
-      } else {
-        assert(false);
+    // Only the last node can have a single data child.
+    const size_t first_node = shift_up(shift_) + first / 2;
+    const size_t full_nodes = (last - first) / 2;
+    details::reduce_mapped_pairs_to_nodes(data_.data() + first, tree_,
+                                          first_node, full_nodes, map, reduce);
+    if ((last - first) % 2 != 0) {
+      tree_[first_node + full_nodes] = map(data_[last - 1]);
+    }
+  }
+
+  // Computes ancestors of [first, last] nodes, which are located at the same
+  // level and first is the leftmost node of a subtree, up to the given number
+  // of levels.
+  // Time complexity - O(k) where k is (last - first).
+  void build_levels(size_t first, size_t last, size_t levels) {
+    const auto& reduce = reducer();
+
+    for (; levels != 0; --levels) {
+      assert(is_left_child(first));
+      const size_t first_child = first;
+      const size_t last_child = last;
+      first = parent(first);
+      last = parent(last);
+
+      // Children of [first, last] are [first_child, last_child], only the last
+      // node can have a single child.
+      const size_t children = last_child + 1 - first_child;
+      const size_t full_nodes = children / 2;
+      details::reduce_node_pairs(tree_, first_child, first, full_nodes,
+                                 reduce);
+      if (children % 2 != 0) {
+        assert(first + full_nodes == last);
+        tree_[last] = tree_[last_child];
       }
     }
+  }
 
-    size_t last = tree_size ? tree_size - 1 : 0;
-    size_t shift = shift_up(shift_);
+  // Computes ancestors of [first, last] nodes of the level, where all the
+  // nodes except the last one are equal to value. Every level is filled with
+  // one value, which is the reduction of two values of the level below.
+  // Time complexity - O(n) stores and O(log n) reductions.
+  void build_uniform_levels(size_t first, size_t last, tree_value_type value) {
+    const auto& reduce = reducer();
 
-    while (last != 0) {
-      const size_t prev_last = last;
+    while (first != 0) {
+      const size_t last_child = last;
+      first = parent(first);
       last = parent(last);
-      shift = shift_up(shift);
-      for (size_t i = shift; i <= last; ++i) {
-        const size_t child_1 = left_child(i);
-        const size_t child_2 = child_1 + 1;
-        assert(child_2 == right_child(i));
-        if (child_2 <= prev_last) {
-          tree_[i] = reduce(tree_[child_1], tree_[child_2]);
-        } else if (child_1 <= prev_last) {
-          tree_[i] = tree_[child_1];
+
+      value = reduce(value, value);
+      std::fill(std::next(tree_.begin(), first), std::next(tree_.begin(), last),
+                value);
+      const size_t child = left_child(last);
+      if (child == last_child) {
+        tree_[last] = tree_[child];
+      } else {
+        tree_[last] = reduce(tree_[child], tree_[child + 1]);
+      }
+    }
+  }
+
+  // Creates segment tree nodes when all the data elements are equal.
+  // Time complexity - O(n) stores and O(log n) reductions.
+  void build_uniform_tree() {
+    if constexpr (!Layout::is_level_order) {
+      build_tree();
+      return;
+    }
+    init_tree();
+    const size_t tree_size = this->tree_size();
+    if (tree_size == 0) {
+      return;
+    }
+    const auto& reduce = reducer();
+
+    // Only the last parent of data can have a single data child.
+    const tree_value_type element = mapper()(data_.front());
+    const tree_value_type value = reduce(element, element);
+    const size_t first = shift_up(shift_);
+    const size_t last = tree_size - 1;
+    std::fill(std::next(tree_.begin(), first), std::next(tree_.begin(), last),
+              value);
+    tree_[last] = data_.size() % 2 != 0 ? element : value;
+    build_uniform_levels(first, last, value);
+  }
+
+  // Creates segment tree nodes on threads threads, which is rounded down to a
+  // power of two. Each thread maps contiguous data and builds the subtree
+  // over it, and the levels above the subtrees are built serially.
+  // Time complexity - O(n / threads + threads).
+  void build_tree(size_t threads = 1) {
+    init_tree();
+    const size_t tree_size = this->tree_size();
+    const size_t data_size = data_.size();
+
+    if constexpr (!Layout::is_level_order) {
+      // Levels are not contiguous, so nodes are recomputed one by one.
+      for (size_t i = shift_up(shift_); i < tree_size; ++i) {
+        update_data_node(i);
+      }
+      if (tree_size > 1) {
+        for (size_t i = parent(tree_size - 1) + 1; i-- != 0;) {
+          update_node(i);
         }
       }
+      return;
+    }
+
+    if (tree_size == 0) {
+      return;
+    }
+    // Number of levels above the parents of data.
+    const size_t height = details::floor_log2(shift_ + 1) - 1;
+    const size_t split_depth = std::min(details::floor_log2(threads), height);
+    const size_t subtree_size = (shift_ + 1) >> split_depth;
+    const size_t subtrees = (data_size - 1) / subtree_size + 1;
+
+    details::parallel_for(subtrees, [&](size_t i) {
+      const size_t first = i * subtree_size;
+      const size_t last = std::min(data_size, first + subtree_size);
+      build_data_nodes(first, last);
+      const size_t data_shift = shift_up(shift_);
+      build_levels(data_shift + first / 2, data_shift + (last - 1) / 2,
+                   height - split_depth);
+    });
+
+    const size_t first_root = (size_t{1} << split_depth) - 1;
+    build_levels(first_root, first_root + subtrees - 1, split_depth);
+  }
+
+  // Makes the tree of 2n data leaves when n + 1 elements are stored, the tree
+  // becomes the left subtree of the new root, so every level moves one level
+  // down.
+  // Time complexity - O(n).
+  void grow_tree() {
+    const size_t shift = shift_;
+    assert(data_.size() == shift + 2);
+    shift_ = 2 * shift + 1;
+
+    if constexpr (!Layout::is_level_order) {
+      rebuild_tree();
+      return;
+    }
+
+    tree_.resize(tree_size());
+    for (size_t first = shift_up(shift); shift != 0; first = shift_up(first)) {
+      const auto level = std::next(tree_.begin(), first);
+      std::move_backward(level, level + first + 1, level + 2 * first + 2);
+      if (first == 0) {
+        break;
+      }
     }
   }
 
+  // Makes the tree of n data leaves from the left subtree of the root when at
+  // most a quarter of 2n data leaves are used, so every level moves one level
+  // up. The tree is not shrunk at a half, so alternating push_back() and
+  // pop_back() do not rebuild it every time.
+  // Time complexity - O(n).
+  void shrink_tree() {
+    assert(shift_ != 0 && data_.size() == (shift_ + 1) / 4);
+    const size_t shift = shift_up(shift_);
+
+    if constexpr (!Layout::is_level_order) {
+      rebuild_tree();
+      return;
+    }
+
+    // Nodes without data descendants are not stored.
+    for (size_t first = 0; shift != 0; first = left_child(first)) {
+      const auto level = std::next(tree_.begin(), first);
+      std::move(level + first + 1,
+                std::min(level + 2 * first + 2, tree_.end()), level);
+      if (first == shift_up(shift)) {
+        break;
+      }
+    }
+    shift_ = shift;
+    tree_.resize(tree_size());
+  }
+
   // Updates unique element.
   // Time complexity - O(log n).
   void update(size_t i) {
-    if (data_.size() == 1) {
+    // A single element has no nodes unless the tree was not shrunk after
+    // pop_back().
+    if (shift_ == 0) {
       assert(tree_.empty());
       return;
     }
     const size_t data_size = data_.size();
-    const size_t tree_size = tree_.size();
+    const size_t tree_size = this->tree_size();
     const auto& reduce = reducer();
     const auto& map = mapper();
 
@@ -184,6 +377,11 @@ class mapped_segment_tree : private Reducer, private Mapper {
     i = parent_of_data(i);
     assert(i < tree_size);
 
+    if constexpr (!Layout::is_level_order) {
+      update_path(i);
+      return;
+    }
+
     const size_t child_1 = left_data_child(i);
     const size_t child_2 = child_1 + 1;
     assert(child_2 == right_data_child(i));
@@ -209,6 +407,100 @@ class mapped_segment_tree : private Reducer, private Mapper {
     }
   }
 
+  // Recomputes the node, which is a parent of data, and its ancestors. Storage
+  // indexes of the ancestors and their siblings are computed at once instead
+  // of computing the layout position for every node.
+  // Time complexity - O(log n).
+  void update_path(size_t i) {
+    const size_t data_size = data_.size();
+    const size_t tree_size = this->tree_size();
+    const auto& reduce = reducer();
+    const auto& map = mapper();
+
+    std::array<size_t, std::numeric_limits<size_t>::digits> positions;
+    std::array<size_t, std::numeric_limits<size_t>::digits> siblings;
+    size_t depth = Layout::ancestor_positions(i, shift_, positions.data(),
+                                              siblings.data());
+
+    const size_t child_1 = left_data_child(i);
+    const size_t child_2 = child_1 + 1;
+    if (child_2 < data_size) {
+      tree_[positions[depth]] =
+          reduce(map(data_[child_1]), map(data_[child_2]));
+    } else {
+      assert(child_1 < data_size);
+      tree_[positions[depth]] = map(data_[child_1]);
+    }
+
+    while (depth != 0) {
+      const size_t position = positions[depth];
+      const size_t sibling = siblings[depth];
+      tree_reference value = tree_[positions[depth - 1]];
+      if (is_right_child(i)) {
+        value = reduce(tree_[sibling], tree_[position]);
+      } else if (i + 1 < tree_size) {
+        value = reduce(tree_[position], tree_[sibling]);
+      } else {
+        value = tree_[position];
+      }
+      i = parent(i);
+      --depth;
+    }
+  }
+
+  // Recomputes the node from its data children.
+  // Time complexity - O(1).
+  void update_data_node(size_t i) {
+    const size_t data_size = data_.size();
+    const auto& map = mapper();
+    const size_t child_1 = left_data_child(i);
+    const size_t child_2 = child_1 + 1;
+    assert(child_2 == right_data_child(i));
+    if (child_2 < data_size) {
+      node(i) = reducer()(map(data_[child_1]), map(data_[child_2]));
+    } else {
+      assert(child_1 < data_size);
+      node(i) = map(data_[child_1]);
+    }
+  }
+
+  // Recomputes the node from its children.
+  // Time complexity - O(1).
+  void update_node(size_t i) {
+    const size_t tree_size = this->tree_size();
+    const size_t child_1 = left_child(i);
+    const size_t child_2 = child_1 + 1;
+    assert(child_2 == right_child(i));
+    if (child_2 < tree_size) {
+      node(i) = reducer()(node(child_1), node(child_2));
+    } else {
+      assert(child_1 < tree_size);
+      node(i) = node(child_1);
+    }
+  }
+
+  // Recomputes the sorted nodes, which are parents of data, and all their
+  // ancestors. Each node is recomputed once.
+  // Time complexity - O(k + m) where m is the number of distinct ancestors.
+  void update_ancestors(std::vector<size_t>& nodes) {
+    for (const size_t node : nodes) {
+      update_data_node(node);
+    }
+    while (!nodes.empty() && nodes.front() != 0) {
+      size_t count = 0;
+      for (const size_t node : nodes) {
+        const size_t parent_node = parent(node);
+        if (count == 0 || nodes[count - 1] != parent_node) {
+          nodes[count++] = parent_node;
+        }
+      }
+      nodes.resize(count);
+      for (const size_t node : nodes) {
+        update_node(node);
+      }
+    }
+  }
+
   // Time complexity - O(min(n, k log n)) where k is (last_index - first_index).
   void update_range(size_t first_index, size_t last_index) {
     assert(first_index <= last_index);
@@ -224,33 +516,26 @@ class mapped_segment_tree : private Reducer, private Mapper {
     }
   }
 
-  // Make a query on [first_index, last_index) segment.
+  // Make a query on [first_index, last_index) segment. The first element or
+  // node of a level is taken if it is a right child and the last one is taken
+  // if it is a left child, then the segment is covered by the parents of the
+  // rest. Both nodes exist while first_index < last_index, so they are taken
+  // without branches.
   // Time complexity - O(log n).
   tree_value_type query_impl(size_t first_index, size_t last_index) const {
     assert(first_index <= last_index);
     assert(last_index <= data_.size());
 
-    const auto& reduce = reducer();
     const auto& map = mapper();
-
-    std::optional<tree_value_type> result;
-    auto add_result = [&](const auto& value) {
-      if (result) {
-        result.emplace(reduce(std::move(*result), value));
-      } else {
-        result.emplace(value);
-      }
-    };
+    details::segment_accumulator<tree_value_type, Reducer> result(reducer());
 
     if (first_index < last_index && first_index % 2 != 0) {
-      assert(first_index < data_.size());
-      add_result(map(data_[first_index]));
+      result.add_left(map(data_[first_index]));
       ++first_index;
     }
 
     if (first_index < last_index && last_index % 2 != 0) {
-      assert(last_index - 1 < data_.size());
-      add_result(map(data_[last_index - 1]));
+      result.add_right(map(data_[last_index - 1]));
       --last_index;
     }
 
@@ -259,30 +544,77 @@ class mapped_segment_tree : private Reducer, private Mapper {
     size_t shift = shift_up(shift_);
 
     while (first_index < last_index) {
-      if (first_index < last_index && is_right_child(shift + first_index)) {
-        assert(shift + first_index < tree_.size());
-        add_result(tree_[shift + first_index]);
-        ++first_index;
-      }
-      if (first_index < last_index && is_left_child(shift + last_index - 1)) {
-        assert(shift + last_index - 1 < tree_.size());
-        add_result(tree_[shift + last_index - 1]);
-        --last_index;
-      }
-      if (first_index + 1 == last_index) {
-        assert(shift + first_index < tree_.size());
-        add_result(tree_[shift + first_index]);
-        break;
-      }
+      const bool take_first = is_right_child(shift + first_index);
+      result.add_left_if(take_first, node(shift + first_index));
+      first_index += take_first;
+
+      const bool take_last = (first_index < last_index) &
+                             is_left_child(shift + last_index - 1);
+      result.add_right_if(take_last, node(shift + last_index - 1));
+      last_index -= take_last;
+
       first_index /= 2;
       last_index /= 2;
       shift /= 2;
     }
 
-    if (!result) {
-      result.emplace();
+    return std::move(result).result();
+  }
+
+  // Number of queries which query_batch() advances in lockstep.
+  static constexpr size_t query_group_size = 16;
+
+  // Number of tree levels which a query passes from the data to the root.
+  size_t query_height() const {
+    size_t height = 1;
+    for (size_t shift = shift_up(shift_); shift != 0; shift = shift_up(shift)) {
+      ++height;
     }
-    return std::move(*result);
+    return height;
+  }
+
+  // Makes the data level of a query on [first_index, last_index) segment
+  // without branches. The indexes of the first and the last elements to
+  // reduce are written with the flags which tell if they are taken.
+  // Time complexity - O(1).
+  void query_data_step(size_t& first_index, size_t& last_index,
+                       size_t& left_element, size_t& take_left_element,
+                       size_t& right_element,
+                       size_t& take_right_element) const {
+    take_left_element = (first_index < last_index) & (first_index % 2);
+    left_element = first_index;
+    first_index += take_left_element;
+
+    take_right_element = (first_index < last_index) & (last_index % 2);
+    right_element = last_index - 1;
+    last_index -= take_right_element;
+
+    first_index /= 2;
+    last_index /= 2;
+  }
+
+  // Makes one tree level of a query on [first_index, last_index) segment
+  // without branches. Indexes of the nodes to reduce are appended to
+  // left_nodes and right_nodes in the same order as query_impl() reduces
+  // them.
+  // Time complexity - O(1).
+  void query_step(size_t& first_index, size_t& last_index, size_t shift,
+                  size_t* left_nodes, size_t& left_count, size_t* right_nodes,
+                  size_t& right_count) const {
+    const size_t take_first =
+        (first_index < last_index) & is_right_child(shift + first_index);
+    left_nodes[left_count] = shift + first_index;
+    left_count += take_first;
+    first_index += take_first;
+
+    const size_t take_last =
+        (first_index < last_index) & is_left_child(shift + last_index - 1);
+    right_nodes[right_count] = shift + last_index - 1;
+    right_count += take_last;
+    last_index -= take_last;
+
+    first_index /= 2;
+    last_index /= 2;
   }
 
  public:
@@ -319,6 +651,20 @@ class mapped_segment_tree : private Reducer, private Mapper {
     build_tree();
   }
 
+  // Builds the tree on policy.threads threads.
+  // Time complexity - O(n / threads + threads).
+  template <typename InputIt, typename = details::require_input_iter<InputIt>>
+  mapped_segment_tree(parallel_build policy, InputIt first, InputIt last,
+                      Reducer reducer = {}, Mapper mapper = {},
+                      const Allocator& allocator = {},
+                      const TreeAllocator& tree_allocator = {})
+      : Reducer(std::move(reducer)),
+        Mapper(std::move(mapper)),
+        data_(first, last, allocator),
+        tree_(tree_allocator) {
+    build_tree(policy.threads);
+  }
+
   // Time complexity - O(n).
   mapped_segment_tree(const mapped_segment_tree& other,
                       const Allocator& allocator = {},
@@ -330,8 +676,15 @@ class mapped_segment_tree : private Reducer, private Mapper {
     build_tree();
   }
 
-  mapped_segment_tree(mapped_segment_tree&& other,
-                      const Allocator& allocator = {},
+  // Allocators are moved too, so the elements are never copied.
+  mapped_segment_tree(mapped_segment_tree&& other) noexcept
+      : Reducer(std::move(other).reducer()),
+        Mapper(std::move(other).mapper()),
+        data_(std::move(other.data_)),
+        tree_(std::move(other.tree_)),
+        shift_(other.shift_) {}
+
+  mapped_segment_tree(mapped_segment_tree&& other, const Allocator& allocator,
                       const TreeAllocator& tree_allocator = {}) noexcept
       : Reducer(std::move(other).reducer()),
         Mapper(std::move(other).mapper()),
@@ -374,10 +727,13 @@ class mapped_segment_tree : private Reducer, private Mapper {
     return *this;
   }
 
-  // Time complexity - O(n). Can be reduced to O(1) with dynamic_segment_tree.
+  // Every level is filled with one value, so the mapper and the reducer are
+  // called O(log n) times.
+  // Time complexity - O(n), see dynamic_segment_tree for O(log n).
   void assign(size_type count, const T& value) {
     data_.assign(count, value);
-    rebuild_tree();
+    tree_.clear();
+    build_uniform_tree();
   }
 
   // Time complexity - O(n).
@@ -390,6 +746,14 @@ class mapped_segment_tree : private Reducer, private Mapper {
   // Time complexity - O(n).
   void assign(std::initializer_list<T> init_list) { operator=(init_list); }
 
+  // Builds the tree on policy.threads threads.
+  // Time complexity - O(n / threads + threads).
+  template <class InputIt, typename = details::require_input_iter<InputIt>>
+  void assign(parallel_build policy, InputIt first, InputIt last) {
+    data_.assign(first, last);
+    rebuild_tree(policy.threads);
+  }
+
   // Time complexity - O(1).
   [[nodiscard]] allocator_type get_allocator() const noexcept {
     return data_.get_allocator();
@@ -480,13 +844,63 @@ class mapped_segment_tree : private Reducer, private Mapper {
   // Time complexity - O(1).
   [[nodiscard]] size_type max_size() const noexcept { return data_.max_size(); }
 
+  // Returns the number of bytes allocated for the elements and the nodes.
+  // Time complexity - O(1).
+  [[nodiscard]] size_t bytes_used() const noexcept {
+    return data_.capacity() * sizeof(T) +
+           tree_.capacity() * sizeof(tree_value_type);
+  }
+
   // Time complexity - O(n).
   void clear() noexcept {
     data_.clear();
     tree_.clear();
+    shift_ = 0;
     assert(empty());
   }
 
+  // Appends the element. The number of data leaves is doubled when all of
+  // them are used, so only ancestors of the new element are updated
+  // otherwise.
+  // Time complexity - O(log n) amortized.
+  template <typename... Args>
+  const_reference emplace_back(Args&&... args) {
+    const bool full = !data_.empty() && data_.size() == shift_ + 1;
+    data_.emplace_back(std::forward<Args>(args)...);
+    if (full) {
+      grow_tree();
+    } else if constexpr (Layout::is_level_order) {
+      tree_.resize(tree_size());
+    }
+    update(data_.size() - 1);
+    return data_.back();
+  }
+
+  // Time complexity - O(log n) amortized.
+  void push_back(const T& value) { emplace_back(value); }
+
+  // Time complexity - O(log n) amortized.
+  void push_back(T&& value) { emplace_back(std::move(value)); }
+
+  // Removes the last element. The number of data leaves is halved when only
+  // a quarter of them are used.
+  // Time complexity - O(log n) amortized.
+  void pop_back() {
+    assert(!empty());
+    data_.pop_back();
+    const size_t n = data_.size();
+    if (n == 0) {
+      clear();
+    } else if (n == (shift_ + 1) / 4) {
+      shrink_tree();
+    } else {
+      if constexpr (Layout::is_level_order) {
+        tree_.resize(tree_size());
+      }
+      update(n - 1);
+    }
+  }
+
   // Time complexity - O(n).
   const_iterator insert(const_iterator pos, const T& value) {
     scoped_rebuild scoped{this};
@@ -540,7 +954,7 @@ class mapped_segment_tree : private Reducer, private Mapper {
 
   // Time complexity - O(n).
   void resize(size_type count) {
-    data_.resize(count);
+    data_.resize(count, T{});
     rebuild_tree();
   }
 
@@ -558,6 +972,30 @@ class mapped_segment_tree : private Reducer, private Mapper {
     update(index);
   }
 
+  // Rewrites elements given as (index, value) pairs. If an index repeats, the
+  // last value is kept. Each affected node is recomputed once.
+  // Time complexity - O(k log k + m) where k is std::distance(first, last)
+  // and m is the number of distinct ancestors of the updated elements.
+  template <typename InputIt>
+  void update_batch(InputIt first, InputIt last) {
+    std::vector<size_t> nodes;
+    for (; first != last; ++first) {
+      const auto& [index, value] = *first;
+      assert(index < data_.size());
+      data_[index] = value;
+      nodes.push_back(index);
+    }
+    if (tree_.empty()) {
+      return;
+    }
+    for (auto& node : nodes) {
+      node = parent_of_data(node);
+    }
+    std::sort(nodes.begin(), nodes.end());
+    nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+    update_ancestors(nodes);
+  }
+
   // Make a query on [first_index, last_index) segment.
   // Time complexity - O(log n).
   [[nodiscard]] tree_value_type query(size_t first_index,
@@ -565,76 +1003,295 @@ class mapped_segment_tree : private Reducer, private Mapper {
     return query_impl(first_index, last_index);
   }
 
+  // Makes queries on [first_index, last_index) segments, which are given as
+  // pairs, and writes their results to d_first. Queries are advanced in
+  // groups one level at a time without branches, and the nodes of the next
+  // level are prefetched, so the cache misses of the group overlap.
+  // Time complexity - O(k log n) where k is std::distance(first, last).
+  template <typename InputIt, typename OutputIt>
+  OutputIt query_batch(InputIt first, InputIt last, OutputIt d_first) const {
+    const auto& reduce = reducer();
+    const auto& map = mapper();
+    const size_t height = query_height();
+
+    std::array<size_t, query_group_size> first_indexes;
+    std::array<size_t, query_group_size> last_indexes;
+    std::array<size_t, query_group_size> left_elements;
+    std::array<size_t, query_group_size> take_left_elements;
+    std::array<size_t, query_group_size> right_elements;
+    std::array<size_t, query_group_size> take_right_elements;
+    std::array<size_t, query_group_size> left_counts;
+    std::array<size_t, query_group_size> right_counts;
+    std::vector<size_t> left_nodes(query_group_size * height);
+    std::vector<size_t> right_nodes(query_group_size * height);
+
+    while (first != last) {
+      size_t group_size = 0;
+      for (; first != last && group_size != query_group_size; ++first) {
+        const auto& [first_index, last_index] = *first;
+        assert(first_index <= last_index);
+        assert(last_index <= data_.size());
+        first_indexes[group_size] = first_index;
+        last_indexes[group_size] = last_index;
+        left_counts[group_size] = 0;
+        right_counts[group_size] = 0;
+        ++group_size;
+        if (first_index < last_index) {
+          details::prefetch(data_.data() + first_index);
+          details::prefetch(data_.data() + last_index - 1);
+        }
+      }
+
+      size_t shift = shift_up(shift_);
+      for (size_t i = 0; i != group_size; ++i) {
+        query_data_step(first_indexes[i], last_indexes[i], left_elements[i],
+                        take_left_elements[i], right_elements[i],
+                        take_right_elements[i]);
+        if (first_indexes[i] < last_indexes[i]) {
+          prefetch_node(shift + first_indexes[i]);
+          prefetch_node(shift + last_indexes[i] - 1);
+        }
+      }
+
+      for (size_t level = 0; level != height; ++level) {
+        for (size_t i = 0; i != group_size; ++i) {
+          query_step(first_indexes[i], last_indexes[i], shift,
+                     left_nodes.data() + i * height, left_counts[i],
+                     right_nodes.data() + i * height, right_counts[i]);
+          if (first_indexes[i] < last_indexes[i]) {
+            const size_t next_shift = shift_up(shift);
+            prefetch_node(next_shift + first_indexes[i]);
+            prefetch_node(next_shift + last_indexes[i] - 1);
+          }
+        }
+        shift = shift_up(shift);
+      }
+
+      for (size_t i = 0; i != group_size; ++i) {
+        details::segment_accumulator<tree_value_type, Reducer> result(reduce);
+        if (take_left_elements[i]) {
+          result.add_left(map(data_[left_elements[i]]));
+        }
+        if (take_right_elements[i]) {
+          result.add_right(map(data_[right_elements[i]]));
+        }
+        for (size_t j = 0; j != left_counts[i]; ++j) {
+          result.add_left(node(left_nodes[i * height + j]));
+        }
+        for (size_t j = 0; j != right_counts[i]; ++j) {
+          result.add_right(node(right_nodes[i * height + j]));
+        }
+        *d_first++ = std::move(result).result();
+      }
+    }
+    return d_first;
+  }
+
+  // Returns the largest last_index such that pred(query(first_index,
+  // last_index)) is true, the empty segment is always accepted. pred must be
+  // monotone: once it is false for a segment, it is false for all the longer
+  // segments starting at first_index. Nodes are visited once up and once down
+  // the tree.
+  // Time complexity - O(log n).
+  template <typename Predicate>
+  [[nodiscard]] size_t max_right(size_t first_index, Predicate pred) const {
+    assert(first_index <= size());
+    if (first_index == size()) {
+      return first_index;
+    }
+    const auto& reduce = reducer();
+    std::optional<tree_value_type> sum;
+    auto append = [&](const tree_value_type& value) {
+      return sum ? reduce(*sum, value) : value;
+    };
+
+    // The node shift + index covers [index << height, (index + 1) << height).
+    size_t shift = shift_;
+    size_t index = first_index;
+    size_t height = 0;
+    // Only nodes that lie entirely within [0, size()) are read, the others
+    // are partial and hold no meaningful value.
+    for (;;) {
+      while (index % 2 == 0 && shift != 0 &&
+             ((index + 2) << height) <= size()) {
+        index /= 2;
+        shift = shift_up(shift);
+        ++height;
+      }
+      while (((index + 1) << height) > size()) {
+        shift = left_child(shift);
+        index *= 2;
+        --height;
+      }
+      tree_value_type next = append(node_or_element(shift + index));
+      if (!pred(next)) {
+        break;
+      }
+      sum.emplace(std::move(next));
+      ++index;
+      if ((index << height) >= size()) {
+        return size();
+      }
+    }
+    // The left child of the rejected node always covers some elements, and
+    // the right child is visited only if it makes the node rejected.
+    while (shift != shift_) {
+      shift = left_child(shift);
+      index *= 2;
+      tree_value_type next = append(node_or_element(shift + index));
+      if (pred(next)) {
+        sum.emplace(std::move(next));
+        ++index;
+      }
+    }
+    return index;
+  }
+
+  // Returns the smallest first_index such that pred(query(first_index,
+  // last_index)) is true, the empty segment is always accepted. pred must be
+  // monotone: once it is false for a segment, it is false for all the longer
+  // segments ending at last_index.
+  // Time complexity - O(log n).
+  template <typename Predicate>
+  [[nodiscard]] size_t min_left(size_t last_index, Predicate pred) const {
+    assert(last_index <= size());
+    if (last_index == 0) {
+      return 0;
+    }
+    const auto& reduce = reducer();
+    std::optional<tree_value_type> sum;
+    auto prepend = [&](const tree_value_type& value) {
+      return sum ? reduce(value, *sum) : value;
+    };
+
+    // The node shift + index covers [index << height, (index + 1) << height).
+    size_t shift = shift_;
+    size_t index = last_index;
+    size_t height = 0;
+    for (;;) {
+      --index;
+      while (index % 2 != 0) {
+        index /= 2;
+        shift = shift_up(shift);
+        ++height;
+      }
+      tree_value_type next = prepend(node_or_element(shift + index));
+      if (!pred(next)) {
+        break;
+      }
+      sum.emplace(std::move(next));
+      if (index == 0) {
+        return 0;
+      }
+    }
+    while (shift != shift_) {
+      shift = left_child(shift);
+      index = index * 2 + 1;
+      tree_value_type next = prepend(node_or_element(shift + index));
+      if (pred(next)) {
+        sum.emplace(std::move(next));
+        --index;
+      }
+    }
+    return index + 1;
+  }
+
+  // Returns the first index where the prefix sum reaches value, that is the
+  // smallest i such that query(0, i + 1) >= value, or size() if there is no
+  // such index. The elements must be non-negative.
+  // Time complexity - O(log n).
+  [[nodiscard]] size_t lower_bound_prefix(const tree_value_type& value) const {
+    static_assert(std::is_same_v<Reducer, std::plus<tree_value_type>> ||
+                      std::is_same_v<Reducer, std::plus<>>,
+                  "lower_bound_prefix() requires std::plus");
+    return max_right(
+        0, [&](const tree_value_type& sum) { return sum < value; });
+  }
+
   // Time complexity - O(min(n, k log n)) where k is (last_index - first_index).
   void update_range(const_iterator first, const_iterator last) {
     update_range(std::distance(data_.cbegin(), first),
                  std::distance(data_.cbegin(), last));
   }
 
-  template <typename T1, typename T2, typename R, typename M, typename A>
-  friend bool operator==(const mapped_segment_tree<T1, R, M, A>& lhs,
-                         const mapped_segment_tree<T2, R, M, A>& rhs);
+  friend struct details::file_access;
+
+  template <typename T1, typename T2, typename R, typename M, typename A,
+            typename TA, typename L, typename S>
+  friend bool operator==(const mapped_segment_tree<T1, R, M, A, TA, L, S>& lhs,
+                         const mapped_segment_tree<T2, R, M, A, TA, L, S>& rhs);
 
-  template <typename T1, typename T2, typename R, typename M, typename A>
-  friend bool operator!=(const mapped_segment_tree<T1, R, M, A>& lhs,
-                         const mapped_segment_tree<T2, R, M, A>& rhs);
+  template <typename T1, typename T2, typename R, typename M, typename A,
+            typename TA, typename L, typename S>
+  friend bool operator!=(const mapped_segment_tree<T1, R, M, A, TA, L, S>& lhs,
+                         const mapped_segment_tree<T2, R, M, A, TA, L, S>& rhs);
 
-  template <typename T1, typename T2, typename R, typename M, typename A>
-  friend bool operator<(const mapped_segment_tree<T1, R, M, A>& lhs,
-                        const mapped_segment_tree<T2, R, M, A>& rhs);
+  template <typename T1, typename T2, typename R, typename M, typename A,
+            typename TA, typename L, typename S>
+  friend bool operator<(const mapped_segment_tree<T1, R, M, A, TA, L, S>& lhs,
+                        const mapped_segment_tree<T2, R, M, A, TA, L, S>& rhs);
 
-  template <typename T1, typename T2, typename R, typename M, typename A>
-  friend bool operator<=(const mapped_segment_tree<T1, R, M, A>& lhs,
-                         const mapped_segment_tree<T2, R, M, A>& rhs);
+  template <typename T1, typename T2, typename R, typename M, typename A,
+            typename TA, typename L, typename S>
+  friend bool operator<=(const mapped_segment_tree<T1, R, M, A, TA, L, S>& lhs,
+                         const mapped_segment_tree<T2, R, M, A, TA, L, S>& rhs);
 
-  template <typename T1, typename T2, typename R, typename M, typename A>
-  friend bool operator>(const mapped_segment_tree<T1, R, M, A>& lhs,
-                        const mapped_segment_tree<T2, R, M, A>& rhs);
+  template <typename T1, typename T2, typename R, typename M, typename A,
+            typename TA, typename L, typename S>
+  friend bool operator>(const mapped_segment_tree<T1, R, M, A, TA, L, S>& lhs,
+                        const mapped_segment_tree<T2, R, M, A, TA, L, S>& rhs);
 
-  template <typename T1, typename T2, typename R, typename M, typename A>
-  friend bool operator>=(const mapped_segment_tree<T1, R, M, A>& lhs,
-                         const mapped_segment_tree<T2, R, M, A>& rhs);
+  template <typename T1, typename T2, typename R, typename M, typename A,
+            typename TA, typename L, typename S>
+  friend bool operator>=(const mapped_segment_tree<T1, R, M, A, TA, L, S>& lhs,
+                         const mapped_segment_tree<T2, R, M, A, TA, L, S>& rhs);
 
  private:
   std::vector<value_type, allocator_type> data_;
 
-  std::vector<tree_value_type, tree_allocator_type> tree_;
+  tree_container_type tree_;
   size_t shift_ = 0;
 };
 
-template <typename T1, typename T2, typename R, typename M, typename A>
-bool operator==(const mapped_segment_tree<T1, R, M, A>& lhs,
-                const mapped_segment_tree<T2, R, M, A>& rhs) {
+template <typename T1, typename T2, typename R, typename M, typename A,
+          typename TA, typename L, typename S>
+bool operator==(const mapped_segment_tree<T1, R, M, A, TA, L, S>& lhs,
+                const mapped_segment_tree<T2, R, M, A, TA, L, S>& rhs) {
   return lhs.data_ == rhs.data_;
 }
 
-template <typename T1, typename T2, typename R, typename M, typename A>
-bool operator!=(const mapped_segment_tree<T1, R, M, A>& lhs,
-                const mapped_segment_tree<T2, R, M, A>& rhs) {
+template <typename T1, typename T2, typename R, typename M, typename A,
+          typename TA, typename L, typename S>
+bool operator!=(const mapped_segment_tree<T1, R, M, A, TA, L, S>& lhs,
+                const mapped_segment_tree<T2, R, M, A, TA, L, S>& rhs) {
   return lhs.data_ != rhs.data_;
 }
 
-template <typename T1, typename T2, typename R, typename M, typename A>
-bool operator<(const mapped_segment_tree<T1, R, M, A>& lhs,
-               const mapped_segment_tree<T2, R, M, A>& rhs) {
+template <typename T1, typename T2, typename R, typename M, typename A,
+          typename TA, typename L, typename S>
+bool operator<(const mapped_segment_tree<T1, R, M, A, TA, L, S>& lhs,
+               const mapped_segment_tree<T2, R, M, A, TA, L, S>& rhs) {
   return lhs.data_ < rhs.data_;
 }
 
-template <typename T1, typename T2, typename R, typename M, typename A>
-bool operator<=(const mapped_segment_tree<T1, R, M, A>& lhs,
-                const mapped_segment_tree<T2, R, M, A>& rhs) {
+template <typename T1, typename T2, typename R, typename M, typename A,
+          typename TA, typename L, typename S>
+bool operator<=(const mapped_segment_tree<T1, R, M, A, TA, L, S>& lhs,
+                const mapped_segment_tree<T2, R, M, A, TA, L, S>& rhs) {
   return lhs.data_ <= rhs.data_;
 }
 
-template <typename T1, typename T2, typename R, typename M, typename A>
-bool operator>(const mapped_segment_tree<T1, R, M, A>& lhs,
-               const mapped_segment_tree<T2, R, M, A>& rhs) {
+template <typename T1, typename T2, typename R, typename M, typename A,
+          typename TA, typename L, typename S>
+bool operator>(const mapped_segment_tree<T1, R, M, A, TA, L, S>& lhs,
+               const mapped_segment_tree<T2, R, M, A, TA, L, S>& rhs) {
   return lhs.data_ > rhs.data_;
 }
 
-template <typename T1, typename T2, typename R, typename M, typename A>
-bool operator>=(const mapped_segment_tree<T1, R, M, A>& lhs,
-                const mapped_segment_tree<T2, R, M, A>& rhs) {
+template <typename T1, typename T2, typename R, typename M, typename A,
+          typename TA, typename L, typename S>
+bool operator>=(const mapped_segment_tree<T1, R, M, A, TA, L, S>& lhs,
+                const mapped_segment_tree<T2, R, M, A, TA, L, S>& rhs) {
   return lhs.data_ >= rhs.data_;
 }
 
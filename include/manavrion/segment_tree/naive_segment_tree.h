@@ -3,12 +3,12 @@
 // This file is part of the segment_tree header-only library.
 //
 
+#pragma once
 #include <cassert>
 #include <cmath>
 #include <functional>
 #include <memory>
 #include <numeric>
-#include <optional>
 #include <type_traits>
 #include <vector>
 
@@ -296,23 +296,16 @@ class naive_segment_tree {
     assert(first_index <= last_index);
     assert(last_index <= data_.size());
 
-    std::optional<T> result;
-    auto add_result = [&](const auto& value) {
-      if (result) {
-        result.emplace(reducer_(std::move(*result), value));
-      } else {
-        result.emplace(value);
-      }
-    };
-
-    for (size_t i = first_index; i < last_index; ++i) {
-      add_result(data_[i]);
+    // The elements are reduced from left to right without the identity, so
+    // the trees are not checked against their own accumulator.
+    if (first_index == last_index) {
+      return details::empty_result<Reducer, T>();
     }
-
-    if (!result) {
-      result.emplace();
+    T result = data_[first_index];
+    for (size_t i = first_index + 1; i < last_index; ++i) {
+      result = reducer_(std::move(result), data_[i]);
     }
-    return std::move(*result);
+    return result;
   }
 
   void update_range(const_iterator, const_iterator) {}
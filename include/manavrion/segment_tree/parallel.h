@@ -0,0 +1,76 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace manavrion::segment_tree {
+
+// Requests to build a tree on the given number of threads, which is rounded
+// down to a power of two. Each thread builds a contiguous subtree, and the
+// top levels above the subtrees are built serially. The reducer and the
+// mapper are called concurrently.
+struct parallel_build {
+  parallel_build()
+      : threads(std::max<size_t>(1, std::thread::hardware_concurrency())) {}
+
+  explicit parallel_build(size_t threads)
+      : threads(std::max<size_t>(1, threads)) {}
+
+  size_t threads;
+};
+
+namespace details {
+
+// Calls f(i) for i in [0, count), each call is made on its own thread, the
+// last one is made on the calling thread. If a thread cannot be created, the
+// remaining calls are made on the calling thread, so the started threads are
+// always joined. The first exception thrown by a call is rethrown after all
+// the calls are finished.
+template <typename F>
+void parallel_for(size_t count, const F& f) {
+  if (count == 0) {
+    return;
+  }
+  std::vector<std::exception_ptr> errors(count);
+  auto run = [&](size_t i) {
+    try {
+      f(i);
+    } catch (...) {
+      errors[i] = std::current_exception();
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(count - 1);
+  size_t i = 0;
+  for (; i + 1 < count; ++i) {
+    try {
+      threads.emplace_back(run, i);
+    } catch (...) {
+      break;
+    }
+  }
+  for (; i < count; ++i) {
+    run(i);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (const auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+}  // namespace details
+
+}  // namespace manavrion::segment_tree
@@ -0,0 +1,234 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#pragma once
+#include <cassert>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "manavrion/segment_tree/details.h"
+
+namespace manavrion::segment_tree {
+
+// Segment tree which keeps all its versions.
+//
+// The version 0 is the initial sequence, every update creates a new version
+// by copying the O(log n) nodes on the path from the root to the element, the
+// other nodes are shared with the version it was made from. Nodes are created
+// in a bump arena, so a new version allocates memory only when a block of
+// the arena is full, and all the nodes are freed with the tree.
+template <typename T, typename Reducer = std::plus<T>,
+          typename Allocator = std::allocator<T>>
+class persistent_segment_tree : private Reducer {
+ public:
+  using allocator_type = Allocator;
+  using value_type = T;
+  using size_type = size_t;
+  using difference_type = std::ptrdiff_t;
+  using const_reference = const T&;
+
+  using reducer_type = Reducer;
+
+ private:
+  struct node {
+    T value;
+    const node* left = nullptr;
+    const node* right = nullptr;
+  };
+
+  const Reducer& reducer() const { return *static_cast<const Reducer*>(this); }
+
+  // Creates nodes over [first, last) elements.
+  // Time complexity - O(k) where k is (last - first).
+  const node* build(const T* first, const T* last) {
+    assert(first < last);
+    if (last - first == 1) {
+      return arena_.create(node{*first});
+    }
+    const T* middle = first + (last - first) / 2;
+    const node* left = build(first, middle);
+    const node* right = build(middle, last);
+    return arena_.create(
+        node{reducer()(left->value, right->value), left, right});
+  }
+
+  template <typename InputIt>
+  void init_tree(InputIt first, InputIt last) {
+    const std::vector<T> elements(first, last);
+    size_ = elements.size();
+    roots_.push_back(size_ == 0 ? nullptr
+                                : build(elements.data(),
+                                        elements.data() + elements.size()));
+  }
+
+  // Copies the path from the root to the index element.
+  // Time complexity - O(log n).
+  template <typename V>
+  const node* update_path(const node* root, size_t first, size_t last,
+                          size_t index, V&& v) {
+    if (last - first == 1) {
+      return arena_.create(node{T(std::forward<V>(v))});
+    }
+    const size_t middle = first + (last - first) / 2;
+    const node* left = root->left;
+    const node* right = root->right;
+    if (index < middle) {
+      left = update_path(left, first, middle, index, std::forward<V>(v));
+    } else {
+      right = update_path(right, middle, last, index, std::forward<V>(v));
+    }
+    return arena_.create(
+        node{reducer()(left->value, right->value), left, right});
+  }
+
+  // Reduces nodes of [first_index, last_index) segment from the left to the
+  // right into result.
+  // Time complexity - O(log n).
+  void query_impl(const node* root, size_t first, size_t last,
+                  size_t first_index, size_t last_index,
+                  std::optional<T>& result) const {
+    if (first_index <= first && last <= last_index) {
+      if (result) {
+        result.emplace(reducer()(std::move(*result), root->value));
+      } else {
+        result.emplace(root->value);
+      }
+      return;
+    }
+    const size_t middle = first + (last - first) / 2;
+    if (first_index < middle) {
+      query_impl(root->left, first, middle, first_index, last_index, result);
+    }
+    if (middle < last_index) {
+      query_impl(root->right, middle, last, first_index, last_index, result);
+    }
+  }
+
+ public:
+  explicit persistent_segment_tree(Reducer reducer = {},
+                                   const Allocator& allocator = {})
+      : Reducer(std::move(reducer)), arena_(allocator) {
+    roots_.push_back(nullptr);
+  }
+
+  // Time complexity - O(n).
+  template <typename InputIt, typename = details::require_input_iter<InputIt>>
+  persistent_segment_tree(InputIt first, InputIt last, Reducer reducer = {},
+                          const Allocator& allocator = {})
+      : Reducer(std::move(reducer)), arena_(allocator) {
+    init_tree(first, last);
+  }
+
+  // Time complexity - O(n).
+  persistent_segment_tree(std::initializer_list<T> init_list,
+                          Reducer reducer = {}, const Allocator& allocator = {})
+      : Reducer(std::move(reducer)), arena_(allocator) {
+    init_tree(init_list.begin(), init_list.end());
+  }
+
+  // Versions share nodes, so the tree is only movable.
+  persistent_segment_tree(persistent_segment_tree&& other) noexcept = default;
+  persistent_segment_tree& operator=(persistent_segment_tree&& other) noexcept =
+      default;
+
+  // Time complexity - O(1).
+  [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+
+  // Time complexity - O(1).
+  [[nodiscard]] size_type size() const noexcept { return size_; }
+
+  // Returns the number of versions, the latest version is versions() - 1.
+  // Time complexity - O(1).
+  [[nodiscard]] size_t versions() const noexcept { return roots_.size(); }
+
+  // Returns the number of bytes allocated for the nodes of all the versions.
+  // Time complexity - O(b) where b is the number of arena blocks.
+  [[nodiscard]] size_t bytes_used() const noexcept {
+    return arena_.bytes_used() + roots_.capacity() * sizeof(const node*);
+  }
+
+  // Makes sure the next count updates do not allocate memory.
+  void reserve(size_t count) {
+    size_t path = 1;
+    for (size_t n = size_; n > 1; n = (n + 1) / 2) {
+      ++path;
+    }
+    arena_.reserve(count * path);
+    roots_.reserve(roots_.size() + count);
+  }
+
+  // Time complexity - O(log n).
+  [[nodiscard]] const_reference at(size_t version, size_type pos) const {
+    if (version >= versions() || pos >= size()) {
+      throw std::out_of_range("persistent_segment_tree::at");
+    }
+    const node* root = roots_[version];
+    for (size_t first = 0, last = size_; last - first != 1;) {
+      const size_t middle = first + (last - first) / 2;
+      if (pos < middle) {
+        root = root->left;
+        last = middle;
+      } else {
+        root = root->right;
+        first = middle;
+      }
+    }
+    return root->value;
+  }
+
+  // Creates a new version from the version where the index element is
+  // replaced, and returns the new version.
+  // Time complexity - O(log n).
+  template <typename V>
+  size_t update(size_t version, size_t index, V&& v) {
+    assert(version < versions());
+    assert(index < size());
+    roots_.push_back(
+        update_path(roots_[version], 0, size_, index, std::forward<V>(v)));
+    return roots_.size() - 1;
+  }
+
+  // Creates a new version from the latest one, and returns it.
+  // Time complexity - O(log n).
+  template <typename V>
+  size_t update(size_t index, V&& v) {
+    return update(versions() - 1, index, std::forward<V>(v));
+  }
+
+  // Make a query on [first_index, last_index) segment of the version.
+  // Time complexity - O(log n).
+  [[nodiscard]] T query(size_t version, size_t first_index,
+                        size_t last_index) const {
+    assert(version < versions());
+    assert(first_index <= last_index);
+    assert(last_index <= size());
+    std::optional<T> result;
+    if (first_index < last_index) {
+      query_impl(roots_[version], 0, size_, first_index, last_index, result);
+    }
+    if (result) {
+      return std::move(*result);
+    }
+    return details::empty_result<Reducer, T>();
+  }
+
+  // Make a query on [first_index, last_index) segment of the latest version.
+  // Time complexity - O(log n).
+  [[nodiscard]] T query(size_t first_index, size_t last_index) const {
+    return query(versions() - 1, first_index, last_index);
+  }
+
+ private:
+  details::bump_arena<node, Allocator> arena_;
+  std::vector<const node*> roots_;
+  size_t size_ = 0;
+};
+
+}  // namespace manavrion::segment_tree
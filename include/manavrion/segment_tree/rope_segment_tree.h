@@ -0,0 +1,528 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "manavrion/segment_tree/details.h"
+
+namespace manavrion::segment_tree {
+
+// Segment tree over a sequence with O(log n) insertion and removal anywhere.
+//
+// Elements are kept in a treap with implicit keys: the in-order traversal is
+// the sequence, every node stores the size and the reduction of its subtree,
+// and random priorities keep the expected depth O(log n). Nodes are stored in
+// a vector and refer to each other by 32-bit indexes, removed nodes are
+// reused. Ropes made by split() share the pool of nodes, so split() and
+// concat() of such ropes only relink O(log n) nodes. Ropes which share a pool
+// must not be modified concurrently.
+template <typename T, typename Reducer = std::plus<T>,
+          typename Allocator = std::allocator<T>>
+class rope_segment_tree : private Reducer {
+ public:
+  using allocator_type = Allocator;
+  using value_type = T;
+  using size_type = size_t;
+  using difference_type = std::ptrdiff_t;
+  using const_reference = const T&;
+
+  using reducer_type = Reducer;
+
+ private:
+  using index_type = uint32_t;
+  static constexpr index_type null = std::numeric_limits<index_type>::max();
+
+  struct node {
+    T value;
+    T sum;
+    index_type size;
+    index_type left;
+    index_type right;
+    uint32_t priority;
+  };
+
+  using node_allocator =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<node>;
+
+  struct pool {
+    explicit pool(const Allocator& allocator) : nodes(allocator) {}
+
+    // Xorshift generator of priorities.
+    uint32_t next_priority() noexcept {
+      seed ^= seed << 13;
+      seed ^= seed >> 17;
+      seed ^= seed << 5;
+      return seed;
+    }
+
+    std::vector<node, node_allocator> nodes;
+    std::vector<index_type> free;
+    uint32_t seed = 2463534242;
+  };
+
+  const Reducer& reducer() const { return *static_cast<const Reducer*>(this); }
+
+  node& get(index_type i) { return pool_->nodes[i]; }
+  const node& get(index_type i) const { return pool_->nodes[i]; }
+
+  size_t subtree_size(index_type i) const {
+    return i == null ? 0 : get(i).size;
+  }
+
+  // Creates the node of a single element.
+  // Time complexity - O(1) amortized.
+  index_type create(const T& value) {
+    if (!pool_) {
+      pool_ = std::make_shared<pool>(allocator_);
+    }
+    node n{value, value, 1, null, null, pool_->next_priority()};
+    if (!pool_->free.empty()) {
+      const index_type i = pool_->free.back();
+      pool_->free.pop_back();
+      get(i) = std::move(n);
+      return i;
+    }
+    if (pool_->nodes.size() >= null) {
+      throw std::length_error("rope_segment_tree::create");
+    }
+    // The free list may hold every node, so it grows with the nodes and
+    // destroy() never allocates.
+    if (pool_->nodes.size() == pool_->nodes.capacity()) {
+      const size_t capacity = std::max<size_t>(16, 2 * pool_->nodes.size());
+      pool_->nodes.reserve(capacity);
+      pool_->free.reserve(capacity);
+    }
+    pool_->nodes.push_back(std::move(n));
+    return static_cast<index_type>(pool_->nodes.size() - 1);
+  }
+
+  // Returns nodes of the subtree to the pool. It does not throw, since the
+  // capacity of the free list is at least the number of nodes.
+  // Time complexity - O(k) where k is the size of the subtree.
+  void destroy(index_type root) noexcept {
+    if (root == null) {
+      return;
+    }
+    assert(pool_->free.capacity() >= pool_->nodes.size());
+    const size_t first = pool_->free.size();
+    pool_->free.push_back(root);
+    for (size_t i = first; i < pool_->free.size(); ++i) {
+      const node& n = get(pool_->free[i]);
+      if (n.left != null) {
+        pool_->free.push_back(n.left);
+      }
+      if (n.right != null) {
+        pool_->free.push_back(n.right);
+      }
+    }
+  }
+
+  // Recomputes the size and the reduction of the subtree.
+  // Time complexity - O(1).
+  void pull(index_type i) {
+    const auto& reduce = reducer();
+    node& n = get(i);
+    n.size = 1;
+    n.sum = n.value;
+    if (n.left != null) {
+      const node& left = get(n.left);
+      n.size += left.size;
+      n.sum = reduce(left.sum, n.sum);
+    }
+    if (n.right != null) {
+      const node& right = get(n.right);
+      n.size += right.size;
+      n.sum = reduce(n.sum, right.sum);
+    }
+  }
+
+  // Joins two treaps, all the elements of left go first.
+  // Time complexity - O(log n) expected.
+  index_type merge(index_type left, index_type right) {
+    if (left == null) {
+      return right;
+    }
+    if (right == null) {
+      return left;
+    }
+    if (get(left).priority > get(right).priority) {
+      const index_type child = merge(get(left).right, right);
+      get(left).right = child;
+      pull(left);
+      return left;
+    }
+    const index_type child = merge(left, get(right).left);
+    get(right).left = child;
+    pull(right);
+    return right;
+  }
+
+  // Splits the treap into the first count elements and the rest.
+  // Time complexity - O(log n) expected.
+  std::pair<index_type, index_type> split(index_type root, size_t count) {
+    if (root == null) {
+      return {null, null};
+    }
+    const size_t left_size = subtree_size(get(root).left);
+    if (count <= left_size) {
+      const auto [left, right] = split(get(root).left, count);
+      get(root).left = right;
+      pull(root);
+      return {left, root};
+    }
+    const auto [left, right] = split(get(root).right, count - left_size - 1);
+    get(root).right = left;
+    pull(root);
+    return {root, right};
+  }
+
+  // Creates a treap of [first, last) elements, the rightmost path is kept on
+  // a stack, so every node is pushed and popped once.
+  // Time complexity - O(k) where k is std::distance(first, last).
+  template <typename InputIt>
+  index_type build(InputIt first, InputIt last) {
+    std::vector<index_type> path;
+    for (; first != last; ++first) {
+      const index_type i = create(*first);
+      index_type left = null;
+      while (!path.empty() && get(path.back()).priority < get(i).priority) {
+        left = path.back();
+        path.pop_back();
+        pull(left);
+      }
+      get(i).left = left;
+      if (!path.empty()) {
+        get(path.back()).right = i;
+      }
+      path.push_back(i);
+    }
+    while (path.size() > 1) {
+      pull(path.back());
+      path.pop_back();
+    }
+    if (path.empty()) {
+      return null;
+    }
+    pull(path.back());
+    return path.back();
+  }
+
+  // Reduces elements of [first, last) segment of the subtree from the left to
+  // the right into result.
+  // Time complexity - O(log n) expected.
+  void query_impl(index_type root, size_t first, size_t last,
+                  std::optional<T>& result) const {
+    const auto& reduce = reducer();
+    auto append = [&](const T& value) {
+      if (result) {
+        result.emplace(reduce(std::move(*result), value));
+      } else {
+        result.emplace(value);
+      }
+    };
+
+    const node& n = get(root);
+    if (first == 0 && last == n.size) {
+      append(n.sum);
+      return;
+    }
+    const size_t left_size = subtree_size(n.left);
+    if (first < left_size) {
+      query_impl(n.left, first, std::min(last, left_size), result);
+    }
+    if (first <= left_size && left_size < last) {
+      append(n.value);
+    }
+    if (left_size + 1 < last) {
+      query_impl(n.right, std::max(first, left_size + 1) - left_size - 1,
+                 last - left_size - 1, result);
+    }
+  }
+
+  // Time complexity - O(log n) expected.
+  template <typename V>
+  void update_impl(index_type root, size_t pos, V&& v) {
+    const size_t left_size = subtree_size(get(root).left);
+    if (pos < left_size) {
+      update_impl(get(root).left, pos, std::forward<V>(v));
+    } else if (pos == left_size) {
+      get(root).value = std::forward<V>(v);
+    } else {
+      update_impl(get(root).right, pos - left_size - 1, std::forward<V>(v));
+    }
+    pull(root);
+  }
+
+ public:
+  rope_segment_tree() = default;
+
+  explicit rope_segment_tree(const Allocator& allocator)
+      : allocator_(allocator) {}
+
+  explicit rope_segment_tree(Reducer reducer, const Allocator& allocator = {})
+      : Reducer(std::move(reducer)), allocator_(allocator) {}
+
+  // Time complexity - O(n).
+  template <typename InputIt, typename = details::require_input_iter<InputIt>>
+  rope_segment_tree(InputIt first, InputIt last, Reducer reducer = {},
+                    const Allocator& allocator = {})
+      : Reducer(std::move(reducer)), allocator_(allocator) {
+    root_ = build(first, last);
+  }
+
+  // Time complexity - O(n).
+  template <typename InputIt, typename = details::require_input_iter<InputIt>>
+  rope_segment_tree(InputIt first, InputIt last, const Allocator& allocator)
+      : allocator_(allocator) {
+    root_ = build(first, last);
+  }
+
+  // Time complexity - O(n).
+  rope_segment_tree(std::initializer_list<T> init_list, Reducer reducer = {},
+                    const Allocator& allocator = {})
+      : Reducer(std::move(reducer)), allocator_(allocator) {
+    root_ = build(init_list.begin(), init_list.end());
+  }
+
+  // Time complexity - O(n).
+  rope_segment_tree(std::initializer_list<T> init_list,
+                    const Allocator& allocator)
+      : allocator_(allocator) {
+    root_ = build(init_list.begin(), init_list.end());
+  }
+
+  // The copy has its own pool.
+  // Time complexity - O(n).
+  rope_segment_tree(const rope_segment_tree& other)
+      : Reducer(other.reducer()), allocator_(other.allocator_) {
+    std::vector<T> elements;
+    elements.reserve(other.size());
+    other.for_each([&](const T& value) { elements.push_back(value); });
+    root_ = build(elements.begin(), elements.end());
+  }
+
+  rope_segment_tree(rope_segment_tree&& other) noexcept
+      : Reducer(std::move(other)),
+        allocator_(other.allocator_),
+        pool_(std::move(other.pool_)),
+        root_(std::exchange(other.root_, null)) {}
+
+  // Time complexity - O(n).
+  rope_segment_tree& operator=(const rope_segment_tree& other) {
+    if (this != &other) {
+      *this = rope_segment_tree(other);
+    }
+    return *this;
+  }
+
+  rope_segment_tree& operator=(rope_segment_tree&& other) noexcept {
+    if (this != &other) {
+      clear();
+      Reducer::operator=(std::move(other));
+      allocator_ = other.allocator_;
+      pool_ = std::move(other.pool_);
+      root_ = std::exchange(other.root_, null);
+    }
+    return *this;
+  }
+
+  // Returns the nodes to the pool if it is shared with other ropes.
+  // Time complexity - O(n) if the pool is shared, O(1) otherwise.
+  ~rope_segment_tree() { clear(); }
+
+  // Time complexity - O(1).
+  [[nodiscard]] allocator_type get_allocator() const noexcept {
+    return allocator_;
+  }
+
+  // Time complexity - O(log n) expected.
+  [[nodiscard]] const_reference at(size_type pos) const {
+    if (pos >= size()) {
+      throw std::out_of_range("rope_segment_tree::at");
+    }
+    return operator[](pos);
+  }
+
+  // Time complexity - O(log n) expected.
+  [[nodiscard]] const_reference operator[](size_type pos) const {
+    assert(pos < size());
+    index_type i = root_;
+    for (;;) {
+      const node& n = get(i);
+      const size_t left_size = subtree_size(n.left);
+      if (pos == left_size) {
+        return n.value;
+      }
+      if (pos < left_size) {
+        i = n.left;
+      } else {
+        pos -= left_size + 1;
+        i = n.right;
+      }
+    }
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] bool empty() const noexcept { return root_ == null; }
+
+  // Time complexity - O(1).
+  [[nodiscard]] size_type size() const noexcept { return subtree_size(root_); }
+
+  // Returns the number of bytes allocated for the pool, which may be shared
+  // with other ropes.
+  // Time complexity - O(1).
+  [[nodiscard]] size_t bytes_used() const noexcept {
+    if (!pool_) {
+      return 0;
+    }
+    return pool_->nodes.capacity() * sizeof(node) +
+           pool_->free.capacity() * sizeof(index_type);
+  }
+
+  // Time complexity - O(n) if the pool is shared, O(1) otherwise.
+  void clear() noexcept {
+    if (pool_.use_count() > 1) {
+      destroy(root_);
+    } else {
+      pool_.reset();
+    }
+    root_ = null;
+  }
+
+  // Calls f for every element in order.
+  // Time complexity - O(n).
+  template <typename F>
+  void for_each(F&& f) const {
+    std::vector<index_type> path;
+    for (index_type i = root_; i != null || !path.empty();) {
+      if (i != null) {
+        path.push_back(i);
+        i = get(i).left;
+      } else {
+        const node& n = get(path.back());
+        path.pop_back();
+        f(n.value);
+        i = n.right;
+      }
+    }
+  }
+
+  // Inserts the element before pos.
+  // Time complexity - O(log n) expected.
+  void insert(size_t pos, const T& value) {
+    assert(pos <= size());
+    const index_type i = create(value);
+    const auto [left, right] = split(root_, pos);
+    root_ = merge(merge(left, i), right);
+  }
+
+  // Inserts [first, last) elements before pos.
+  // Time complexity - O(k + log n) where k is std::distance(first, last).
+  template <typename InputIt, typename = details::require_input_iter<InputIt>>
+  void insert(size_t pos, InputIt first, InputIt last) {
+    assert(pos <= size());
+    const index_type middle = build(first, last);
+    const auto [left, right] = split(root_, pos);
+    root_ = merge(merge(left, middle), right);
+  }
+
+  // Time complexity - O(log n) expected.
+  void erase(size_t pos) { erase(pos, pos + 1); }
+
+  // Removes [first_index, last_index) elements.
+  // Time complexity - O(k + log n) where k is (last_index - first_index).
+  void erase(size_t first_index, size_t last_index) {
+    assert(first_index <= last_index);
+    assert(last_index <= size());
+    const auto [left, rest] = split(root_, first_index);
+    const auto [middle, right] = split(rest, last_index - first_index);
+    destroy(middle);
+    root_ = merge(left, right);
+  }
+
+  // Time complexity - O(log n) expected.
+  void push_back(const T& value) { insert(size(), value); }
+
+  // Time complexity - O(log n) expected.
+  void pop_back() {
+    assert(!empty());
+    erase(size() - 1);
+  }
+
+  // Moves [pos, n) elements to the returned rope, which shares the pool.
+  // Time complexity - O(log n) expected.
+  [[nodiscard]] rope_segment_tree split(size_t pos) {
+    assert(pos <= size());
+    const auto [left, right] = split(root_, pos);
+    root_ = left;
+    rope_segment_tree result(reducer(), allocator_);
+    result.pool_ = pool_;
+    result.root_ = right;
+    return result;
+  }
+
+  // Appends the elements of other, which becomes empty.
+  // Time complexity - O(log n) expected if other shares the pool, O(m) where
+  // m is the size of other otherwise.
+  void concat(rope_segment_tree&& other) {
+    if (other.empty()) {
+      return;
+    }
+    if (pool_ == other.pool_ || empty()) {
+      if (pool_ != other.pool_) {
+        clear();
+        pool_ = other.pool_;
+      }
+      root_ = merge(root_, std::exchange(other.root_, null));
+      return;
+    }
+    std::vector<T> elements;
+    elements.reserve(other.size());
+    other.for_each([&](const T& value) { elements.push_back(value); });
+    other.clear();
+    root_ = merge(root_, build(elements.begin(), elements.end()));
+  }
+
+  // Time complexity - O(log n) expected.
+  template <typename V>
+  void update(size_t index, V&& v) {
+    assert(index < size());
+    update_impl(root_, index, std::forward<V>(v));
+  }
+
+  // Make a query on [first_index, last_index) segment.
+  // Time complexity - O(log n) expected.
+  [[nodiscard]] T query(size_t first_index, size_t last_index) const {
+    assert(first_index <= last_index);
+    assert(last_index <= size());
+    std::optional<T> result;
+    if (first_index < last_index) {
+      query_impl(root_, first_index, last_index, result);
+    }
+    if (result) {
+      return std::move(*result);
+    }
+    return details::empty_result<Reducer, T>();
+  }
+
+ private:
+  allocator_type allocator_;
+  std::shared_ptr<pool> pool_;
+  index_type root_ = null;
+};
+
+}  // namespace manavrion::segment_tree
@@ -3,21 +3,30 @@
 // This file is part of the segment_tree header-only library.
 //
 
+#pragma once
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cmath>
 #include <functional>
 #include <iterator>
+#include <limits>
 #include <optional>
 #include <type_traits>
 #include <vector>
 
 #include "manavrion/segment_tree/details.h"
+#include "manavrion/segment_tree/layout.h"
+#include "manavrion/segment_tree/parallel.h"
+#include "manavrion/segment_tree/simd.h"
 
 namespace manavrion::segment_tree {
 
+// Layout is the storage order of the nodes above the elements, see layout.h.
+// The elements are stored contiguously in any layout.
 template <typename T, typename Reducer = std::plus<T>,
-          typename Allocator = std::allocator<T>>
+          typename Allocator = std::allocator<T>,
+          typename Layout = heap_layout>
 class segment_tree : private Reducer {
  public:
   using allocator_type = Allocator;
@@ -36,6 +45,7 @@ class segment_tree : private Reducer {
       typename container_type::const_reverse_iterator;
 
   using reducer_type = Reducer;
+  using layout_type = Layout;
 
  private:
   const Reducer& reducer() const& { return *static_cast<const Reducer*>(this); }
@@ -67,11 +77,18 @@ class segment_tree : private Reducer {
 
   size_t get_tree_size(size_t shift, size_t n) const { return shift + n; }
 
+  // Returns the node by its level-order index.
+  // Time complexity - O(1) for heap_layout, O(log log n) for veb_layout.
+  T& node(size_t node_index) {
+    return tree_[Layout::position(node_index, shift_)];
+  }
+  const T& node(size_t node_index) const {
+    return tree_[Layout::position(node_index, shift_)];
+  }
+
   size_t get_tree_capacity(size_t shift) const { return left_child(shift); }
 
   void init_tree_impl(size_t n) {
-    assert(tree_.empty());
-
     shift_ = get_shift(n);
     tree_.resize(get_tree_size(shift_, n));
   }
@@ -87,30 +104,160 @@ class segment_tree : private Reducer {
     std::fill(std::next(tree_.begin(), shift_), tree_.end(), value);
   }
 
-  // Creates segment tree nodes, time complexity - O(n).
-  void build_tree() {
-    const size_t tree_size = tree_.size();
+  // Computes ancestors of [first, last] nodes, which are located at the same
+  // level and first is the leftmost node of a subtree, up to the given number
+  // of levels.
+  // Time complexity - O(k) where k is (last - first).
+  void build_levels(size_t first, size_t last, size_t levels) {
     const auto& reduce = reducer();
 
-    size_t last = tree_size ? tree_size - 1 : 0;
-    size_t shift = shift_;
-    assert(shift <= last);
+    for (; levels != 0; --levels) {
+      assert(is_left_child(first));
+      const size_t first_child = first;
+      const size_t last_child = last;
+      first = parent(first);
+      last = parent(last);
+
+      // Children of [first, last] are [first_child, last_child], only the last
+      // node can have a single child.
+      const size_t children = last_child + 1 - first_child;
+      const size_t full_nodes = children / 2;
+      details::reduce_pairs(tree_.data() + first_child, tree_.data() + first,
+                            full_nodes, reduce);
+      if (children % 2 != 0) {
+        assert(first + full_nodes == last);
+        tree_[last] = tree_[last_child];
+      }
+    }
+  }
 
-    while (last != 0) {
-      const size_t prev_last = last;
+  // Computes ancestors of [first, last] nodes of the level, where all the
+  // nodes except the last one are equal to value. Every level is filled with
+  // one value, which is the reduction of two values of the level below.
+  // Time complexity - O(n) stores and O(log n) reductions.
+  void build_uniform_levels(size_t first, size_t last, T value) {
+    const auto& reduce = reducer();
+
+    while (first != 0) {
+      const size_t last_child = last;
+      first = parent(first);
       last = parent(last);
-      shift = shift_up(shift);
-      for (size_t i = shift; i <= last; ++i) {
-        const size_t child_1 = left_child(i);
-        const size_t child_2 = child_1 + 1;
-        assert(child_2 == right_child(i));
-        if (child_2 <= prev_last) {
-          tree_[i] = reduce(tree_[child_1], tree_[child_2]);
-        } else if (child_1 <= prev_last) {
-          tree_[i] = tree_[child_1];
+
+      value = reduce(value, value);
+      std::fill(std::next(tree_.begin(), first), std::next(tree_.begin(), last),
+                value);
+      const size_t child = left_child(last);
+      if (child == last_child) {
+        tree_[last] = tree_[child];
+      } else {
+        tree_[last] = reduce(tree_[child], tree_[child + 1]);
+      }
+    }
+  }
+
+  // Creates segment tree nodes when all the elements are equal.
+  // Time complexity - O(n) stores and O(log n) reductions.
+  void build_uniform_tree() {
+    if constexpr (!Layout::is_level_order) {
+      build_tree();
+      return;
+    }
+    if (tree_.size() > 1) {
+      build_uniform_levels(shift_, tree_.size() - 1, tree_[shift_]);
+    }
+  }
+
+  // Creates segment tree nodes on threads threads, which is rounded down to a
+  // power of two. Each thread builds a subtree over contiguous elements, and
+  // the levels above the subtrees are built serially.
+  // Time complexity - O(n / threads + threads).
+  void build_tree(size_t threads = 1) {
+    const size_t tree_size = tree_.size();
+
+    if constexpr (!Layout::is_level_order) {
+      // Levels are not contiguous, so nodes are recomputed one by one.
+      if (tree_size > 1) {
+        for (size_t i = parent(tree_size - 1) + 1; i-- != 0;) {
+          update_node(i);
         }
       }
+      return;
+    }
+
+    if (tree_size <= 1) {
+      return;
+    }
+    const size_t n = tree_size - shift_;
+    const size_t height = details::floor_log2(shift_ + 1);
+    const size_t split_depth = std::min(details::floor_log2(threads), height);
+    const size_t subtree_size = (shift_ + 1) >> split_depth;
+    const size_t subtrees = (n - 1) / subtree_size + 1;
+
+    details::parallel_for(subtrees, [&](size_t i) {
+      const size_t first = i * subtree_size;
+      const size_t last = std::min(n, first + subtree_size) - 1;
+      build_levels(shift_ + first, shift_ + last, height - split_depth);
+    });
+
+    const size_t first_root = (size_t{1} << split_depth) - 1;
+    build_levels(first_root, first_root + subtrees - 1, split_depth);
+  }
+
+  // Makes the tree of 2n leaves when all n leaves are used, the tree becomes
+  // the left subtree of the new root, so every level moves one level down.
+  // Time complexity - O(n).
+  void grow_tree() {
+    assert(size() == shift_ + 1);
+    const size_t shift = shift_;
+    shift_ = 2 * shift + 1;
+    tree_.resize(shift_ + shift + 1);
+
+    if constexpr (!Layout::is_level_order) {
+      const auto leaves = std::next(tree_.begin(), shift);
+      std::move_backward(leaves, leaves + shift + 1, tree_.end());
+      build_tree();
+      return;
+    }
+
+    for (size_t first = shift;; first = shift_up(first)) {
+      const auto level = std::next(tree_.begin(), first);
+      std::move_backward(level, level + first + 1, level + 2 * first + 2);
+      if (first == 0) {
+        break;
+      }
+    }
+  }
+
+  // Makes the tree of n leaves from the left subtree of the root when at most
+  // a quarter of 2n leaves are used, so every level moves one level up. The
+  // tree is not shrunk at a half, so alternating push_back() and pop_back()
+  // do not rebuild it every time.
+  // Time complexity - O(n).
+  void shrink_tree() {
+    assert(shift_ != 0 && size() == (shift_ + 1) / 4);
+    const size_t shift = shift_up(shift_);
+    const size_t n = size();
+
+    if constexpr (!Layout::is_level_order) {
+      const auto leaves = std::next(tree_.begin(), shift_);
+      std::move(leaves, leaves + n, std::next(tree_.begin(), shift));
+      shift_ = shift;
+      tree_.resize(shift + n);
+      build_tree();
+      return;
+    }
+
+    // Only the leaf level is partially stored.
+    for (size_t first = 0;; first = left_child(first)) {
+      const auto level = std::next(tree_.begin(), first);
+      std::move(level + first + 1,
+                std::min(level + 2 * first + 2, tree_.end()), level);
+      if (first == shift) {
+        break;
+      }
     }
+    shift_ = shift;
+    tree_.resize(shift + n);
   }
 
   // Updates unique element.
@@ -122,6 +269,11 @@ class segment_tree : private Reducer {
     i += shift_;
     assert(i < tree_size);
 
+    if constexpr (!Layout::is_level_order) {
+      update_path(i);
+      return;
+    }
+
     while (i != 0) {
       i = parent(i);
       const size_t child_1 = left_child(i);
@@ -136,6 +288,68 @@ class segment_tree : private Reducer {
     }
   }
 
+  // Recomputes ancestors of the node. Storage indexes of the ancestors and
+  // their siblings are computed at once instead of computing the layout
+  // position for every node.
+  // Time complexity - O(log n).
+  void update_path(size_t i) {
+    const size_t tree_size = tree_.size();
+    const auto& reduce = reducer();
+
+    std::array<size_t, std::numeric_limits<size_t>::digits> positions;
+    std::array<size_t, std::numeric_limits<size_t>::digits> siblings;
+    size_t depth = Layout::ancestor_positions(i, shift_, positions.data(),
+                                              siblings.data());
+    while (depth != 0) {
+      const size_t position = positions[depth];
+      const size_t sibling = siblings[depth];
+      T& value = tree_[positions[depth - 1]];
+      if (is_right_child(i)) {
+        value = reduce(tree_[sibling], tree_[position]);
+      } else if (i + 1 < tree_size) {
+        value = reduce(tree_[position], tree_[sibling]);
+      } else {
+        value = tree_[position];
+      }
+      i = parent(i);
+      --depth;
+    }
+  }
+
+  // Recomputes the node from its children.
+  // Time complexity - O(1).
+  void update_node(size_t i) {
+    const size_t tree_size = tree_.size();
+    const size_t child_1 = left_child(i);
+    const size_t child_2 = child_1 + 1;
+    assert(child_2 == right_child(i));
+    if (child_2 < tree_size) {
+      node(i) = reducer()(node(child_1), node(child_2));
+    } else {
+      assert(child_1 < tree_size);
+      node(i) = node(child_1);
+    }
+  }
+
+  // Recomputes ancestors of the sorted nodes, which are located at the same
+  // level. Each ancestor is recomputed once.
+  // Time complexity - O(k + m) where m is the number of distinct ancestors.
+  void update_ancestors(std::vector<size_t>& nodes) {
+    while (!nodes.empty() && nodes.front() != 0) {
+      size_t count = 0;
+      for (const size_t node : nodes) {
+        const size_t parent_node = parent(node);
+        if (count == 0 || nodes[count - 1] != parent_node) {
+          nodes[count++] = parent_node;
+        }
+      }
+      nodes.resize(count);
+      for (const size_t node : nodes) {
+        update_node(node);
+      }
+    }
+  }
+
   // Time complexity - O(min(n, k log n)) where k is (last_index - first_index).
   void update_range(size_t first_index, size_t last_index) {
     assert(first_index <= last_index);
@@ -151,50 +365,70 @@ class segment_tree : private Reducer {
     }
   }
 
-  // Make a query on [first_index, last_index) segment.
+  // Make a query on [first_index, last_index) segment. The first node of a
+  // level is taken if it is a right child and the last node is taken if it is
+  // a left child, then the segment is covered by the parents of the rest.
+  // Both nodes exist while first_index < last_index, so they are taken
+  // without branches.
   // Time complexity - O(log n).
   T query_impl(size_t first_index, size_t last_index) const {
     assert(first_index <= last_index);
     assert(last_index + shift_ <= tree_.size());
 
-    const auto& reduce = reducer();
-
-    std::optional<T> result;
-    auto add_result = [&](const auto& value) {
-      if (result) {
-        result.emplace(reduce(std::move(*result), value));
-      } else {
-        result.emplace(value);
-      }
-    };
-
+    details::segment_accumulator<T, Reducer> result(reducer());
     size_t shift = shift_;
 
     while (first_index < last_index) {
-      if (first_index < last_index && is_right_child(shift + first_index)) {
-        assert(shift + first_index < tree_.size());
-        add_result(tree_[shift + first_index]);
-        ++first_index;
-      }
-      if (first_index < last_index && is_left_child(shift + last_index - 1)) {
-        assert(shift + last_index - 1 < tree_.size());
-        add_result(tree_[shift + last_index - 1]);
-        --last_index;
-      }
-      if (first_index + 1 == last_index) {
-        assert(shift + first_index < tree_.size());
-        add_result(tree_[shift + first_index]);
-        break;
-      }
+      const bool take_first = is_right_child(shift + first_index);
+      result.add_left_if(take_first, node(shift + first_index));
+      first_index += take_first;
+
+      const bool take_last = (first_index < last_index) &
+                             is_left_child(shift + last_index - 1);
+      result.add_right_if(take_last, node(shift + last_index - 1));
+      last_index -= take_last;
+
       first_index /= 2;
       last_index /= 2;
       shift /= 2;
     }
 
-    if (!result) {
-      result.emplace();
+    return std::move(result).result();
+  }
+
+  // Number of queries which query_batch() advances in lockstep.
+  static constexpr size_t query_group_size = 16;
+
+  // Number of levels which a query passes from the leaves to the root.
+  size_t query_height() const {
+    size_t height = 1;
+    for (size_t shift = shift_; shift != 0; shift = shift_up(shift)) {
+      ++height;
     }
-    return std::move(*result);
+    return height;
+  }
+
+  // Makes one level of a query on [first_index, last_index) segment without
+  // branches. Indexes of the nodes to reduce are appended to left_nodes and
+  // right_nodes in the same order as query_impl() reduces them.
+  // Time complexity - O(1).
+  void query_step(size_t& first_index, size_t& last_index, size_t shift,
+                  size_t* left_nodes, size_t& left_count, size_t* right_nodes,
+                  size_t& right_count) const {
+    const size_t take_first =
+        (first_index < last_index) & is_right_child(shift + first_index);
+    left_nodes[left_count] = shift + first_index;
+    left_count += take_first;
+    first_index += take_first;
+
+    const size_t take_last =
+        (first_index < last_index) & is_left_child(shift + last_index - 1);
+    right_nodes[right_count] = shift + last_index - 1;
+    right_count += take_last;
+    last_index -= take_last;
+
+    first_index /= 2;
+    last_index /= 2;
   }
 
  public:
@@ -221,13 +455,29 @@ class segment_tree : private Reducer {
     build_tree();
   }
 
+  // Builds the tree on policy.threads threads.
+  // Time complexity - O(n / threads + threads).
+  template <typename InputIt, typename = details::require_input_iter<InputIt>>
+  segment_tree(parallel_build policy, InputIt first, InputIt last,
+               Reducer reducer = {}, const Allocator& allocator = {})
+      : Reducer(std::move(reducer)), tree_(allocator) {
+    init_tree(first, last);
+    build_tree(policy.threads);
+  }
+
   // Time complexity - O(n).
   segment_tree(const segment_tree& other, const Allocator& allocator = {})
       : Reducer(other.reducer()),
         tree_(other.tree_, allocator),
         shift_(other.shift_) {}
 
-  segment_tree(segment_tree&& other, const Allocator& allocator = {}) noexcept
+  // The allocator is moved too, so the elements are never copied.
+  segment_tree(segment_tree&& other) noexcept
+      : Reducer(std::move(other).reducer()),
+        tree_(std::move(other.tree_)),
+        shift_(other.shift_) {}
+
+  segment_tree(segment_tree&& other, const Allocator& allocator) noexcept
       : Reducer(std::move(other).reducer()),
         tree_(std::move(other.tree_), allocator),
         shift_(other.shift_) {}
@@ -258,10 +508,11 @@ class segment_tree : private Reducer {
     return *this;
   }
 
-  // Time complexity - O(n). Can be reduced to O(1) with dynamic_segment_tree.
+  // Every level is filled with one value, so the reducer is called O(log n)
+  // times. Time complexity - O(n), see dynamic_segment_tree for O(log n).
   void assign(size_type count, const T& value) {
     init_tree(count, value);
-    build_tree();
+    build_uniform_tree();
   }
 
   // Time complexity - O(n).
@@ -274,6 +525,14 @@ class segment_tree : private Reducer {
   // Time complexity - O(n).
   void assign(std::initializer_list<T> init_list) { operator=(init_list); }
 
+  // Builds the tree on policy.threads threads.
+  // Time complexity - O(n / threads + threads).
+  template <class InputIt, typename = details::require_input_iter<InputIt>>
+  void assign(parallel_build policy, InputIt first, InputIt last) {
+    init_tree(first, last);
+    build_tree(policy.threads);
+  }
+
   // Time complexity - O(1).
   [[nodiscard]] allocator_type get_allocator() const noexcept {
     return tree_.get_allocator();
@@ -360,8 +619,56 @@ class segment_tree : private Reducer {
   // Time complexity - O(1).
   [[nodiscard]] size_type max_size() const noexcept { return tree_.max_size(); }
 
+  // Returns the number of bytes allocated for the elements and the nodes.
+  // Time complexity - O(1).
+  [[nodiscard]] size_t bytes_used() const noexcept {
+    return tree_.capacity() * sizeof(T);
+  }
+
   // Time complexity - O(n).
-  void clear() noexcept { tree_.clear(); }
+  void clear() noexcept {
+    tree_.clear();
+    shift_ = 0;
+  }
+
+  // Appends the element. The number of leaves is doubled when all of them
+  // are used, so only ancestors of the new leaf are updated otherwise. The
+  // value is made before the tree grows, since args may refer to an element.
+  // Time complexity - O(log n) amortized.
+  template <typename... Args>
+  const_reference emplace_back(Args&&... args) {
+    if (size() == shift_ + 1) {
+      T value(std::forward<Args>(args)...);
+      grow_tree();
+      tree_.push_back(std::move(value));
+    } else {
+      tree_.emplace_back(std::forward<Args>(args)...);
+    }
+    update(size() - 1);
+    return tree_.back();
+  }
+
+  // Time complexity - O(log n) amortized.
+  void push_back(const T& value) { emplace_back(value); }
+
+  // Time complexity - O(log n) amortized.
+  void push_back(T&& value) { emplace_back(std::move(value)); }
+
+  // Removes the last element. The number of leaves is halved when only a
+  // quarter of them are used.
+  // Time complexity - O(log n) amortized.
+  void pop_back() {
+    assert(!empty());
+    tree_.pop_back();
+    const size_t n = size();
+    if (n == 0) {
+      clear();
+    } else if (n == (shift_ + 1) / 4) {
+      shrink_tree();
+    } else {
+      update(n - 1);
+    }
+  }
 #if 1
   // Time complexity - O(n).
   const_iterator insert(const_iterator pos, const T& value) {
@@ -437,80 +744,279 @@ class segment_tree : private Reducer {
     update(index);
   }
 
+  // Rewrites elements given as (index, value) pairs. If an index repeats, the
+  // last value is kept. Each affected node is recomputed once.
+  // Time complexity - O(k log k + m) where k is std::distance(first, last)
+  // and m is the number of distinct ancestors of the updated elements.
+  template <typename InputIt>
+  void update_batch(InputIt first, InputIt last) {
+    std::vector<size_t> nodes;
+    for (; first != last; ++first) {
+      const auto& [index, value] = *first;
+      assert(index + shift_ < tree_.size());
+      tree_[index + shift_] = value;
+      nodes.push_back(index + shift_);
+    }
+    std::sort(nodes.begin(), nodes.end());
+    nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+    update_ancestors(nodes);
+  }
+
   // Make a query on [first_index, last_index) segment.
   // Time complexity - O(log n).
   [[nodiscard]] T query(size_t first_index, size_t last_index) const {
     return query_impl(first_index, last_index);
   }
 
+  // Makes queries on [first_index, last_index) segments, which are given as
+  // pairs, and writes their results to d_first. Queries are advanced in
+  // groups one level at a time without branches, and the nodes of the next
+  // level are prefetched, so the cache misses of the group overlap.
+  // Time complexity - O(k log n) where k is std::distance(first, last).
+  template <typename InputIt, typename OutputIt>
+  OutputIt query_batch(InputIt first, InputIt last, OutputIt d_first) const {
+    const auto& reduce = reducer();
+    const size_t height = query_height();
+
+    std::array<size_t, query_group_size> first_indexes;
+    std::array<size_t, query_group_size> last_indexes;
+    std::array<size_t, query_group_size> left_counts;
+    std::array<size_t, query_group_size> right_counts;
+    std::vector<size_t> left_nodes(query_group_size * height);
+    std::vector<size_t> right_nodes(query_group_size * height);
+
+    while (first != last) {
+      size_t group_size = 0;
+      for (; first != last && group_size != query_group_size; ++first) {
+        const auto& [first_index, last_index] = *first;
+        assert(first_index <= last_index);
+        assert(last_index + shift_ <= tree_.size());
+        first_indexes[group_size] = first_index;
+        last_indexes[group_size] = last_index;
+        left_counts[group_size] = 0;
+        right_counts[group_size] = 0;
+        ++group_size;
+      }
+
+      size_t shift = shift_;
+      for (size_t level = 0; level != height; ++level) {
+        for (size_t i = 0; i != group_size; ++i) {
+          query_step(first_indexes[i], last_indexes[i], shift,
+                     left_nodes.data() + i * height, left_counts[i],
+                     right_nodes.data() + i * height, right_counts[i]);
+          if (first_indexes[i] < last_indexes[i]) {
+            const size_t next_shift = shift_up(shift);
+            details::prefetch(&node(next_shift + first_indexes[i]));
+            details::prefetch(&node(next_shift + last_indexes[i] - 1));
+          }
+        }
+        shift = shift_up(shift);
+      }
+
+      for (size_t i = 0; i != group_size; ++i) {
+        details::segment_accumulator<T, Reducer> result(reduce);
+        for (size_t j = 0; j != left_counts[i]; ++j) {
+          result.add_left(node(left_nodes[i * height + j]));
+        }
+        for (size_t j = 0; j != right_counts[i]; ++j) {
+          result.add_right(node(right_nodes[i * height + j]));
+        }
+        *d_first++ = std::move(result).result();
+      }
+    }
+    return d_first;
+  }
+
+  // Returns the largest last_index such that pred(query(first_index,
+  // last_index)) is true, the empty segment is always accepted. pred must be
+  // monotone: once it is false for a segment, it is false for all the longer
+  // segments starting at first_index. Nodes are visited once up and once down
+  // the tree.
+  // Time complexity - O(log n).
+  template <typename Predicate>
+  [[nodiscard]] size_t max_right(size_t first_index, Predicate pred) const {
+    assert(first_index <= size());
+    if (first_index == size()) {
+      return first_index;
+    }
+    const auto& reduce = reducer();
+    std::optional<T> sum;
+    auto append = [&](const T& value) {
+      return sum ? reduce(*sum, value) : value;
+    };
+
+    // The node shift + index covers [index << height, (index + 1) << height).
+    size_t shift = shift_;
+    size_t index = first_index;
+    size_t height = 0;
+    // Only nodes that lie entirely within [0, size()) are read, the others
+    // are partial and hold no meaningful value.
+    for (;;) {
+      while (index % 2 == 0 && shift != 0 &&
+             ((index + 2) << height) <= size()) {
+        index /= 2;
+        shift = shift_up(shift);
+        ++height;
+      }
+      while (((index + 1) << height) > size()) {
+        shift = left_child(shift);
+        index *= 2;
+        --height;
+      }
+      T next = append(node(shift + index));
+      if (!pred(next)) {
+        break;
+      }
+      sum.emplace(std::move(next));
+      ++index;
+      if ((index << height) >= size()) {
+        return size();
+      }
+    }
+    // The left child of the rejected node always covers some elements, and
+    // the right child is visited only if it makes the node rejected.
+    while (shift != shift_) {
+      shift = left_child(shift);
+      index *= 2;
+      T next = append(node(shift + index));
+      if (pred(next)) {
+        sum.emplace(std::move(next));
+        ++index;
+      }
+    }
+    return index;
+  }
+
+  // Returns the smallest first_index such that pred(query(first_index,
+  // last_index)) is true, the empty segment is always accepted. pred must be
+  // monotone: once it is false for a segment, it is false for all the longer
+  // segments ending at last_index.
+  // Time complexity - O(log n).
+  template <typename Predicate>
+  [[nodiscard]] size_t min_left(size_t last_index, Predicate pred) const {
+    assert(last_index <= size());
+    if (last_index == 0) {
+      return 0;
+    }
+    const auto& reduce = reducer();
+    std::optional<T> sum;
+    auto prepend = [&](const T& value) {
+      return sum ? reduce(value, *sum) : value;
+    };
+
+    // The node shift + index covers [index << height, (index + 1) << height).
+    size_t shift = shift_;
+    size_t index = last_index;
+    size_t height = 0;
+    for (;;) {
+      --index;
+      while (index % 2 != 0) {
+        index /= 2;
+        shift = shift_up(shift);
+        ++height;
+      }
+      T next = prepend(node(shift + index));
+      if (!pred(next)) {
+        break;
+      }
+      sum.emplace(std::move(next));
+      if (index == 0) {
+        return 0;
+      }
+    }
+    while (shift != shift_) {
+      shift = left_child(shift);
+      index = index * 2 + 1;
+      T next = prepend(node(shift + index));
+      if (pred(next)) {
+        sum.emplace(std::move(next));
+        --index;
+      }
+    }
+    return index + 1;
+  }
+
+  // Returns the first index where the prefix sum reaches value, that is the
+  // smallest i such that query(0, i + 1) >= value, or size() if there is no
+  // such index. The elements must be non-negative.
+  // Time complexity - O(log n).
+  [[nodiscard]] size_t lower_bound_prefix(const T& value) const {
+    static_assert(std::is_same_v<Reducer, std::plus<T>> ||
+                      std::is_same_v<Reducer, std::plus<>>,
+                  "lower_bound_prefix() requires std::plus");
+    return max_right(0, [&](const T& sum) { return sum < value; });
+  }
+
   // Time complexity - O(min(n, k log n)) where k is (last_index - first_index).
   void update_range(const_iterator first, const_iterator last) {
     update_range(std::distance(cbegin(), first), std::distance(cbegin(), last));
   }
 
-  template <typename T1, typename T2, typename R, typename A>
-  friend bool operator==(const segment_tree<T1, R, A>& lhs,
-                         const segment_tree<T2, R, A>& rhs);
+  friend struct details::file_access;
+
+  template <typename T1, typename T2, typename R, typename A, typename L>
+  friend bool operator==(const segment_tree<T1, R, A, L>& lhs,
+                         const segment_tree<T2, R, A, L>& rhs);
 
-  template <typename T1, typename T2, typename R, typename A>
-  friend bool operator!=(const segment_tree<T1, R, A>& lhs,
-                         const segment_tree<T2, R, A>& rhs);
+  template <typename T1, typename T2, typename R, typename A, typename L>
+  friend bool operator!=(const segment_tree<T1, R, A, L>& lhs,
+                         const segment_tree<T2, R, A, L>& rhs);
 
-  template <typename T1, typename T2, typename R, typename A>
-  friend bool operator<(const segment_tree<T1, R, A>& lhs,
-                        const segment_tree<T2, R, A>& rhs);
+  template <typename T1, typename T2, typename R, typename A, typename L>
+  friend bool operator<(const segment_tree<T1, R, A, L>& lhs,
+                        const segment_tree<T2, R, A, L>& rhs);
 
-  template <typename T1, typename T2, typename R, typename A>
-  friend bool operator<=(const segment_tree<T1, R, A>& lhs,
-                         const segment_tree<T2, R, A>& rhs);
+  template <typename T1, typename T2, typename R, typename A, typename L>
+  friend bool operator<=(const segment_tree<T1, R, A, L>& lhs,
+                         const segment_tree<T2, R, A, L>& rhs);
 
-  template <typename T1, typename T2, typename R, typename A>
-  friend bool operator>(const segment_tree<T1, R, A>& lhs,
-                        const segment_tree<T2, R, A>& rhs);
+  template <typename T1, typename T2, typename R, typename A, typename L>
+  friend bool operator>(const segment_tree<T1, R, A, L>& lhs,
+                        const segment_tree<T2, R, A, L>& rhs);
 
-  template <typename T1, typename T2, typename R, typename A>
-  friend bool operator>=(const segment_tree<T1, R, A>& lhs,
-                         const segment_tree<T2, R, A>& rhs);
+  template <typename T1, typename T2, typename R, typename A, typename L>
+  friend bool operator>=(const segment_tree<T1, R, A, L>& lhs,
+                         const segment_tree<T2, R, A, L>& rhs);
 
  private:
   std::vector<T, Allocator> tree_;
   size_t shift_ = 0;
 };
 
-template <typename T1, typename T2, typename R, typename A>
-bool operator==(const segment_tree<T1, R, A>& lhs,
-                const segment_tree<T2, R, A>& rhs) {
+template <typename T1, typename T2, typename R, typename A, typename L>
+bool operator==(const segment_tree<T1, R, A, L>& lhs,
+                const segment_tree<T2, R, A, L>& rhs) {
   return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
 }
 
-template <typename T1, typename T2, typename R, typename A>
-bool operator!=(const segment_tree<T1, R, A>& lhs,
-                const segment_tree<T2, R, A>& rhs) {
+template <typename T1, typename T2, typename R, typename A, typename L>
+bool operator!=(const segment_tree<T1, R, A, L>& lhs,
+                const segment_tree<T2, R, A, L>& rhs) {
   return !(lhs == rhs);
 }
 
-template <typename T1, typename T2, typename R, typename A>
-bool operator<(const segment_tree<T1, R, A>& lhs,
-               const segment_tree<T2, R, A>& rhs) {
+template <typename T1, typename T2, typename R, typename A, typename L>
+bool operator<(const segment_tree<T1, R, A, L>& lhs,
+               const segment_tree<T2, R, A, L>& rhs) {
   return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(),
                                       rhs.end());
 }
 
-template <typename T1, typename T2, typename R, typename A>
-bool operator<=(const segment_tree<T1, R, A>& lhs,
-                const segment_tree<T2, R, A>& rhs) {
+template <typename T1, typename T2, typename R, typename A, typename L>
+bool operator<=(const segment_tree<T1, R, A, L>& lhs,
+                const segment_tree<T2, R, A, L>& rhs) {
   return (lhs < rhs) || (lhs == rhs);
 }
 
-template <typename T1, typename T2, typename R, typename A>
-bool operator>(const segment_tree<T1, R, A>& lhs,
-               const segment_tree<T2, R, A>& rhs) {
+template <typename T1, typename T2, typename R, typename A, typename L>
+bool operator>(const segment_tree<T1, R, A, L>& lhs,
+               const segment_tree<T2, R, A, L>& rhs) {
   return !(lhs <= rhs);
 }
 
-template <typename T1, typename T2, typename R, typename A>
-bool operator>=(const segment_tree<T1, R, A>& lhs,
-                const segment_tree<T2, R, A>& rhs) {
+template <typename T1, typename T2, typename R, typename A, typename L>
+bool operator>=(const segment_tree<T1, R, A, L>& lhs,
+                const segment_tree<T2, R, A, L>& rhs) {
   return !(lhs < rhs);
 }
 
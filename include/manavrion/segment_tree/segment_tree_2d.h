@@ -0,0 +1,424 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "manavrion/segment_tree/details.h"
+#include "manavrion/segment_tree/simd.h"
+
+namespace manavrion::segment_tree {
+
+// Segment tree of a matrix, which reduces rectangles of elements.
+//
+// The rows and the columns are indexed as the elements of segment_tree. The
+// node (i, j) reduces the elements of the rows under the row node i and the
+// columns under the column node j. The nodes are stored in one array, the
+// column tree of the row node i takes [i * m, (i + 1) * m) where m is the
+// number of column nodes, so a row node is the elementwise reduction of its
+// children. The elements of a rectangle have no order, so Reducer should be
+// commutative.
+template <typename T, typename Reducer = std::plus<T>,
+          typename Allocator = std::allocator<T>>
+class segment_tree_2d : private Reducer {
+ public:
+  using allocator_type = Allocator;
+  using value_type = T;
+  using container_type = std::vector<value_type, allocator_type>;
+  using size_type = typename container_type::size_type;
+  using difference_type = typename container_type::difference_type;
+  using const_reference = typename container_type::const_reference;
+
+  using reducer_type = Reducer;
+
+ private:
+  const Reducer& reducer() const& { return *static_cast<const Reducer*>(this); }
+
+  static size_t parent(size_t node_index) {
+    assert(node_index != 0);
+    return (node_index - 1) / 2;
+  }
+
+  static size_t left_child(size_t node_index) { return node_index * 2 + 1; }
+
+  static bool is_left_child(size_t node_index) { return node_index % 2 != 0; }
+  static bool is_right_child(size_t node_index) {
+    return node_index % 2 == 0;
+  }
+
+  static size_t get_shift(size_t n) {
+    if (n == 0) return 0;
+    return std::pow(2, std::ceil(std::log2(n))) - 1;
+  }
+
+  size_t row_tree_size() const { return row_shift_ + rows_; }
+  size_t col_tree_size() const { return col_shift_ + cols_; }
+
+  // Returns the column tree of the row node.
+  T* row_nodes(size_t row_node) {
+    return tree_.data() + row_node * col_tree_size();
+  }
+  const T* row_nodes(size_t row_node) const {
+    return tree_.data() + row_node * col_tree_size();
+  }
+
+  void init_tree_impl(size_t rows, size_t cols) {
+    rows_ = rows;
+    cols_ = cols;
+    row_shift_ = get_shift(rows);
+    col_shift_ = get_shift(cols);
+    tree_.clear();
+    tree_.resize(row_tree_size() * col_tree_size());
+  }
+
+  template <typename InputIt>
+  void init_tree(InputIt first, InputIt last, size_t cols) {
+    const size_t n = std::distance(first, last);
+    assert(cols == 0 ? n == 0 : n % cols == 0);
+    init_tree_impl(cols == 0 ? 0 : n / cols, cols);
+    for (size_t row = 0; row < rows_; ++row) {
+      T* elements = row_nodes(row_shift_ + row) + col_shift_;
+      for (size_t col = 0; col < cols_; ++col, ++first) {
+        elements[col] = *first;
+      }
+    }
+  }
+
+  void init_tree(size_t rows, size_t cols, const T& value) {
+    init_tree_impl(rows, cols);
+    for (size_t row = 0; row < rows_; ++row) {
+      T* elements = row_nodes(row_shift_ + row) + col_shift_;
+      std::fill(elements, elements + cols_, value);
+    }
+  }
+
+  // Computes the column nodes of the row from its elements.
+  // Time complexity - O(m).
+  void build_columns(T* nodes) {
+    const auto& reduce = reducer();
+
+    size_t first = col_shift_;
+    size_t last = col_tree_size() - 1;
+    while (first != 0) {
+      const size_t first_child = first;
+      const size_t last_child = last;
+      first = parent(first);
+      last = parent(last);
+
+      // Only the last node can have a single child.
+      const size_t children = last_child + 1 - first_child;
+      const size_t full_nodes = children / 2;
+      details::reduce_pairs(nodes + first_child, nodes + first, full_nodes,
+                            reduce);
+      if (children % 2 != 0) {
+        nodes[last] = nodes[last_child];
+      }
+    }
+  }
+
+  // Computes the row node from its children.
+  // Time complexity - O(m).
+  void build_row(size_t row_node) {
+    const size_t child_1 = left_child(row_node);
+    const size_t child_2 = child_1 + 1;
+    if (child_2 < row_tree_size()) {
+      details::reduce_elementwise(row_nodes(child_1), row_nodes(child_2),
+                                  row_nodes(row_node), col_tree_size(),
+                                  reducer());
+    } else {
+      std::copy_n(row_nodes(child_1), col_tree_size(), row_nodes(row_node));
+    }
+  }
+
+  // Creates segment tree nodes, time complexity - O(n m).
+  void build_tree() {
+    if (tree_.empty()) {
+      return;
+    }
+    for (size_t row = 0; row < rows_; ++row) {
+      build_columns(row_nodes(row_shift_ + row));
+    }
+    if (row_tree_size() == 1) {
+      return;
+    }
+    // The row nodes after the parent of the last row cover no rows.
+    for (size_t i = parent(row_tree_size() - 1) + 1; i-- != 0;) {
+      build_row(i);
+    }
+  }
+
+  // Recomputes the column node of the row node from its children in the
+  // same row node if columns is true, or in the child row nodes otherwise.
+  // Time complexity - O(1).
+  void update_node(size_t row_node, size_t col_node, bool columns) {
+    const auto& reduce = reducer();
+    T* nodes = row_nodes(row_node);
+    if (columns) {
+      const size_t child_1 = left_child(col_node);
+      const size_t child_2 = child_1 + 1;
+      if (child_2 < col_tree_size()) {
+        nodes[col_node] = reduce(nodes[child_1], nodes[child_2]);
+      } else {
+        nodes[col_node] = nodes[child_1];
+      }
+    } else {
+      const size_t child_1 = left_child(row_node);
+      const size_t child_2 = child_1 + 1;
+      if (child_2 < row_tree_size()) {
+        nodes[col_node] =
+            reduce(row_nodes(child_1)[col_node], row_nodes(child_2)[col_node]);
+      } else {
+        nodes[col_node] = row_nodes(child_1)[col_node];
+      }
+    }
+  }
+
+  // Makes a query on [first_index, last_index) columns of the row node.
+  // Time complexity - O(log m).
+  T query_columns(const T* nodes, size_t first_index,
+                  size_t last_index) const {
+    details::segment_accumulator<T, Reducer> result(reducer());
+    size_t shift = col_shift_;
+
+    while (first_index < last_index) {
+      const bool take_first = is_right_child(shift + first_index);
+      result.add_left_if(take_first, nodes[shift + first_index]);
+      first_index += take_first;
+
+      const bool take_last = (first_index < last_index) &
+                             is_left_child(shift + last_index - 1);
+      result.add_right_if(take_last, nodes[shift + last_index - 1]);
+      last_index -= take_last;
+
+      first_index /= 2;
+      last_index /= 2;
+      shift /= 2;
+    }
+
+    return std::move(result).result();
+  }
+
+ public:
+  segment_tree_2d() = default;
+
+  explicit segment_tree_2d(const Allocator& allocator) : tree_(allocator) {}
+
+  explicit segment_tree_2d(Reducer reducer, const Allocator& allocator = {})
+      : Reducer(std::move(reducer)), tree_(allocator) {}
+
+  // Time complexity - O(n m).
+  segment_tree_2d(size_type rows, size_type cols, const T& value = {},
+                  Reducer reducer = {}, const Allocator& allocator = {})
+      : Reducer(std::move(reducer)), tree_(allocator) {
+    init_tree(rows, cols, value);
+    build_tree();
+  }
+
+  // The elements are given row by row, cols is the length of a row.
+  // Time complexity - O(n m).
+  template <typename InputIt, typename = details::require_input_iter<InputIt>>
+  segment_tree_2d(InputIt first, InputIt last, size_type cols,
+                  Reducer reducer = {}, const Allocator& allocator = {})
+      : Reducer(std::move(reducer)), tree_(allocator) {
+    init_tree(first, last, cols);
+    build_tree();
+  }
+
+  // The rows must have the same length.
+  // Time complexity - O(n m).
+  segment_tree_2d(std::initializer_list<std::initializer_list<T>> init_list,
+                  Reducer reducer = {}, const Allocator& allocator = {})
+      : Reducer(std::move(reducer)), tree_(allocator) {
+    assign(init_list);
+  }
+
+  // Time complexity - O(n m).
+  segment_tree_2d(const segment_tree_2d& other) = default;
+  segment_tree_2d(segment_tree_2d&& other) noexcept = default;
+
+  // Time complexity - O(n m).
+  segment_tree_2d& operator=(const segment_tree_2d& other) = default;
+  segment_tree_2d& operator=(segment_tree_2d&& other) = default;
+
+  // Time complexity - O(n m).
+  void assign(size_type rows, size_type cols, const T& value) {
+    init_tree(rows, cols, value);
+    build_tree();
+  }
+
+  // Time complexity - O(n m).
+  template <class InputIt, typename = details::require_input_iter<InputIt>>
+  void assign(InputIt first, InputIt last, size_type cols) {
+    init_tree(first, last, cols);
+    build_tree();
+  }
+
+  // Time complexity - O(n m).
+  void assign(std::initializer_list<std::initializer_list<T>> init_list) {
+    const size_t cols = init_list.size() == 0 ? 0 : init_list.begin()->size();
+    init_tree_impl(cols == 0 ? 0 : init_list.size(), cols);
+    size_t row = 0;
+    for (const auto& elements : init_list) {
+      assert(elements.size() == cols);
+      std::copy(elements.begin(), elements.end(),
+                row_nodes(row_shift_ + row++) + col_shift_);
+    }
+    build_tree();
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] allocator_type get_allocator() const noexcept {
+    return tree_.get_allocator();
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_reference at(size_type row, size_type col) const {
+    if (row >= rows_ || col >= cols_) {
+      throw std::out_of_range("segment_tree_2d::at");
+    }
+    return (*this)(row, col);
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_reference operator()(size_type row,
+                                           size_type col) const {
+    assert(row < rows_);
+    assert(col < cols_);
+    return row_nodes(row_shift_ + row)[col_shift_ + col];
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+
+  // Time complexity - O(1).
+  [[nodiscard]] size_type size() const noexcept { return rows_ * cols_; }
+
+  // Time complexity - O(1).
+  [[nodiscard]] size_type rows() const noexcept { return rows_; }
+
+  // Time complexity - O(1).
+  [[nodiscard]] size_type cols() const noexcept { return cols_; }
+
+  // Returns the number of bytes allocated for the elements and the nodes.
+  // Time complexity - O(1).
+  [[nodiscard]] size_t bytes_used() const noexcept {
+    return tree_.capacity() * sizeof(T);
+  }
+
+  // Time complexity - O(n m).
+  void clear() noexcept {
+    tree_.clear();
+    rows_ = cols_ = row_shift_ = col_shift_ = 0;
+  }
+
+  // Time complexity - O(1).
+  void swap(segment_tree_2d& other) noexcept {
+    auto tmp = std::move(other);
+    other = std::move(*this);
+    *this = std::move(tmp);
+  }
+
+  // Time complexity - O(log n log m).
+  template <typename V>
+  void update(size_t row, size_t col, V&& v) {
+    assert(row < rows_);
+    assert(col < cols_);
+    size_t row_node = row_shift_ + row;
+    const size_t col_leaf = col_shift_ + col;
+    row_nodes(row_node)[col_leaf] = std::forward<V>(v);
+    for (size_t col_node = col_leaf; col_node != 0;) {
+      col_node = parent(col_node);
+      update_node(row_node, col_node, true);
+    }
+    while (row_node != 0) {
+      row_node = parent(row_node);
+      for (size_t col_node = col_leaf;; col_node = parent(col_node)) {
+        update_node(row_node, col_node, false);
+        if (col_node == 0) {
+          break;
+        }
+      }
+    }
+  }
+
+  // Make a query on [first_row, last_row) x [first_col, last_col) rectangle.
+  // The rows are split into O(log n) row nodes as in segment_tree, then the
+  // columns are split in the column tree of each of them.
+  // Time complexity - O(log n log m).
+  [[nodiscard]] T query(size_t first_row, size_t last_row, size_t first_col,
+                        size_t last_col) const {
+    assert(first_row <= last_row);
+    assert(last_row <= rows_);
+    assert(first_col <= last_col);
+    assert(last_col <= cols_);
+
+    details::segment_accumulator<T, Reducer> result(reducer());
+    if (first_col == last_col) {
+      return std::move(result).result();
+    }
+    size_t shift = row_shift_;
+
+    while (first_row < last_row) {
+      if (is_right_child(shift + first_row)) {
+        result.add_left(
+            query_columns(row_nodes(shift + first_row), first_col, last_col));
+        ++first_row;
+      }
+      if (first_row < last_row && is_left_child(shift + last_row - 1)) {
+        result.add_right(query_columns(row_nodes(shift + last_row - 1),
+                                       first_col, last_col));
+        --last_row;
+      }
+      first_row /= 2;
+      last_row /= 2;
+      shift /= 2;
+    }
+
+    return std::move(result).result();
+  }
+
+  template <typename T1, typename T2, typename R, typename A>
+  friend bool operator==(const segment_tree_2d<T1, R, A>& lhs,
+                         const segment_tree_2d<T2, R, A>& rhs);
+
+ private:
+  std::vector<T, Allocator> tree_;
+  size_t rows_ = 0;
+  size_t cols_ = 0;
+  size_t row_shift_ = 0;
+  size_t col_shift_ = 0;
+};
+
+template <typename T1, typename T2, typename R, typename A>
+bool operator==(const segment_tree_2d<T1, R, A>& lhs,
+                const segment_tree_2d<T2, R, A>& rhs) {
+  if (lhs.rows() != rhs.rows() || lhs.cols() != rhs.cols()) {
+    return false;
+  }
+  for (size_t row = 0; row < lhs.rows(); ++row) {
+    for (size_t col = 0; col < lhs.cols(); ++col) {
+      if (!(lhs(row, col) == rhs(row, col))) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+template <typename T1, typename T2, typename R, typename A>
+bool operator!=(const segment_tree_2d<T1, R, A>& lhs,
+                const segment_tree_2d<T2, R, A>& rhs) {
+  return !(lhs == rhs);
+}
+
+}  // namespace manavrion::segment_tree
@@ -0,0 +1,463 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <type_traits>
+
+#include "manavrion/segment_tree/functional.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MANAVRION_SEGMENT_TREE_SSE2
+#endif
+
+namespace manavrion::segment_tree::details {
+
+enum class simd_reduce_kind { none, plus, multiplies, minimum, maximum };
+
+// Recognizes reducers, which can be vectorized for arithmetic T.
+template <typename Reducer, typename T>
+struct simd_reducer_kind
+    : std::integral_constant<simd_reduce_kind, simd_reduce_kind::none> {};
+
+template <typename T>
+struct simd_reducer_kind<std::plus<T>, T>
+    : std::integral_constant<simd_reduce_kind, simd_reduce_kind::plus> {};
+
+template <typename T>
+struct simd_reducer_kind<std::plus<>, T>
+    : std::integral_constant<simd_reduce_kind, simd_reduce_kind::plus> {};
+
+template <typename T>
+struct simd_reducer_kind<std::multiplies<T>, T>
+    : std::integral_constant<simd_reduce_kind, simd_reduce_kind::multiplies> {
+};
+
+template <typename T>
+struct simd_reducer_kind<std::multiplies<>, T>
+    : std::integral_constant<simd_reduce_kind, simd_reduce_kind::multiplies> {
+};
+
+template <typename T>
+struct simd_reducer_kind<minimum<T>, T>
+    : std::integral_constant<simd_reduce_kind, simd_reduce_kind::minimum> {};
+
+template <typename T>
+struct simd_reducer_kind<maximum<T>, T>
+    : std::integral_constant<simd_reduce_kind, simd_reduce_kind::maximum> {};
+
+template <typename T>
+constexpr bool is_simd_int32_v =
+    std::is_integral_v<T> && !std::is_same_v<T, bool> && sizeof(T) == 4;
+
+template <typename T>
+constexpr bool is_simd_int64_v =
+    std::is_integral_v<T> && !std::is_same_v<T, bool> && sizeof(T) == 8;
+
+// Computes dst[i] = reduce(src[2 * i], src[2 * i + 1]) for a prefix of
+// [0, count) with vector instructions and returns the length of the prefix.
+// The even element is passed as the left operand, as the scalar code does.
+template <simd_reduce_kind Kind, typename T>
+size_t reduce_pairs_simd([[maybe_unused]] const T* src,
+                         [[maybe_unused]] T* dst,
+                         [[maybe_unused]] size_t count) {
+  [[maybe_unused]] constexpr bool is_plus = Kind == simd_reduce_kind::plus;
+  [[maybe_unused]] constexpr bool is_multiplies =
+      Kind == simd_reduce_kind::multiplies;
+  [[maybe_unused]] constexpr bool is_minimum =
+      Kind == simd_reduce_kind::minimum;
+  [[maybe_unused]] constexpr bool is_signed = std::is_signed_v<T>;
+  size_t i = 0;
+
+#if defined(__AVX2__)
+  if constexpr (is_simd_int32_v<T> || std::is_same_v<T, float>) {
+    for (; i + 8 <= count; i += 8) {
+      const __m256 lhs = _mm256_loadu_ps(reinterpret_cast<const float*>(src) +
+                                         2 * i);
+      const __m256 rhs = _mm256_loadu_ps(reinterpret_cast<const float*>(src) +
+                                         2 * i + 8);
+      // Lanes are [e0, e2, e4, e6 | e8, e10, e12, e14] after the permutation.
+      const __m256 even = _mm256_shuffle_ps(lhs, rhs, _MM_SHUFFLE(2, 0, 2, 0));
+      const __m256 odd = _mm256_shuffle_ps(lhs, rhs, _MM_SHUFFLE(3, 1, 3, 1));
+      __m256 result;
+      if constexpr (std::is_same_v<T, float>) {
+        if constexpr (is_plus) {
+          result = _mm256_add_ps(even, odd);
+        } else if constexpr (is_multiplies) {
+          result = _mm256_mul_ps(even, odd);
+        } else if constexpr (is_minimum) {
+          result = _mm256_min_ps(odd, even);
+        } else {
+          result = _mm256_max_ps(odd, even);
+        }
+      } else {
+        const __m256i even_i = _mm256_castps_si256(even);
+        const __m256i odd_i = _mm256_castps_si256(odd);
+        __m256i result_i;
+        if constexpr (is_plus) {
+          result_i = _mm256_add_epi32(even_i, odd_i);
+        } else if constexpr (is_multiplies) {
+          result_i = _mm256_mullo_epi32(even_i, odd_i);
+        } else if constexpr (is_minimum && is_signed) {
+          result_i = _mm256_min_epi32(even_i, odd_i);
+        } else if constexpr (is_minimum) {
+          result_i = _mm256_min_epu32(even_i, odd_i);
+        } else if constexpr (is_signed) {
+          result_i = _mm256_max_epi32(even_i, odd_i);
+        } else {
+          result_i = _mm256_max_epu32(even_i, odd_i);
+        }
+        result = _mm256_castsi256_ps(result_i);
+      }
+      result = _mm256_castpd_ps(_mm256_permute4x64_pd(
+          _mm256_castps_pd(result), _MM_SHUFFLE(3, 1, 2, 0)));
+      _mm256_storeu_ps(reinterpret_cast<float*>(dst) + i, result);
+    }
+  } else if constexpr ((is_simd_int64_v<T> && is_plus) ||
+                       std::is_same_v<T, double>) {
+    for (; i + 4 <= count; i += 4) {
+      const __m256d lhs = _mm256_loadu_pd(reinterpret_cast<const double*>(src) +
+                                          2 * i);
+      const __m256d rhs = _mm256_loadu_pd(reinterpret_cast<const double*>(src) +
+                                          2 * i + 4);
+      // Lanes are [e0, e4 | e2, e6] before the permutation.
+      const __m256d even = _mm256_unpacklo_pd(lhs, rhs);
+      const __m256d odd = _mm256_unpackhi_pd(lhs, rhs);
+      __m256d result;
+      if constexpr (std::is_same_v<T, double>) {
+        if constexpr (is_plus) {
+          result = _mm256_add_pd(even, odd);
+        } else if constexpr (is_multiplies) {
+          result = _mm256_mul_pd(even, odd);
+        } else if constexpr (is_minimum) {
+          result = _mm256_min_pd(odd, even);
+        } else {
+          result = _mm256_max_pd(odd, even);
+        }
+      } else {
+        result = _mm256_castsi256_pd(_mm256_add_epi64(
+            _mm256_castpd_si256(even), _mm256_castpd_si256(odd)));
+      }
+      result = _mm256_permute4x64_pd(result, _MM_SHUFFLE(3, 1, 2, 0));
+      _mm256_storeu_pd(reinterpret_cast<double*>(dst) + i, result);
+    }
+  }
+#elif defined(__SSE4_1__) || defined(MANAVRION_SEGMENT_TREE_SSE2)
+#if defined(__SSE4_1__)
+  constexpr bool has_int32_kernel = true;
+#else
+  constexpr bool has_int32_kernel = is_plus;
+#endif
+  if constexpr ((is_simd_int32_v<T> && has_int32_kernel) ||
+                std::is_same_v<T, float>) {
+    for (; i + 4 <= count; i += 4) {
+      const __m128 lhs =
+          _mm_loadu_ps(reinterpret_cast<const float*>(src) + 2 * i);
+      const __m128 rhs =
+          _mm_loadu_ps(reinterpret_cast<const float*>(src) + 2 * i + 4);
+      const __m128 even = _mm_shuffle_ps(lhs, rhs, _MM_SHUFFLE(2, 0, 2, 0));
+      const __m128 odd = _mm_shuffle_ps(lhs, rhs, _MM_SHUFFLE(3, 1, 3, 1));
+      __m128 result;
+      if constexpr (std::is_same_v<T, float>) {
+        if constexpr (is_plus) {
+          result = _mm_add_ps(even, odd);
+        } else if constexpr (is_multiplies) {
+          result = _mm_mul_ps(even, odd);
+        } else if constexpr (is_minimum) {
+          result = _mm_min_ps(odd, even);
+        } else {
+          result = _mm_max_ps(odd, even);
+        }
+      } else {
+        const __m128i even_i = _mm_castps_si128(even);
+        const __m128i odd_i = _mm_castps_si128(odd);
+        __m128i result_i;
+        if constexpr (is_plus) {
+          result_i = _mm_add_epi32(even_i, odd_i);
+        }
+#if defined(__SSE4_1__)
+        else if constexpr (is_multiplies) {
+          result_i = _mm_mullo_epi32(even_i, odd_i);
+        } else if constexpr (is_minimum && is_signed) {
+          result_i = _mm_min_epi32(even_i, odd_i);
+        } else if constexpr (is_minimum) {
+          result_i = _mm_min_epu32(even_i, odd_i);
+        } else if constexpr (is_signed) {
+          result_i = _mm_max_epi32(even_i, odd_i);
+        } else {
+          result_i = _mm_max_epu32(even_i, odd_i);
+        }
+#endif
+        result = _mm_castsi128_ps(result_i);
+      }
+      _mm_storeu_ps(reinterpret_cast<float*>(dst) + i, result);
+    }
+  } else if constexpr ((is_simd_int64_v<T> && is_plus) ||
+                       std::is_same_v<T, double>) {
+    for (; i + 2 <= count; i += 2) {
+      const __m128d lhs =
+          _mm_loadu_pd(reinterpret_cast<const double*>(src) + 2 * i);
+      const __m128d rhs =
+          _mm_loadu_pd(reinterpret_cast<const double*>(src) + 2 * i + 2);
+      const __m128d even = _mm_unpacklo_pd(lhs, rhs);
+      const __m128d odd = _mm_unpackhi_pd(lhs, rhs);
+      __m128d result;
+      if constexpr (std::is_same_v<T, double>) {
+        if constexpr (is_plus) {
+          result = _mm_add_pd(even, odd);
+        } else if constexpr (is_multiplies) {
+          result = _mm_mul_pd(even, odd);
+        } else if constexpr (is_minimum) {
+          result = _mm_min_pd(odd, even);
+        } else {
+          result = _mm_max_pd(odd, even);
+        }
+      } else {
+        result = _mm_castsi128_pd(
+            _mm_add_epi64(_mm_castpd_si128(even), _mm_castpd_si128(odd)));
+      }
+      _mm_storeu_pd(reinterpret_cast<double*>(dst) + i, result);
+    }
+  }
+#endif
+
+  return i;
+}
+
+// Computes dst[i] = reduce(src[2 * i], src[2 * i + 1]) for i in [0, count).
+// Time complexity - O(count).
+template <typename T, typename Reducer>
+void reduce_pairs(const T* src, T* dst, size_t count, const Reducer& reduce) {
+  constexpr simd_reduce_kind kind = simd_reducer_kind<Reducer, T>::value;
+  size_t i = 0;
+  if constexpr (kind != simd_reduce_kind::none) {
+    i = reduce_pairs_simd<kind>(src, dst, count);
+  }
+  for (; i < count; ++i) {
+    dst[i] = reduce(src[2 * i], src[2 * i + 1]);
+  }
+}
+
+#if defined(__AVX2__)
+template <simd_reduce_kind Kind, bool Signed>
+__m256i simd_apply_epi32(__m256i lhs, __m256i rhs) {
+  if constexpr (Kind == simd_reduce_kind::plus) {
+    return _mm256_add_epi32(lhs, rhs);
+  } else if constexpr (Kind == simd_reduce_kind::multiplies) {
+    return _mm256_mullo_epi32(lhs, rhs);
+  } else if constexpr (Kind == simd_reduce_kind::minimum) {
+    return Signed ? _mm256_min_epi32(lhs, rhs) : _mm256_min_epu32(lhs, rhs);
+  } else {
+    return Signed ? _mm256_max_epi32(lhs, rhs) : _mm256_max_epu32(lhs, rhs);
+  }
+}
+
+template <simd_reduce_kind Kind>
+__m256i simd_apply_epi64(__m256i lhs, __m256i rhs) {
+  if constexpr (Kind == simd_reduce_kind::plus) {
+    return _mm256_add_epi64(lhs, rhs);
+  } else if constexpr (Kind == simd_reduce_kind::minimum) {
+    return _mm256_blendv_epi8(lhs, rhs, _mm256_cmpgt_epi64(lhs, rhs));
+  } else {
+    return _mm256_blendv_epi8(rhs, lhs, _mm256_cmpgt_epi64(lhs, rhs));
+  }
+}
+
+template <simd_reduce_kind Kind>
+__m256 simd_apply_ps(__m256 lhs, __m256 rhs) {
+  if constexpr (Kind == simd_reduce_kind::plus) {
+    return _mm256_add_ps(lhs, rhs);
+  } else if constexpr (Kind == simd_reduce_kind::multiplies) {
+    return _mm256_mul_ps(lhs, rhs);
+  } else if constexpr (Kind == simd_reduce_kind::minimum) {
+    return _mm256_min_ps(rhs, lhs);
+  } else {
+    return _mm256_max_ps(rhs, lhs);
+  }
+}
+
+template <simd_reduce_kind Kind>
+__m256d simd_apply_pd(__m256d lhs, __m256d rhs) {
+  if constexpr (Kind == simd_reduce_kind::plus) {
+    return _mm256_add_pd(lhs, rhs);
+  } else if constexpr (Kind == simd_reduce_kind::multiplies) {
+    return _mm256_mul_pd(lhs, rhs);
+  } else if constexpr (Kind == simd_reduce_kind::minimum) {
+    return _mm256_min_pd(rhs, lhs);
+  } else {
+    return _mm256_max_pd(rhs, lhs);
+  }
+}
+#endif
+
+// Returns true if reduce_block_simd() has a kernel for T and B.
+template <simd_reduce_kind Kind, typename T, size_t B>
+constexpr bool has_reduce_block_simd() {
+#if defined(__AVX2__)
+  if constexpr (Kind == simd_reduce_kind::none) {
+    return false;
+  } else if constexpr (is_simd_int32_v<T> || std::is_same_v<T, float>) {
+    return B % 8 == 0;
+  } else if constexpr (std::is_same_v<T, double>) {
+    return B % 4 == 0;
+  } else if constexpr (is_simd_int64_v<T> && std::is_signed_v<T>) {
+    return B % 4 == 0 && Kind != simd_reduce_kind::multiplies;
+  } else {
+    return false;
+  }
+#else
+  return false;
+#endif
+}
+
+// Reduces block[from, to) with vector instructions. The elements outside of
+// [from, to) are loaded as well and masked with the identity element, so all
+// B elements of the block must be readable.
+template <simd_reduce_kind Kind, size_t B, typename T, typename Reducer>
+T reduce_block_simd([[maybe_unused]] const T* block,
+                    [[maybe_unused]] size_t from, [[maybe_unused]] size_t to,
+                    [[maybe_unused]] const Reducer& reduce) {
+  static_assert(has_reduce_block_simd<Kind, T, B>());
+  static_assert(monoid_traits<Reducer, T>::has_identity);
+  T result = monoid_traits<Reducer, T>::identity();
+#if defined(__AVX2__)
+  constexpr size_t lanes = 32 / sizeof(T);
+  alignas(32) T accumulated[lanes];
+  if constexpr (sizeof(T) == 4) {
+    int32_t identity_bits;
+    std::memcpy(&identity_bits, &result, sizeof(T));
+    const __m256i identity = _mm256_set1_epi32(identity_bits);
+    const __m256i lower = _mm256_set1_epi32(static_cast<int32_t>(from) - 1);
+    const __m256i upper = _mm256_set1_epi32(static_cast<int32_t>(to));
+    __m256i index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i accumulator = identity;
+    for (size_t i = 0; i < B; i += lanes) {
+      const __m256i mask = _mm256_and_si256(_mm256_cmpgt_epi32(index, lower),
+                                            _mm256_cmpgt_epi32(upper, index));
+      const __m256i value = _mm256_blendv_epi8(
+          identity,
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + i)),
+          mask);
+      if constexpr (std::is_same_v<T, float>) {
+        accumulator = _mm256_castps_si256(simd_apply_ps<Kind>(
+            _mm256_castsi256_ps(accumulator), _mm256_castsi256_ps(value)));
+      } else {
+        accumulator =
+            simd_apply_epi32<Kind, std::is_signed_v<T>>(accumulator, value);
+      }
+      index = _mm256_add_epi32(index, _mm256_set1_epi32(lanes));
+    }
+    _mm256_store_si256(reinterpret_cast<__m256i*>(accumulated), accumulator);
+  } else {
+    int64_t identity_bits;
+    std::memcpy(&identity_bits, &result, sizeof(T));
+    const __m256i identity = _mm256_set1_epi64x(identity_bits);
+    const __m256i lower = _mm256_set1_epi64x(static_cast<int64_t>(from) - 1);
+    const __m256i upper = _mm256_set1_epi64x(static_cast<int64_t>(to));
+    __m256i index = _mm256_setr_epi64x(0, 1, 2, 3);
+    __m256i accumulator = identity;
+    for (size_t i = 0; i < B; i += lanes) {
+      const __m256i mask = _mm256_and_si256(_mm256_cmpgt_epi64(index, lower),
+                                            _mm256_cmpgt_epi64(upper, index));
+      const __m256i value = _mm256_blendv_epi8(
+          identity,
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + i)),
+          mask);
+      if constexpr (std::is_same_v<T, double>) {
+        accumulator = _mm256_castpd_si256(simd_apply_pd<Kind>(
+            _mm256_castsi256_pd(accumulator), _mm256_castsi256_pd(value)));
+      } else {
+        accumulator = simd_apply_epi64<Kind>(accumulator, value);
+      }
+      index = _mm256_add_epi64(index, _mm256_set1_epi64x(lanes));
+    }
+    _mm256_store_si256(reinterpret_cast<__m256i*>(accumulated), accumulator);
+  }
+  result = accumulated[0];
+  for (size_t i = 1; i < lanes; ++i) {
+    result = reduce(result, accumulated[i]);
+  }
+#endif
+  return result;
+}
+
+// Reduces non-empty block[from, to), where all B elements of the block are
+// readable.
+// Time complexity - O(B).
+template <size_t B, typename T, typename Reducer>
+T reduce_block(const T* block, size_t from, size_t to, const Reducer& reduce) {
+  assert(from < to && to <= B);
+  constexpr simd_reduce_kind kind = simd_reducer_kind<Reducer, T>::value;
+  if constexpr (has_reduce_block_simd<kind, T, B>()) {
+    return reduce_block_simd<kind, B>(block, from, to, reduce);
+  } else {
+    T result = block[from];
+    for (size_t i = from + 1; i < to; ++i) {
+      result = reduce(std::move(result), block[i]);
+    }
+    return result;
+  }
+}
+
+// Computes dst[i] = reduce(lhs[i], rhs[i]) for i in [0, count).
+// Time complexity - O(count).
+template <typename T, typename Reducer>
+void reduce_elementwise(const T* lhs, const T* rhs, T* dst, size_t count,
+                        const Reducer& reduce) {
+  [[maybe_unused]] constexpr simd_reduce_kind kind =
+      simd_reducer_kind<Reducer, T>::value;
+  size_t i = 0;
+#if defined(__AVX2__)
+  if constexpr (kind == simd_reduce_kind::none) {
+  } else if constexpr (is_simd_int32_v<T> || std::is_same_v<T, float>) {
+    for (; i + 8 <= count; i += 8) {
+      const __m256i x =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lhs + i));
+      const __m256i y =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rhs + i));
+      __m256i result;
+      if constexpr (std::is_same_v<T, float>) {
+        result = _mm256_castps_si256(simd_apply_ps<kind>(
+            _mm256_castsi256_ps(x), _mm256_castsi256_ps(y)));
+      } else {
+        result = simd_apply_epi32<kind, std::is_signed_v<T>>(x, y);
+      }
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), result);
+    }
+  } else if constexpr (std::is_same_v<T, double> ||
+                       (is_simd_int64_v<T> && std::is_signed_v<T> &&
+                        kind != simd_reduce_kind::multiplies)) {
+    for (; i + 4 <= count; i += 4) {
+      const __m256i x =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lhs + i));
+      const __m256i y =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rhs + i));
+      __m256i result;
+      if constexpr (std::is_same_v<T, double>) {
+        result = _mm256_castpd_si256(simd_apply_pd<kind>(
+            _mm256_castsi256_pd(x), _mm256_castsi256_pd(y)));
+      } else {
+        result = simd_apply_epi64<kind>(x, y);
+      }
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), result);
+    }
+  }
+#endif
+  for (; i < count; ++i) {
+    dst[i] = reduce(lhs[i], rhs[i]);
+  }
+}
+
+}  // namespace manavrion::segment_tree::details
@@ -0,0 +1,422 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "manavrion/segment_tree/details.h"
+#include "manavrion/segment_tree/functional.h"
+#include "manavrion/segment_tree/simd.h"
+
+namespace manavrion::segment_tree {
+
+// Sparse table of static elements for idempotent reducers.
+//
+// The level k holds the reductions of the 2^k elements which start at every
+// index, a query reduces two of them which overlap and cover the segment.
+// The table takes n * (floor(log n) + 1) values.
+template <typename T, typename Reducer = minimum<T>,
+          typename Allocator = std::allocator<T>>
+class sparse_table : private Reducer {
+  static_assert(monoid_traits<Reducer, T>::is_idempotent,
+                "sparse_table requires an idempotent reducer, specialize "
+                "monoid_traits for it");
+
+ public:
+  using allocator_type = Allocator;
+  using value_type = T;
+  using container_type = std::vector<value_type, allocator_type>;
+  using size_type = typename container_type::size_type;
+  using difference_type = typename container_type::difference_type;
+  using const_reference = typename container_type::const_reference;
+  using const_pointer = typename container_type::const_pointer;
+  using const_iterator = typename container_type::const_iterator;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  using reducer_type = Reducer;
+
+ private:
+  const Reducer& reducer() const& { return *static_cast<const Reducer*>(this); }
+
+  // Returns the first value of the level k.
+  const T* level(size_t k) const { return table_.data() + k * size_; }
+  T* level(size_t k) { return table_.data() + k * size_; }
+
+  template <typename InputIt>
+  void init_table(InputIt first, InputIt last) {
+    table_.assign(first, last);
+    size_ = table_.size();
+  }
+
+  // Creates the levels from the elements, every level is computed from the
+  // previous one by one vectorized pass.
+  // Time complexity - O(n log n).
+  void build_table() {
+    if (size_ == 0) {
+      return;
+    }
+    const size_t levels = details::floor_log2(size_) + 1;
+    table_.resize(levels * size_);
+    for (size_t k = 1; k < levels; ++k) {
+      const size_t half = size_t{1} << (k - 1);
+      const size_t count = size_ - 2 * half + 1;
+      const T* previous = level(k - 1);
+      details::reduce_elementwise(previous, previous + half, level(k), count,
+                                  reducer());
+    }
+  }
+
+ public:
+  sparse_table() = default;
+
+  explicit sparse_table(const Allocator& allocator) : table_(allocator) {}
+
+  explicit sparse_table(Reducer reducer, const Allocator& allocator = {})
+      : Reducer(std::move(reducer)), table_(allocator) {}
+
+  // Time complexity - O(n log n).
+  template <typename InputIt, typename = details::require_input_iter<InputIt>>
+  sparse_table(InputIt first, InputIt last, Reducer reducer = {},
+               const Allocator& allocator = {})
+      : Reducer(std::move(reducer)), table_(allocator) {
+    init_table(first, last);
+    build_table();
+  }
+
+  // Time complexity - O(n log n).
+  template <typename InputIt, typename = details::require_input_iter<InputIt>>
+  sparse_table(InputIt first, InputIt last, const Allocator& allocator)
+      : table_(allocator) {
+    init_table(first, last);
+    build_table();
+  }
+
+  // Time complexity - O(n log n).
+  sparse_table(std::initializer_list<T> init_list, Reducer reducer = {},
+               const Allocator& allocator = {})
+      : Reducer(std::move(reducer)), table_(allocator) {
+    init_table(init_list.begin(), init_list.end());
+    build_table();
+  }
+
+  // Time complexity - O(n log n).
+  sparse_table(std::initializer_list<T> init_list, const Allocator& allocator)
+      : table_(allocator) {
+    init_table(init_list.begin(), init_list.end());
+    build_table();
+  }
+
+  // Time complexity - O(n log n).
+  sparse_table& operator=(std::initializer_list<T> init_list) {
+    init_table(init_list.begin(), init_list.end());
+    build_table();
+    return *this;
+  }
+
+  // Time complexity - O(n log n).
+  void assign(size_type count, const T& value) {
+    table_.assign(count, value);
+    size_ = count;
+    build_table();
+  }
+
+  // Time complexity - O(n log n).
+  template <class InputIt, typename = details::require_input_iter<InputIt>>
+  void assign(InputIt first, InputIt last) {
+    init_table(first, last);
+    build_table();
+  }
+
+  // Time complexity - O(n log n).
+  void assign(std::initializer_list<T> init_list) { operator=(init_list); }
+
+  // Time complexity - O(1).
+  [[nodiscard]] allocator_type get_allocator() const noexcept {
+    return table_.get_allocator();
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_reference at(size_type pos) const {
+    if (pos >= size()) {
+      throw std::out_of_range("sparse_table::at");
+    }
+    return table_[pos];
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_reference operator[](size_type pos) const {
+    assert(pos < size());
+    return table_[pos];
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const T* data() const noexcept { return table_.data(); }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_iterator begin() const noexcept { return cbegin(); }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_iterator cbegin() const noexcept {
+    return table_.cbegin();
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_iterator end() const noexcept { return cend(); }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_iterator cend() const noexcept {
+    return table_.cbegin() + size_;
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_reverse_iterator rbegin() const noexcept {
+    return crbegin();
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_reverse_iterator crbegin() const noexcept {
+    return const_reverse_iterator(cend());
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_reverse_iterator rend() const noexcept {
+    return crend();
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_reverse_iterator crend() const noexcept {
+    return const_reverse_iterator(cbegin());
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+
+  // Time complexity - O(1).
+  [[nodiscard]] size_type size() const noexcept { return size_; }
+
+  // Returns the number of bytes allocated for the levels.
+  // Time complexity - O(1).
+  [[nodiscard]] size_t bytes_used() const noexcept {
+    return table_.capacity() * sizeof(T);
+  }
+
+  // Time complexity - O(n log n).
+  void clear() noexcept {
+    table_.clear();
+    size_ = 0;
+  }
+
+  // Make a query on [first_index, last_index) segment.
+  // Time complexity - O(1).
+  [[nodiscard]] T query(size_t first_index, size_t last_index) const {
+    assert(first_index <= last_index);
+    assert(last_index <= size());
+    if (first_index == last_index) {
+      return details::empty_result<Reducer, T>();
+    }
+    const size_t k = details::floor_log2(last_index - first_index);
+    const T* values = level(k);
+    return reducer()(values[first_index],
+                     values[last_index - (size_t{1} << k)]);
+  }
+
+ private:
+  std::vector<T, Allocator> table_;
+  size_t size_ = 0;
+};
+
+// Disjoint sparse table of static elements for any associative reducer.
+//
+// The level h splits the elements into blocks of 2^(h + 1) elements. The
+// values of the first half of a block reduce the elements from the value to
+// the middle of the block, the values of the second half reduce the elements
+// from the middle to the value. The first and the last elements of a query
+// differ in the bit h for exactly one h, so the query reduces two values of
+// the level h. Elements are mapped as in mapped_segment_tree, the table takes
+// n * ceil(log n) mapped values.
+template <typename T, typename Reducer = std::plus<T>,
+          typename Mapper = details::deduce_mapper<T, Reducer>,
+          typename Allocator =
+              std::allocator<std::decay_t<std::invoke_result_t<Mapper, T>>>>
+class disjoint_sparse_table : private Reducer, private Mapper {
+  static_assert(std::is_invocable_v<Mapper, T>);
+  using mapper_result = std::decay_t<std::invoke_result_t<Mapper, T>>;
+  static_assert(std::is_invocable_v<Reducer, mapper_result, mapper_result>);
+  static_assert(std::is_constructible_v<
+                mapper_result,
+                std::invoke_result_t<Reducer, mapper_result, mapper_result>>);
+
+ public:
+  using allocator_type = Allocator;
+  using value_type = T;
+  using table_value_type = mapper_result;
+  using container_type = std::vector<table_value_type, allocator_type>;
+  using size_type = typename container_type::size_type;
+
+  using reducer_type = Reducer;
+  using mapper_type = Mapper;
+
+ private:
+  const Reducer& reducer() const& { return *static_cast<const Reducer*>(this); }
+  const Mapper& mapper() const& { return *static_cast<const Mapper*>(this); }
+
+  // Returns the first value of the level h.
+  const table_value_type* level(size_t h) const {
+    return table_.data() + h * size_;
+  }
+  table_value_type* level(size_t h) { return table_.data() + h * size_; }
+
+  // Maps the elements to the level 0, whose values are the elements.
+  template <typename InputIt>
+  void init_table(InputIt first, InputIt last) {
+    const auto& map = mapper();
+    table_.clear();
+    for (; first != last; ++first) {
+      table_.push_back(map(*first));
+    }
+    size_ = table_.size();
+  }
+
+  // Creates the levels from the level 0.
+  // Time complexity - O(n log n).
+  void build_table() {
+    if (size_ < 2) {
+      return;
+    }
+    const auto& reduce = reducer();
+    const size_t levels = details::floor_log2(size_ - 1) + 1;
+    table_.resize(levels * size_);
+    const table_value_type* elements = level(0);
+    for (size_t h = 1; h < levels; ++h) {
+      const size_t half = size_t{1} << h;
+      table_value_type* values = level(h);
+      // Blocks which end before the middle are never queried on this level.
+      for (size_t middle = half; middle < size_; middle += 2 * half) {
+        values[middle - 1] = elements[middle - 1];
+        for (size_t i = middle - 1; i-- > middle - half;) {
+          values[i] = reduce(elements[i], values[i + 1]);
+        }
+        const size_t block_last = std::min(middle + half, size_);
+        values[middle] = elements[middle];
+        for (size_t i = middle + 1; i < block_last; ++i) {
+          values[i] = reduce(values[i - 1], elements[i]);
+        }
+      }
+    }
+  }
+
+ public:
+  disjoint_sparse_table() = default;
+
+  explicit disjoint_sparse_table(const Allocator& allocator)
+      : table_(allocator) {}
+
+  explicit disjoint_sparse_table(Reducer reducer, Mapper mapper = {},
+                                 const Allocator& allocator = {})
+      : Reducer(std::move(reducer)),
+        Mapper(std::move(mapper)),
+        table_(allocator) {}
+
+  // Time complexity - O(n log n).
+  template <typename InputIt, typename = details::require_input_iter<InputIt>>
+  disjoint_sparse_table(InputIt first, InputIt last, Reducer reducer = {},
+                        Mapper mapper = {}, const Allocator& allocator = {})
+      : Reducer(std::move(reducer)),
+        Mapper(std::move(mapper)),
+        table_(allocator) {
+    init_table(first, last);
+    build_table();
+  }
+
+  // Time complexity - O(n log n).
+  template <typename InputIt, typename = details::require_input_iter<InputIt>>
+  disjoint_sparse_table(InputIt first, InputIt last,
+                        const Allocator& allocator)
+      : table_(allocator) {
+    init_table(first, last);
+    build_table();
+  }
+
+  // Time complexity - O(n log n).
+  disjoint_sparse_table(std::initializer_list<T> init_list,
+                        Reducer reducer = {}, Mapper mapper = {},
+                        const Allocator& allocator = {})
+      : Reducer(std::move(reducer)),
+        Mapper(std::move(mapper)),
+        table_(allocator) {
+    init_table(init_list.begin(), init_list.end());
+    build_table();
+  }
+
+  // Time complexity - O(n log n).
+  disjoint_sparse_table& operator=(std::initializer_list<T> init_list) {
+    init_table(init_list.begin(), init_list.end());
+    build_table();
+    return *this;
+  }
+
+  // Time complexity - O(n log n).
+  template <class InputIt, typename = details::require_input_iter<InputIt>>
+  void assign(InputIt first, InputIt last) {
+    init_table(first, last);
+    build_table();
+  }
+
+  // Time complexity - O(n log n).
+  void assign(std::initializer_list<T> init_list) { operator=(init_list); }
+
+  // Time complexity - O(1).
+  [[nodiscard]] allocator_type get_allocator() const noexcept {
+    return table_.get_allocator();
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+
+  // Time complexity - O(1).
+  [[nodiscard]] size_type size() const noexcept { return size_; }
+
+  // Returns the number of bytes allocated for the levels.
+  // Time complexity - O(1).
+  [[nodiscard]] size_t bytes_used() const noexcept {
+    return table_.capacity() * sizeof(table_value_type);
+  }
+
+  // Time complexity - O(n log n).
+  void clear() noexcept {
+    table_.clear();
+    size_ = 0;
+  }
+
+  // Make a query on [first_index, last_index) segment.
+  // Time complexity - O(1).
+  [[nodiscard]] table_value_type query(size_t first_index,
+                                       size_t last_index) const {
+    assert(first_index <= last_index);
+    assert(last_index <= size());
+    if (first_index == last_index) {
+      return details::empty_result<Reducer, table_value_type>();
+    }
+    const size_t last = last_index - 1;
+    if (first_index == last) {
+      return level(0)[first_index];
+    }
+    const table_value_type* values =
+        level(details::floor_log2(first_index ^ last));
+    return reducer()(values[first_index], values[last]);
+  }
+
+ private:
+  std::vector<table_value_type, Allocator> table_;
+  size_t size_ = 0;
+};
+
+}  // namespace manavrion::segment_tree
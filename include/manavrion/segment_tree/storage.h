@@ -0,0 +1,436 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "manavrion/segment_tree/details.h"
+#include "manavrion/segment_tree/simd.h"
+
+// Tells the compiler that the iterations of the next loop do not depend on
+// each other, so the loop is vectorized without checks of overlapping arrays.
+#if defined(__clang__)
+#define MANAVRION_SEGMENT_TREE_INDEPENDENT_LOOP \
+  _Pragma("clang loop vectorize(assume_safety)")
+#elif defined(__GNUC__)
+#define MANAVRION_SEGMENT_TREE_INDEPENDENT_LOOP _Pragma("GCC ivdep")
+#else
+#define MANAVRION_SEGMENT_TREE_INDEPENDENT_LOOP
+#endif
+
+namespace manavrion::segment_tree {
+
+// Lists the fields of the struct V for soa_storage as a tuple of pointers to
+// its members, for example:
+//
+// template <>
+// struct soa_fields<quad> {
+//   static constexpr auto members =
+//       std::make_tuple(&quad::sum, &quad::mul, &quad::min, &quad::max);
+// };
+//
+// Tuple-like types such as std::pair, std::tuple and std::array are split
+// by std::get and need no specialization.
+template <typename V>
+struct soa_fields;
+
+namespace details {
+
+template <typename V, typename = void>
+struct has_soa_fields : std::false_type {};
+
+template <typename V>
+struct has_soa_fields<V, std::void_t<decltype(soa_fields<V>::members)>>
+    : std::true_type {};
+
+// Gives access to the fields of V by their indexes.
+template <typename V>
+struct soa_access {
+  static constexpr size_t size() {
+    if constexpr (has_soa_fields<V>::value) {
+      return std::tuple_size_v<std::decay_t<decltype(soa_fields<V>::members)>>;
+    } else {
+      return std::tuple_size_v<V>;
+    }
+  }
+
+  template <size_t I, typename U>
+  static constexpr decltype(auto) get(U& value) {
+    if constexpr (has_soa_fields<V>::value) {
+      return (value.*std::get<I>(soa_fields<V>::members));
+    } else {
+      return (std::get<I>(value));
+    }
+  }
+};
+
+// Vector of V which keeps one array per field of V. A value is assembled from
+// its fields when it is read, so references are proxies.
+template <typename V, typename Allocator>
+class soa_vector {
+  using access = soa_access<V>;
+  static constexpr size_t field_count = access::size();
+  using field_indexes = std::make_index_sequence<field_count>;
+
+  template <size_t I>
+  using field_type =
+      std::decay_t<decltype(access::template get<I>(std::declval<V&>()))>;
+
+  template <size_t I>
+  using field_vector = std::vector<
+      field_type<I>, typename std::allocator_traits<
+                         Allocator>::template rebind_alloc<field_type<I>>>;
+
+  template <typename Indexes>
+  struct fields_of;
+
+  template <size_t... Is>
+  struct fields_of<std::index_sequence<Is...>> {
+    using type = std::tuple<field_vector<Is>...>;
+  };
+
+  using fields_type = typename fields_of<field_indexes>::type;
+
+  template <size_t... Is>
+  static fields_type make_fields(const Allocator& allocator,
+                                 std::index_sequence<Is...>) {
+    return fields_type(field_vector<Is>(
+        typename field_vector<Is>::allocator_type(allocator))...);
+  }
+
+  template <typename Fields, size_t... Is>
+  static auto data(Fields& fields, std::index_sequence<Is...>) {
+    return std::make_tuple(std::get<Is>(fields).data()...);
+  }
+
+  template <typename Pointers, size_t... Is>
+  static V load(const Pointers& pointers, size_t i,
+                std::index_sequence<Is...>) {
+    V value{};
+    ((access::template get<Is>(value) = std::get<Is>(pointers)[i]), ...);
+    return value;
+  }
+
+  template <typename Pointers, size_t... Is>
+  static void store(const Pointers& pointers, size_t i, const V& value,
+                    std::index_sequence<Is...>) {
+    ((std::get<Is>(pointers)[i] = access::template get<Is>(value)), ...);
+  }
+
+  template <typename F>
+  void for_each_field(F&& f) {
+    std::apply([&f](auto&... fields) { (f(fields), ...); }, fields_);
+  }
+
+  template <typename F>
+  void for_each_field(F&& f) const {
+    std::apply([&f](const auto&... fields) { (f(fields), ...); }, fields_);
+  }
+
+  auto pointers() { return data(fields_, field_indexes{}); }
+
+  auto pointers() const { return data(fields_, field_indexes{}); }
+
+ public:
+  using value_type = V;
+  using allocator_type = Allocator;
+  using size_type = size_t;
+  using difference_type = std::ptrdiff_t;
+  using pointer = void;
+  using const_pointer = void;
+
+  class reference {
+   public:
+    reference(soa_vector* vector, size_t index)
+        : vector_(vector), index_(index) {}
+    reference(const reference& other) = default;
+
+    operator V() const { return vector_->load(index_); }
+
+    reference& operator=(const V& value) {
+      vector_->store(index_, value);
+      return *this;
+    }
+
+    reference& operator=(const reference& other) {
+      return *this = static_cast<V>(other);
+    }
+
+   private:
+    soa_vector* vector_;
+    size_t index_;
+  };
+
+  using const_reference = V;
+
+  template <bool IsConst>
+  class basic_iterator {
+    using vector_pointer =
+        std::conditional_t<IsConst, const soa_vector*, soa_vector*>;
+
+   public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = V;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference =
+        std::conditional_t<IsConst, V, typename soa_vector::reference>;
+
+    basic_iterator() = default;
+    basic_iterator(vector_pointer vector, size_t index)
+        : vector_(vector), index_(index) {}
+
+    reference operator*() const { return (*vector_)[index_]; }
+    reference operator[](difference_type n) const {
+      return (*vector_)[index_ + n];
+    }
+
+    basic_iterator& operator++() {
+      ++index_;
+      return *this;
+    }
+    basic_iterator operator++(int) { return {vector_, index_++}; }
+    basic_iterator& operator--() {
+      --index_;
+      return *this;
+    }
+    basic_iterator operator--(int) { return {vector_, index_--}; }
+    basic_iterator& operator+=(difference_type n) {
+      index_ += n;
+      return *this;
+    }
+    basic_iterator& operator-=(difference_type n) {
+      index_ -= n;
+      return *this;
+    }
+    basic_iterator operator+(difference_type n) const {
+      return {vector_, index_ + n};
+    }
+    friend basic_iterator operator+(difference_type n,
+                                    const basic_iterator& it) {
+      return it + n;
+    }
+    basic_iterator operator-(difference_type n) const {
+      return {vector_, index_ - n};
+    }
+    difference_type operator-(const basic_iterator& other) const {
+      return static_cast<difference_type>(index_) -
+             static_cast<difference_type>(other.index_);
+    }
+
+    bool operator==(const basic_iterator& other) const {
+      return index_ == other.index_;
+    }
+    bool operator!=(const basic_iterator& other) const {
+      return index_ != other.index_;
+    }
+    bool operator<(const basic_iterator& other) const {
+      return index_ < other.index_;
+    }
+    bool operator<=(const basic_iterator& other) const {
+      return index_ <= other.index_;
+    }
+    bool operator>(const basic_iterator& other) const {
+      return index_ > other.index_;
+    }
+    bool operator>=(const basic_iterator& other) const {
+      return index_ >= other.index_;
+    }
+
+   private:
+    vector_pointer vector_ = nullptr;
+    size_t index_ = 0;
+  };
+
+  using iterator = basic_iterator<false>;
+  using const_iterator = basic_iterator<true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  soa_vector() : soa_vector(Allocator()) {}
+
+  explicit soa_vector(const Allocator& allocator)
+      : fields_(make_fields(allocator, field_indexes{})) {}
+
+  soa_vector(const soa_vector& other) = default;
+  soa_vector(soa_vector&& other) noexcept = default;
+
+  soa_vector(soa_vector&& other, const Allocator& allocator)
+      : soa_vector(allocator) {
+    if (allocator == other.get_allocator()) {
+      fields_ = std::move(other.fields_);
+    } else {
+      resize(other.size());
+      const auto src = other.pointers();
+      const auto dst = pointers();
+      for (size_t i = 0; i < size(); ++i) {
+        store(dst, i, load(src, i, field_indexes{}), field_indexes{});
+      }
+    }
+  }
+
+  soa_vector& operator=(const soa_vector& other) = default;
+  soa_vector& operator=(soa_vector&& other) noexcept = default;
+
+  [[nodiscard]] allocator_type get_allocator() const {
+    return allocator_type(std::get<0>(fields_).get_allocator());
+  }
+
+  [[nodiscard]] V load(size_t i) const {
+    assert(i < size());
+    return load(pointers(), i, field_indexes{});
+  }
+
+  void store(size_t i, const V& value) {
+    assert(i < size());
+    store(pointers(), i, value, field_indexes{});
+  }
+
+  [[nodiscard]] reference operator[](size_t i) { return {this, i}; }
+  [[nodiscard]] const_reference operator[](size_t i) const { return load(i); }
+
+  [[nodiscard]] iterator begin() noexcept { return {this, 0}; }
+  [[nodiscard]] const_iterator begin() const noexcept { return {this, 0}; }
+  [[nodiscard]] iterator end() noexcept { return {this, size()}; }
+  [[nodiscard]] const_iterator end() const noexcept { return {this, size()}; }
+
+  [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+  [[nodiscard]] size_t size() const noexcept {
+    return std::get<0>(fields_).size();
+  }
+  [[nodiscard]] size_t capacity() const noexcept {
+    return std::get<0>(fields_).capacity();
+  }
+
+  void resize(size_t n) {
+    for_each_field([n](auto& field) { field.resize(n); });
+  }
+
+  void reserve(size_t n) {
+    for_each_field([n](auto& field) { field.reserve(n); });
+  }
+
+  void clear() noexcept {
+    for_each_field([](auto& field) { field.clear(); });
+  }
+
+  // Reduces count pairs of values which start at src to count values which
+  // start at dst. Every field is loaded and stored by its own array, so the
+  // loop is vectorized when the reducer computes the fields independently.
+  // The parents never overlap their children, so the iterations are
+  // independent.
+  // Time complexity - O(count).
+  template <typename Reducer>
+  void reduce_pairs(size_t src, size_t dst, size_t count,
+                    const Reducer& reduce) {
+    const auto data = pointers();
+    MANAVRION_SEGMENT_TREE_INDEPENDENT_LOOP
+    for (size_t i = 0; i < count; ++i) {
+      store(data, dst + i,
+            reduce(load(data, src + 2 * i, field_indexes{}),
+                   load(data, src + 2 * i + 1, field_indexes{})),
+            field_indexes{});
+    }
+  }
+
+  // Reduces count pairs of mapped values of the array src to count values
+  // which start at dst.
+  // Time complexity - O(count).
+  template <typename U, typename Mapper, typename Reducer>
+  void reduce_mapped_pairs(const U* src, size_t dst, size_t count,
+                           const Mapper& map, const Reducer& reduce) {
+    const auto data = pointers();
+    MANAVRION_SEGMENT_TREE_INDEPENDENT_LOOP
+    for (size_t i = 0; i < count; ++i) {
+      store(data, dst + i, reduce(map(src[2 * i]), map(src[2 * i + 1])),
+            field_indexes{});
+    }
+  }
+
+  // Hints the processor to fetch the fields of the value.
+  void prefetch(size_t i) const {
+    for_each_field([i](const auto& field) { details::prefetch(&field[i]); });
+  }
+
+ private:
+  fields_type fields_;
+};
+
+// Reduces count pairs of nodes which start at src to count nodes which start
+// at dst.
+template <typename V, typename A, typename Reducer>
+void reduce_node_pairs(std::vector<V, A>& nodes, size_t src, size_t dst,
+                       size_t count, const Reducer& reduce) {
+  reduce_pairs(nodes.data() + src, nodes.data() + dst, count, reduce);
+}
+
+template <typename V, typename A, typename Reducer>
+void reduce_node_pairs(soa_vector<V, A>& nodes, size_t src, size_t dst,
+                       size_t count, const Reducer& reduce) {
+  nodes.reduce_pairs(src, dst, count, reduce);
+}
+
+// Reduces count pairs of mapped values of the array src to count nodes which
+// start at dst.
+template <typename U, typename V, typename A, typename Mapper,
+          typename Reducer>
+void reduce_mapped_pairs_to_nodes(const U* src, std::vector<V, A>& nodes,
+                                  size_t dst, size_t count, const Mapper& map,
+                                  const Reducer& reduce) {
+  if constexpr (std::is_base_of_v<default_mapper, Mapper> &&
+                std::is_same_v<U, V>) {
+    reduce_pairs(src, nodes.data() + dst, count, reduce);
+  } else {
+    for (size_t i = 0; i < count; ++i) {
+      nodes[dst + i] = reduce(map(src[2 * i]), map(src[2 * i + 1]));
+    }
+  }
+}
+
+template <typename U, typename V, typename A, typename Mapper,
+          typename Reducer>
+void reduce_mapped_pairs_to_nodes(const U* src, soa_vector<V, A>& nodes,
+                                  size_t dst, size_t count, const Mapper& map,
+                                  const Reducer& reduce) {
+  nodes.reduce_mapped_pairs(src, dst, count, map, reduce);
+}
+
+template <typename V, typename A>
+void prefetch_node(const std::vector<V, A>& nodes, size_t i) {
+  prefetch(nodes.data() + i);
+}
+
+template <typename V, typename A>
+void prefetch_node(const soa_vector<V, A>& nodes, size_t i) {
+  nodes.prefetch(i);
+}
+
+}  // namespace details
+
+// Storage policies of the nodes of mapped_segment_tree, container<V, A> is
+// the container of the nodes.
+
+// Array of structures, the nodes are stored as a std::vector.
+struct aos_storage {
+  template <typename V, typename Allocator>
+  using container = std::vector<V, Allocator>;
+};
+
+// Structure of arrays, every field of the nodes is stored in its own array,
+// see soa_fields. A node is assembled from its fields when it is read, so
+// the reductions of a level load and store contiguous arrays of every field.
+struct soa_storage {
+  template <typename V, typename Allocator>
+  using container = details::soa_vector<V, Allocator>;
+};
+
+}  // namespace manavrion::segment_tree
@@ -0,0 +1,354 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "manavrion/segment_tree/details.h"
+
+namespace manavrion::segment_tree {
+
+namespace details {
+
+// 64 bits of a bit vector and the number of set bits before them, so a rank
+// takes one popcount.
+struct rank_block {
+  uint64_t bits = 0;
+  uint64_t rank = 0;
+};
+
+}  // namespace details
+
+// Wavelet matrix of static elements, which answers order statistics on
+// segments.
+//
+// The elements are replaced by the indexes of their values in the sorted
+// distinct values, which are called codes. The level k holds the bit k of
+// the codes from the most significant one, the codes are stably partitioned
+// by the bit after every level, so zeros go before ones. A query descends the
+// levels mapping [first_index, last_index) to the positions in the next
+// level by ranks of the bit vector. The matrix takes n log(s) bits and the
+// distinct values where s is the number of distinct values.
+template <typename T, typename Compare = std::less<T>,
+          typename Allocator = std::allocator<T>>
+class wavelet_matrix : private Compare {
+ public:
+  using allocator_type = Allocator;
+  using value_type = T;
+  using container_type = std::vector<value_type, allocator_type>;
+  using size_type = typename container_type::size_type;
+  using difference_type = typename container_type::difference_type;
+  using const_reference = typename container_type::const_reference;
+
+  using value_compare = Compare;
+
+ private:
+  using block_allocator = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<details::rank_block>;
+
+  static constexpr size_t block_bits = 64;
+
+  const Compare& compare() const& { return *static_cast<const Compare*>(this); }
+
+  // Returns the first block of the level.
+  const details::rank_block* level(size_t k) const {
+    return blocks_.data() + k * level_blocks_;
+  }
+  details::rank_block* level(size_t k) {
+    return blocks_.data() + k * level_blocks_;
+  }
+
+  // Returns the number of set bits before the bit i of the level.
+  // Time complexity - O(1).
+  size_t rank1(size_t k, size_t i) const {
+    const details::rank_block& block = level(k)[i / block_bits];
+    const uint64_t mask = (uint64_t{1} << (i % block_bits)) - 1;
+    return block.rank + details::popcount(block.bits & mask);
+  }
+
+  size_t rank0(size_t k, size_t i) const { return i - rank1(k, i); }
+
+  bool bit(size_t k, size_t i) const {
+    return (level(k)[i / block_bits].bits >> (i % block_bits)) & 1;
+  }
+
+  // Returns the code of the first value which is not less than value.
+  // Time complexity - O(log s).
+  size_t lower_code(const T& value) const {
+    return std::lower_bound(values_.begin(), values_.end(), value,
+                            compare()) -
+           values_.begin();
+  }
+
+  // Creates the levels from the elements.
+  // Time complexity - O(n log s).
+  template <typename InputIt>
+  void build_matrix(InputIt first, InputIt last) {
+    std::vector<T, Allocator> elements(first, last, values_.get_allocator());
+    size_ = elements.size();
+    values_ = elements;
+    std::sort(values_.begin(), values_.end(), compare());
+    const auto& less = compare();
+    values_.erase(std::unique(values_.begin(), values_.end(),
+                              [&less](const T& lhs, const T& rhs) {
+                                return !less(lhs, rhs) && !less(rhs, lhs);
+                              }),
+                  values_.end());
+
+    std::vector<size_t> codes(size_);
+    for (size_t i = 0; i < size_; ++i) {
+      codes[i] = lower_code(elements[i]);
+    }
+
+    height_ = values_.size() > 1 ? details::floor_log2(values_.size() - 1) + 1
+                                 : 0;
+    level_blocks_ = size_ / block_bits + 1;
+    blocks_.assign(height_ * level_blocks_, details::rank_block{});
+    zeros_.assign(height_, 0);
+
+    std::vector<size_t> next_codes(size_);
+    for (size_t k = 0; k < height_; ++k) {
+      const size_t shift = height_ - 1 - k;
+      details::rank_block* blocks = level(k);
+      for (size_t i = 0; i < size_; ++i) {
+        const uint64_t code_bit = (codes[i] >> shift) & 1;
+        blocks[i / block_bits].bits |= code_bit << (i % block_bits);
+      }
+      uint64_t rank = 0;
+      for (size_t i = 0; i < level_blocks_; ++i) {
+        blocks[i].rank = rank;
+        rank += details::popcount(blocks[i].bits);
+      }
+      zeros_[k] = size_ - rank;
+
+      // Zeros keep their order at the beginning, ones follow them.
+      size_t zeros = 0;
+      size_t ones = zeros_[k];
+      for (const size_t code : codes) {
+        if ((code >> shift) & 1) {
+          next_codes[ones++] = code;
+        } else {
+          next_codes[zeros++] = code;
+        }
+      }
+      codes.swap(next_codes);
+    }
+  }
+
+ public:
+  wavelet_matrix() = default;
+
+  explicit wavelet_matrix(const Allocator& allocator)
+      : values_(allocator), blocks_(block_allocator(allocator)) {}
+
+  explicit wavelet_matrix(Compare compare, const Allocator& allocator = {})
+      : Compare(std::move(compare)),
+        values_(allocator),
+        blocks_(block_allocator(allocator)) {}
+
+  // Time complexity - O(n log n).
+  template <typename InputIt, typename = details::require_input_iter<InputIt>>
+  wavelet_matrix(InputIt first, InputIt last, Compare compare = {},
+                 const Allocator& allocator = {})
+      : Compare(std::move(compare)),
+        values_(allocator),
+        blocks_(block_allocator(allocator)) {
+    build_matrix(first, last);
+  }
+
+  // Time complexity - O(n log n).
+  template <typename InputIt, typename = details::require_input_iter<InputIt>>
+  wavelet_matrix(InputIt first, InputIt last, const Allocator& allocator)
+      : values_(allocator), blocks_(block_allocator(allocator)) {
+    build_matrix(first, last);
+  }
+
+  // Time complexity - O(n log n).
+  wavelet_matrix(std::initializer_list<T> init_list, Compare compare = {},
+                 const Allocator& allocator = {})
+      : Compare(std::move(compare)),
+        values_(allocator),
+        blocks_(block_allocator(allocator)) {
+    build_matrix(init_list.begin(), init_list.end());
+  }
+
+  // Time complexity - O(n log n).
+  wavelet_matrix& operator=(std::initializer_list<T> init_list) {
+    build_matrix(init_list.begin(), init_list.end());
+    return *this;
+  }
+
+  // Time complexity - O(n log n).
+  template <class InputIt, typename = details::require_input_iter<InputIt>>
+  void assign(InputIt first, InputIt last) {
+    build_matrix(first, last);
+  }
+
+  // Time complexity - O(n log n).
+  void assign(std::initializer_list<T> init_list) { operator=(init_list); }
+
+  // Time complexity - O(1).
+  [[nodiscard]] allocator_type get_allocator() const noexcept {
+    return values_.get_allocator();
+  }
+
+  // Time complexity - O(log s).
+  [[nodiscard]] const_reference at(size_type pos) const {
+    if (pos >= size()) {
+      throw std::out_of_range("wavelet_matrix::at");
+    }
+    return (*this)[pos];
+  }
+
+  // Restores the code of the element level by level.
+  // Time complexity - O(log s).
+  [[nodiscard]] const_reference operator[](size_type pos) const {
+    assert(pos < size());
+    size_t code = 0;
+    for (size_t k = 0; k < height_; ++k) {
+      const bool one = bit(k, pos);
+      code = code * 2 + one;
+      pos = one ? zeros_[k] + rank1(k, pos) : rank0(k, pos);
+    }
+    return values_[code];
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+
+  // Time complexity - O(1).
+  [[nodiscard]] size_type size() const noexcept { return size_; }
+
+  // Returns the number of bytes allocated for the levels and the values.
+  // Time complexity - O(1).
+  [[nodiscard]] size_t bytes_used() const noexcept {
+    return blocks_.capacity() * sizeof(details::rank_block) +
+           values_.capacity() * sizeof(T) + zeros_.capacity() * sizeof(size_t);
+  }
+
+  // Time complexity - O(n).
+  void clear() noexcept {
+    values_.clear();
+    blocks_.clear();
+    zeros_.clear();
+    size_ = height_ = level_blocks_ = 0;
+  }
+
+  // Time complexity - O(1).
+  void swap(wavelet_matrix& other) noexcept {
+    auto tmp = std::move(other);
+    other = std::move(*this);
+    *this = std::move(tmp);
+  }
+
+  // Returns the element of [first_index, last_index) segment which would be
+  // at first_index + k if the segment was sorted.
+  // Time complexity - O(log s).
+  [[nodiscard]] const_reference kth_smallest(size_t first_index,
+                                             size_t last_index,
+                                             size_t k) const {
+    assert(first_index <= last_index);
+    assert(last_index <= size());
+    assert(k < last_index - first_index);
+
+    size_t code = 0;
+    for (size_t level = 0; level < height_; ++level) {
+      const size_t first_zeros = rank0(level, first_index);
+      const size_t last_zeros = rank0(level, last_index);
+      const size_t zeros = last_zeros - first_zeros;
+      const bool one = k >= zeros;
+      code = code * 2 + one;
+      if (one) {
+        k -= zeros;
+        first_index = zeros_[level] + first_index - first_zeros;
+        last_index = zeros_[level] + last_index - last_zeros;
+      } else {
+        first_index = first_zeros;
+        last_index = last_zeros;
+      }
+    }
+    return values_[code];
+  }
+
+  // Returns the number of elements of [first_index, last_index) segment which
+  // are less than value.
+  // Time complexity - O(log s).
+  [[nodiscard]] size_t count_less(size_t first_index, size_t last_index,
+                                  const T& value) const {
+    assert(first_index <= last_index);
+    assert(last_index <= size());
+
+    const size_t code = lower_code(value);
+    if (code >= values_.size()) {
+      return last_index - first_index;
+    }
+    size_t result = 0;
+    for (size_t level = 0; level < height_; ++level) {
+      const size_t first_zeros = rank0(level, first_index);
+      const size_t last_zeros = rank0(level, last_index);
+      if ((code >> (height_ - 1 - level)) & 1) {
+        result += last_zeros - first_zeros;
+        first_index = zeros_[level] + first_index - first_zeros;
+        last_index = zeros_[level] + last_index - last_zeros;
+      } else {
+        first_index = first_zeros;
+        last_index = last_zeros;
+      }
+    }
+    return result;
+  }
+
+  // Returns the number of elements of [first_index, last_index) segment which
+  // are in [lower, upper) values.
+  // Time complexity - O(log s).
+  [[nodiscard]] size_t range_freq(size_t first_index, size_t last_index,
+                                  const T& lower, const T& upper) const {
+    if (!compare()(lower, upper)) {
+      return 0;
+    }
+    return count_less(first_index, last_index, upper) -
+           count_less(first_index, last_index, lower);
+  }
+
+ private:
+  // Sorted distinct values, the code of an element is its index here.
+  std::vector<T, Allocator> values_;
+  std::vector<details::rank_block, block_allocator> blocks_;
+  // Number of zeros of every level.
+  std::vector<size_t> zeros_;
+  size_t size_ = 0;
+  size_t height_ = 0;
+  size_t level_blocks_ = 0;
+};
+
+template <typename T, typename C, typename A>
+bool operator==(const wavelet_matrix<T, C, A>& lhs,
+                const wavelet_matrix<T, C, A>& rhs) {
+  if (lhs.size() != rhs.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < lhs.size(); ++i) {
+    if (!(lhs[i] == rhs[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename T, typename C, typename A>
+bool operator!=(const wavelet_matrix<T, C, A>& lhs,
+                const wavelet_matrix<T, C, A>& rhs) {
+  return !(lhs == rhs);
+}
+
+}  // namespace manavrion::segment_tree
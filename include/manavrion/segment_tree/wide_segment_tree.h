@@ -0,0 +1,389 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "manavrion/segment_tree/details.h"
+#include "manavrion/segment_tree/simd.h"
+
+namespace manavrion::segment_tree {
+
+// Segment tree with B children per node.
+//
+// Level 0 holds the elements, level k + 1 holds reductions of consecutive
+// blocks of B values of level k. Each level is padded to a multiple of B and
+// the storage is aligned to a cache line, so with the default B every block
+// occupies exactly one cache line. A query reduces at most two partial blocks
+// per level, with masked vector instructions for std::plus,
+// std::multiplies, minimum and maximum over arithmetic types.
+template <typename T, typename Reducer = std::plus<T>,
+          size_t B = std::max<size_t>(2, details::cache_line_size / sizeof(T)),
+          typename Allocator = details::aligned_allocator<T>>
+class wide_segment_tree : private Reducer {
+  static_assert(B >= 2);
+
+ public:
+  using allocator_type = Allocator;
+  using value_type = T;
+  using container_type = std::vector<value_type, allocator_type>;
+  using size_type = typename container_type::size_type;
+  using difference_type = typename container_type::difference_type;
+  using reference = typename container_type::reference;
+  using const_reference = typename container_type::const_reference;
+  using pointer = typename container_type::pointer;
+  using const_pointer = typename container_type::const_pointer;
+  using iterator = typename container_type::iterator;
+  using const_iterator = typename container_type::const_iterator;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  using reducer_type = Reducer;
+
+  static constexpr size_t fan_out = B;
+
+ private:
+  const Reducer& reducer() const& { return *static_cast<const Reducer*>(this); }
+  Reducer&& reducer() && { return std::move(*static_cast<Reducer*>(this)); }
+
+  static size_t round_up(size_t n) { return (n + B - 1) / B * B; }
+
+  // Time complexity - O(B).
+  T reduce_block(size_t level, size_t block, size_t from, size_t to) const {
+    return details::reduce_block<B>(
+        tree_.data() + offsets_[level] + block * B, from, to, reducer());
+  }
+
+  // Recomputes values of blocks [first_block, last_block) of the level.
+  void update_level(size_t level, size_t first_block, size_t last_block) {
+    assert(level != 0);
+    const size_t child_size = sizes_[level - 1];
+    T* values = tree_.data() + offsets_[level];
+    for (size_t block = first_block; block < last_block; ++block) {
+      const size_t to = std::min(B, child_size - block * B);
+      values[block] = reduce_block(level - 1, block, 0, to);
+    }
+  }
+
+  void init_tree_impl(size_t n) {
+    tree_.clear();
+    offsets_.clear();
+    sizes_.clear();
+    size_ = n;
+    if (n == 0) {
+      return;
+    }
+
+    size_t tree_size = 0;
+    for (size_t level_size = n;; level_size = (level_size + B - 1) / B) {
+      offsets_.push_back(tree_size);
+      sizes_.push_back(level_size);
+      tree_size += round_up(level_size);
+      if (level_size <= B) break;
+    }
+    tree_.resize(tree_size);
+  }
+
+  template <typename InputIt>
+  void init_tree(InputIt first, InputIt last) {
+    init_tree_impl(std::distance(first, last));
+    std::copy(first, last, tree_.begin());
+  }
+
+  void init_tree(size_t n, const T& value) {
+    init_tree_impl(n);
+    std::fill_n(tree_.begin(), n, value);
+  }
+
+  // Creates segment tree nodes, time complexity - O(n).
+  void build_tree() {
+    for (size_t level = 1; level < sizes_.size(); ++level) {
+      update_level(level, 0, sizes_[level]);
+    }
+  }
+
+  // Recomputes ancestors of [first_index, last_index) elements.
+  // Time complexity - O(B log_B n + k) where k is (last_index - first_index).
+  void update_range(size_t first_index, size_t last_index) {
+    assert(first_index <= last_index);
+    assert(last_index <= size_);
+    if (first_index == last_index) {
+      return;
+    }
+    for (size_t level = 1; level < sizes_.size(); ++level) {
+      first_index /= B;
+      last_index = (last_index - 1) / B + 1;
+      update_level(level, first_index, last_index);
+    }
+  }
+
+  // Make a query on [first_index, last_index) segment.
+  // Time complexity - O(B log_B n).
+  T query_impl(size_t first_index, size_t last_index) const {
+    assert(first_index <= last_index);
+    assert(last_index <= size_);
+
+    details::segment_accumulator<T, Reducer> result(reducer());
+
+    for (size_t level = 0; first_index < last_index; ++level) {
+      assert(level < sizes_.size());
+      const size_t first_block = first_index / B;
+      const size_t last_block = (last_index - 1) / B;
+      if (first_block == last_block) {
+        result.add_left(reduce_block(level, first_block, first_index % B,
+                                     (last_index - 1) % B + 1));
+        break;
+      }
+      if (first_index % B != 0) {
+        result.add_left(reduce_block(level, first_block, first_index % B, B));
+        first_index = (first_block + 1) * B;
+      }
+      if (last_index % B != 0) {
+        result.add_right(reduce_block(level, last_block, 0, last_index % B));
+        last_index = last_block * B;
+      }
+      first_index /= B;
+      last_index /= B;
+    }
+
+    return std::move(result).result();
+  }
+
+ public:
+  wide_segment_tree() = default;
+
+  explicit wide_segment_tree(const Allocator& allocator) : tree_(allocator) {}
+
+  explicit wide_segment_tree(Reducer reducer, const Allocator& allocator = {})
+      : Reducer(std::move(reducer)), tree_(allocator) {}
+
+  // Time complexity - O(n).
+  template <typename InputIt, typename = details::require_input_iter<InputIt>>
+  wide_segment_tree(InputIt first, InputIt last, Reducer reducer = {},
+                    const Allocator& allocator = {})
+      : Reducer(std::move(reducer)), tree_(allocator) {
+    init_tree(first, last);
+    build_tree();
+  }
+
+  // Time complexity - O(n).
+  template <typename InputIt, typename = details::require_input_iter<InputIt>>
+  wide_segment_tree(InputIt first, InputIt last, const Allocator& allocator)
+      : tree_(allocator) {
+    init_tree(first, last);
+    build_tree();
+  }
+
+  // Time complexity - O(n).
+  wide_segment_tree(std::initializer_list<T> init_list, Reducer reducer = {},
+                    const Allocator& allocator = {})
+      : Reducer(std::move(reducer)), tree_(allocator) {
+    init_tree(init_list.begin(), init_list.end());
+    build_tree();
+  }
+
+  // Time complexity - O(n).
+  wide_segment_tree(std::initializer_list<T> init_list,
+                    const Allocator& allocator)
+      : tree_(allocator) {
+    init_tree(init_list.begin(), init_list.end());
+    build_tree();
+  }
+
+  // Time complexity - O(n).
+  wide_segment_tree(const wide_segment_tree& other) = default;
+  wide_segment_tree(wide_segment_tree&& other) noexcept = default;
+
+  // Time complexity - O(n).
+  wide_segment_tree& operator=(const wide_segment_tree& other) = default;
+  wide_segment_tree& operator=(wide_segment_tree&& other) = default;
+
+  // Time complexity - O(n).
+  wide_segment_tree& operator=(std::initializer_list<T> init_list) {
+    init_tree(init_list.begin(), init_list.end());
+    build_tree();
+    return *this;
+  }
+
+  // Time complexity - O(n).
+  void assign(size_type count, const T& value) {
+    init_tree(count, value);
+    build_tree();
+  }
+
+  // Time complexity - O(n).
+  template <class InputIt, typename = details::require_input_iter<InputIt>>
+  void assign(InputIt first, InputIt last) {
+    init_tree(first, last);
+    build_tree();
+  }
+
+  // Time complexity - O(n).
+  void assign(std::initializer_list<T> init_list) { operator=(init_list); }
+
+  // Time complexity - O(1).
+  [[nodiscard]] allocator_type get_allocator() const noexcept {
+    return tree_.get_allocator();
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_reference at(size_type pos) const {
+    if (pos >= size_) {
+      throw std::out_of_range("wide_segment_tree::at");
+    }
+    return tree_[pos];
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_reference operator[](size_type pos) const {
+    assert(pos < size_);
+    return tree_[pos];
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_reference front() const { return tree_.front(); }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_reference back() const { return tree_[size_ - 1]; }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const T* data() const noexcept { return tree_.data(); }
+
+  // Time complexity - O(1).
+  [[nodiscard]] iterator begin() noexcept { return tree_.begin(); }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_iterator begin() const noexcept { return tree_.begin(); }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_iterator cbegin() const noexcept {
+    return tree_.cbegin();
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] iterator end() noexcept { return tree_.begin() + size_; }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_iterator end() const noexcept {
+    return tree_.begin() + size_;
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_iterator cend() const noexcept {
+    return tree_.cbegin() + size_;
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] reverse_iterator rbegin() noexcept {
+    return reverse_iterator(end());
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_reverse_iterator rbegin() const noexcept {
+    return const_reverse_iterator(end());
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_reverse_iterator crbegin() const noexcept {
+    return const_reverse_iterator(cend());
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] reverse_iterator rend() noexcept {
+    return reverse_iterator(begin());
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_reverse_iterator rend() const noexcept {
+    return const_reverse_iterator(begin());
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] const_reverse_iterator crend() const noexcept {
+    return const_reverse_iterator(cbegin());
+  }
+
+  // Time complexity - O(1).
+  [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+
+  // Time complexity - O(1).
+  [[nodiscard]] size_type size() const noexcept { return size_; }
+
+  // Time complexity - O(1).
+  [[nodiscard]] size_type max_size() const noexcept { return tree_.max_size(); }
+
+  // Returns the number of bytes allocated for the elements and the nodes.
+  // Time complexity - O(1).
+  [[nodiscard]] size_t bytes_used() const noexcept {
+    return tree_.capacity() * sizeof(T) +
+           (offsets_.capacity() + sizes_.capacity()) * sizeof(size_t);
+  }
+
+  // Time complexity - O(n).
+  void clear() noexcept {
+    tree_.clear();
+    offsets_.clear();
+    sizes_.clear();
+    size_ = 0;
+  }
+
+  void reserve(size_type size) { tree_.reserve(round_up(size) * B / (B - 1)); }
+
+  // Time complexity - O(1).
+  void swap(wide_segment_tree& other) noexcept {
+    auto tmp = std::move(other);
+    other = std::move(*this);
+    *this = std::move(tmp);
+  }
+
+  // Time complexity - O(B log_B n).
+  template <typename V>
+  void update(size_t index, V&& v) {
+    assert(index < size_);
+    tree_[index] = std::forward<V>(v);
+    update_range(index, index + 1);
+  }
+
+  // Make a query on [first_index, last_index) segment.
+  // Time complexity - O(B log_B n).
+  [[nodiscard]] T query(size_t first_index, size_t last_index) const {
+    return query_impl(first_index, last_index);
+  }
+
+  // Time complexity - O(B log_B n + k) where k is std::distance(first, last).
+  void update_range(const_iterator first, const_iterator last) {
+    update_range(std::distance(cbegin(), first), std::distance(cbegin(), last));
+  }
+
+  template <typename T1, typename T2, typename R, size_t N, typename A>
+  friend bool operator==(const wide_segment_tree<T1, R, N, A>& lhs,
+                         const wide_segment_tree<T2, R, N, A>& rhs);
+
+ private:
+  std::vector<T, Allocator> tree_;
+  std::vector<size_t> offsets_;
+  std::vector<size_t> sizes_;
+  size_t size_ = 0;
+};
+
+template <typename T1, typename T2, typename R, size_t N, typename A>
+bool operator==(const wide_segment_tree<T1, R, N, A>& lhs,
+                const wide_segment_tree<T2, R, N, A>& rhs) {
+  return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+}
+
+template <typename T1, typename T2, typename R, size_t N, typename A>
+bool operator!=(const wide_segment_tree<T1, R, N, A>& lhs,
+                const wide_segment_tree<T2, R, N, A>& rhs) {
+  return !(lhs == rhs);
+}
+
+}  // namespace manavrion::segment_tree
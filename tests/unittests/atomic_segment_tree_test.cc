@@ -0,0 +1,121 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#include <gtest/gtest.h>
+
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "manavrion/segment_tree/atomic_segment_tree.h"
+
+using namespace manavrion::segment_tree;
+
+namespace {
+
+template <typename T>
+void ExpectQueries(const std::vector<T>& expected,
+                   const atomic_segment_tree<T>& st) {
+  ASSERT_EQ(expected.size(), st.size());
+  for (size_t first = 0; first <= expected.size(); ++first) {
+    for (size_t last = first; last <= expected.size(); ++last) {
+      const T sum = std::accumulate(expected.begin() + first,
+                                    expected.begin() + last, T{0});
+      ASSERT_EQ(sum, st.query(first, last))
+          << "[" << first << ", " << last << ")";
+    }
+  }
+}
+
+}  // namespace
+
+TEST(AtomicSegmentTreeTest, Simple) {
+  atomic_segment_tree<int> st{1, 2, 3, 4, 5};
+  EXPECT_EQ(st.size(), 5);
+  EXPECT_EQ(st.query(0, 5), 15);
+  EXPECT_EQ(st.query(1, 4), 9);
+  EXPECT_EQ(st[2], 3);
+  EXPECT_EQ(st.at(4), 5);
+  EXPECT_THROW(static_cast<void>(st.at(5)), std::out_of_range);
+
+  st.add(2, 10);
+  EXPECT_EQ(st.query(0, 5), 25);
+  st.update(0, -1);
+  EXPECT_EQ(st.query(0, 2), 1);
+  EXPECT_EQ(st.query(0, 5), 23);
+
+  atomic_segment_tree<int> copy = st;
+  st.add(1, 1);
+  EXPECT_EQ(copy.query(0, 5), 23);
+  EXPECT_EQ(st.query(0, 5), 24);
+}
+
+TEST(AtomicSegmentTreeTest, ExtremeUpdates) {
+  constexpr int kMax = std::numeric_limits<int>::max();
+  constexpr int kMin = std::numeric_limits<int>::min();
+  atomic_segment_tree<int> st{kMax, 0, 0};
+  st.update(0, kMin);
+  ExpectQueries({kMin, 0, 0}, st);
+  st.update(0, kMax);
+  ExpectQueries({kMax, 0, 0}, st);
+  st.update(2, kMin);
+  st.update(0, 0);
+  ExpectQueries({0, 0, kMin}, st);
+}
+
+TEST(AtomicSegmentTreeTest, AllSizes) {
+  for (size_t n = 0; n <= 40; ++n) {
+    std::vector<long long> expected(n);
+    std::iota(expected.begin(), expected.end(), 1);
+    atomic_segment_tree<long long> st(expected.begin(), expected.end());
+    ExpectQueries(expected, st);
+
+    for (size_t i = 0; i < n; ++i) {
+      st.add(i, static_cast<long long>(i * i));
+      expected[i] += static_cast<long long>(i * i);
+    }
+    ExpectQueries(expected, st);
+
+    atomic_segment_tree<long long> zeros(n);
+    ExpectQueries(std::vector<long long>(n), zeros);
+  }
+}
+
+TEST(AtomicSegmentTreeTest, ConcurrentUpdates) {
+  constexpr size_t kSize = 1000;
+  constexpr size_t kThreads = 4;
+  constexpr size_t kUpdates = 20000;
+  atomic_segment_tree<int> st(kSize);
+
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&st, t] {
+      for (size_t i = 0; i < kUpdates; ++i) {
+        st.add((i * 7 + t) % kSize, 1);
+        const int sum = st.query(0, kSize);
+        EXPECT_GE(sum, 0);
+        EXPECT_LE(sum, static_cast<int>(kThreads * kUpdates));
+      }
+      // Concurrent replacements of the same element.
+      for (size_t i = 0; i < kUpdates; ++i) {
+        st.update(0, static_cast<int>(i % 3));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  std::vector<int> expected(kSize);
+  for (size_t t = 0; t < kThreads; ++t) {
+    for (size_t i = 0; i < kUpdates; ++i) {
+      ++expected[(i * 7 + t) % kSize];
+    }
+  }
+  expected[0] = st[0];
+  ExpectQueries(expected, st);
+}
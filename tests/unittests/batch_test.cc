@@ -0,0 +1,116 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "manavrion/segment_tree/mapped_segment_tree.h"
+#include "manavrion/segment_tree/naive_segment_tree.h"
+#include "manavrion/segment_tree/segment_tree.h"
+
+using namespace manavrion::segment_tree;
+
+namespace {
+
+template <typename SegmentTree>
+void QueryBatchTest() {
+  std::random_device rd;
+  std::mt19937 gen(rd());
+  std::uniform_int_distribution<> dist(-5, 5);
+
+  for (size_t size = 0; size < 70; ++size) {
+    std::vector<int> as(size);
+    for (auto& a : as) {
+      a = dist(gen);
+    }
+    SegmentTree test(as.begin(), as.end());
+    naive_segment_tree<int> canonical(as.begin(), as.end());
+
+    std::vector<std::pair<size_t, size_t>> queries;
+    for (size_t first_index = 0; first_index <= size; ++first_index) {
+      for (size_t last_index = first_index; last_index <= size; ++last_index) {
+        queries.emplace_back(first_index, last_index);
+      }
+    }
+    std::shuffle(queries.begin(), queries.end(), gen);
+
+    std::vector<int> results(queries.size());
+    auto end =
+        test.query_batch(queries.begin(), queries.end(), results.begin());
+    EXPECT_EQ(end, results.end());
+    for (size_t i = 0; i < queries.size(); ++i) {
+      const auto [first_index, last_index] = queries[i];
+      EXPECT_EQ(results[i], canonical.query(first_index, last_index));
+    }
+  }
+}
+
+template <typename SegmentTree>
+void UpdateBatchTest() {
+  std::random_device rd;
+  std::mt19937 gen(rd());
+  std::uniform_int_distribution<> dist(-5, 5);
+
+  for (size_t size = 1; size < 70; ++size) {
+    std::vector<int> as(size);
+    for (auto& a : as) {
+      a = dist(gen);
+    }
+    SegmentTree test(as.begin(), as.end());
+    naive_segment_tree<int> canonical(as.begin(), as.end());
+
+    std::uniform_int_distribution<size_t> dist_indexes(0, size - 1);
+    for (size_t batch_size : {size_t{0}, size_t{1}, size / 2, size * 2}) {
+      std::vector<std::pair<size_t, int>> updates(batch_size);
+      for (auto& [index, value] : updates) {
+        index = dist_indexes(gen);
+        value = dist(gen);
+        canonical.update(index, value);
+      }
+      test.update_batch(updates.begin(), updates.end());
+
+      EXPECT_TRUE(std::equal(test.begin(), test.end(), canonical.begin(),
+                             canonical.end()));
+      for (size_t first_index = 0; first_index <= size; ++first_index) {
+        for (size_t last_index = first_index; last_index <= size;
+             ++last_index) {
+          EXPECT_EQ(test.query(first_index, last_index),
+                    canonical.query(first_index, last_index));
+        }
+      }
+    }
+  }
+}
+
+}  // namespace
+
+TEST(QueryBatchTest, MappedSegmentTree) {
+  QueryBatchTest<mapped_segment_tree<int>>();
+}
+
+TEST(QueryBatchTest, SimpleSegmentTree) { QueryBatchTest<segment_tree<int>>(); }
+
+TEST(UpdateBatchTest, MappedSegmentTree) {
+  UpdateBatchTest<mapped_segment_tree<int>>();
+}
+
+TEST(UpdateBatchTest, SimpleSegmentTree) {
+  UpdateBatchTest<segment_tree<int>>();
+}
+
+TEST(QueryBatchTest, SimpleSegmentTreeVebLayout) {
+  QueryBatchTest<
+      segment_tree<int, std::plus<int>, std::allocator<int>, veb_layout>>();
+}
+
+TEST(UpdateBatchTest, MappedSegmentTreeVebLayout) {
+  UpdateBatchTest<
+      mapped_segment_tree<int, std::plus<int>, details::default_mapper,
+                          std::allocator<int>, std::allocator<int>,
+                          veb_layout>>();
+}
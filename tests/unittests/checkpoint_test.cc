@@ -0,0 +1,164 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "manavrion/segment_tree/checkpoint.h"
+#include "manavrion/segment_tree/mapped_segment_tree.h"
+#include "manavrion/segment_tree/naive_segment_tree.h"
+#include "manavrion/segment_tree/segment_tree.h"
+
+using namespace manavrion::segment_tree;
+
+namespace {
+
+struct TempFiles {
+  explicit TempFiles(const std::string& name)
+      : snapshot(testing::TempDir() + "checkpoint_test_" + name + ".tree"),
+        log(testing::TempDir() + "checkpoint_test_" + name + ".log") {
+    Remove();
+  }
+  ~TempFiles() { Remove(); }
+
+  void Remove() const {
+    std::remove(snapshot.c_str());
+    std::remove(log.c_str());
+  }
+
+  std::string snapshot;
+  std::string log;
+};
+
+template <typename SegmentTree>
+void ExpectQueries(const std::vector<int>& expected, const SegmentTree& st) {
+  ASSERT_EQ(expected.size(), st.size());
+  const naive_segment_tree<int> naive(expected.begin(), expected.end());
+  for (size_t first = 0; first <= expected.size(); ++first) {
+    for (size_t last = first; last <= expected.size(); ++last) {
+      ASSERT_EQ(naive.query(first, last), st.query(first, last))
+          << "[" << first << ", " << last << ")";
+    }
+  }
+}
+
+// Recovers the tree after a few and after many updates, which are replayed
+// by update_batch() and by one rebuild.
+template <typename SegmentTree>
+void RecoverTest(const std::string& name) {
+  const TempFiles files(name);
+  std::mt19937 gen(42);
+  std::vector<int> expected(50, 1);
+  {
+    checkpointed_tree<SegmentTree> st(
+        files.snapshot, files.log,
+        SegmentTree(expected.begin(), expected.end()));
+    for (int i = 0; i < 3; ++i) {
+      const size_t index = gen() % expected.size();
+      st.update(index, i);
+      expected[index] = i;
+    }
+    st.flush();
+    EXPECT_EQ(st.log_size(), 3);
+    ExpectQueries(expected, recover<SegmentTree>(files.snapshot, files.log));
+  }
+
+  checkpointed_tree<SegmentTree> st(files.snapshot, files.log);
+  EXPECT_EQ(st.log_size(), 3);
+  ExpectQueries(expected, st.tree());
+  for (int i = 0; i < 200; ++i) {
+    const size_t index = gen() % expected.size();
+    st.update(index, i);
+    expected[index] = i;
+  }
+  st.flush();
+  EXPECT_EQ(st.log_size(), 203);
+  ExpectQueries(expected, recover<SegmentTree>(files.snapshot, files.log));
+}
+
+}  // namespace
+
+TEST(CheckpointTest, SimpleSegmentTree) {
+  RecoverTest<segment_tree<int>>("simple");
+}
+
+TEST(CheckpointTest, MappedSegmentTree) {
+  RecoverTest<mapped_segment_tree<int>>("mapped");
+}
+
+TEST(CheckpointTest, Interval) {
+  const TempFiles files("interval");
+  std::vector<int> expected(10);
+  checkpointed_tree<segment_tree<int>> st(
+      files.snapshot, files.log,
+      segment_tree<int>(expected.begin(), expected.end()), 4);
+  for (int i = 0; i < 10; ++i) {
+    st.update(i, i);
+    expected[i] = i;
+  }
+  st.sync();
+  EXPECT_EQ(st.log_size(), 2);
+  ExpectQueries({0, 1, 2, 3, 4, 5, 6, 7, 0, 0},
+                load_file<segment_tree<int>>(files.snapshot));
+  ExpectQueries(expected,
+                recover<segment_tree<int>>(files.snapshot, files.log));
+}
+
+TEST(CheckpointTest, PartialEntry) {
+  const TempFiles files("partial");
+  {
+    checkpointed_tree<segment_tree<int>> st(files.snapshot, files.log,
+                                            segment_tree<int>{1, 2, 3});
+    st.update(0, 10);
+  }
+  {
+    // A crash in the middle of an entry.
+    std::ofstream log(files.log, std::ios::binary | std::ios::app);
+    log.write("\x01\x00\x00", 3);
+  }
+  ExpectQueries({10, 2, 3},
+                recover<segment_tree<int>>(files.snapshot, files.log));
+
+  {
+    checkpointed_tree<segment_tree<int>> st(files.snapshot, files.log);
+    EXPECT_EQ(st.log_size(), 1);
+    st.update(2, 30);
+  }
+  ExpectQueries({10, 2, 30},
+                recover<segment_tree<int>>(files.snapshot, files.log));
+}
+
+TEST(CheckpointTest, OutOfRange) {
+  const TempFiles files("out_of_range");
+  {
+    checkpointed_tree<segment_tree<int>> st(files.snapshot, files.log,
+                                            segment_tree<int>{1, 2, 3});
+    st.update(1, 20);
+    EXPECT_THROW(st.update(3, 30), std::out_of_range);
+    EXPECT_EQ(st.log_size(), 1);
+    ExpectQueries({1, 20, 3}, st.tree());
+  }
+  ExpectQueries({1, 20, 3},
+                recover<segment_tree<int>>(files.snapshot, files.log));
+  checkpointed_tree<segment_tree<int>> st(files.snapshot, files.log);
+  ExpectQueries({1, 20, 3}, st.tree());
+}
+
+TEST(CheckpointTest, OtherType) {
+  const TempFiles files("other_type");
+  {
+    checkpointed_tree<segment_tree<int>> st(files.snapshot, files.log,
+                                            segment_tree<int>{1, 2, 3});
+    st.update(0, 10);
+  }
+  segment_tree<long long> other{1, 2, 3};
+  EXPECT_THROW(replay_log(other, files.log), std::runtime_error);
+}
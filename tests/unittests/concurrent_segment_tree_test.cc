@@ -0,0 +1,131 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "manavrion/segment_tree/concurrent_segment_tree.h"
+#include "manavrion/segment_tree/mapped_segment_tree.h"
+#include "manavrion/segment_tree/segment_tree.h"
+
+using namespace manavrion::segment_tree;
+
+namespace {
+
+constexpr size_t kSize = 100;
+
+struct Square {
+  long long operator()(int v) const { return 1LL * v * v; }
+};
+
+// The writer publishes versions where all the elements are equal to the
+// version number, so every query of a consistent version is a multiple of
+// the segment length.
+template <typename SegmentTree, typename Expected>
+void StressTest(Expected expected) {
+  const std::vector<int> numbers(kSize);
+  concurrent_segment_tree<SegmentTree> st(
+      SegmentTree(numbers.begin(), numbers.end()));
+
+  constexpr int kVersions = 200;
+  constexpr size_t kReaders = 4;
+  std::atomic<bool> done{false};
+  std::atomic<size_t> failures{0};
+
+  std::vector<std::thread> readers;
+  for (size_t r = 0; r < kReaders; ++r) {
+    readers.emplace_back([&, r] {
+      auto reader = st.make_reader();
+      int last_version = 0;
+      for (size_t i = r; !done.load(); i += 7) {
+        const size_t first = i % kSize;
+        const size_t last = first + 1 + i % (kSize - first);
+        const bool consistent = reader.read([&](const SegmentTree& version) {
+          const int v = version[0];
+          if (v < last_version) {
+            return false;
+          }
+          last_version = v;
+          return version.query(first, last) == expected(v, last - first) &&
+                 version.query(0, kSize) == expected(v, kSize);
+        });
+        if (!consistent) {
+          failures.fetch_add(1);
+        }
+      }
+    });
+  }
+
+  for (int v = 1; v <= kVersions; ++v) {
+    for (size_t i = 0; i < kSize; ++i) {
+      st.update(i, v);
+    }
+    st.publish();
+  }
+  done.store(true);
+  for (auto& reader : readers) {
+    reader.join();
+  }
+
+  EXPECT_EQ(failures.load(), 0);
+  EXPECT_EQ(st.published().query(0, kSize), expected(kVersions, kSize));
+  EXPECT_EQ(st.make_reader().query(0, kSize), expected(kVersions, kSize));
+}
+
+}  // namespace
+
+TEST(ConcurrentSegmentTreeTest, Publish) {
+  concurrent_segment_tree<segment_tree<int>> st(segment_tree<int>{1, 2, 3, 4});
+  auto reader = st.make_reader();
+  EXPECT_EQ(reader.size(), 4);
+  EXPECT_EQ(reader.query(0, 4), 10);
+
+  st.update(0, 10);
+  st.update(3, 40);
+  EXPECT_EQ(reader.query(0, 4), 10);
+  st.publish();
+  EXPECT_EQ(reader.query(0, 4), 55);
+
+  // The version which was published before must catch up with the updates.
+  st.update(1, 20);
+  st.publish();
+  EXPECT_EQ(reader.query(0, 4), 73);
+  st.update(2, 30);
+  st.publish();
+  EXPECT_EQ(reader.query(0, 4), 100);
+  EXPECT_EQ(reader.query(1, 3), 50);
+  EXPECT_EQ(st.published().query(0, 2), 30);
+}
+
+TEST(ConcurrentSegmentTreeTest, Readers) {
+  concurrent_segment_tree<segment_tree<int>> st(segment_tree<int>{1, 2}, 2);
+  auto first = st.make_reader();
+  {
+    auto second = st.make_reader();
+    EXPECT_THROW(auto third = st.make_reader(), std::length_error);
+  }
+  auto second = st.make_reader();
+  first = std::move(second);
+  EXPECT_EQ(first.query(0, 2), 3);
+  auto third = st.make_reader();
+  EXPECT_EQ(third.query(1, 2), 2);
+}
+
+TEST(ConcurrentSegmentTreeTest, StressSegmentTree) {
+  StressTest<segment_tree<int>>(
+      [](int v, size_t length) { return static_cast<int>(v * length); });
+}
+
+TEST(ConcurrentSegmentTreeTest, StressMappedSegmentTree) {
+  StressTest<mapped_segment_tree<int, std::plus<long long>, Square>>(
+      [](int v, size_t length) {
+        return 1LL * v * v * static_cast<long long>(length);
+      });
+}
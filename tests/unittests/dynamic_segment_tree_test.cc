@@ -0,0 +1,102 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "manavrion/segment_tree/dynamic_segment_tree.h"
+#include "manavrion/segment_tree/functional.h"
+#include "manavrion/segment_tree/naive_segment_tree.h"
+
+using namespace manavrion::segment_tree;
+
+TEST(DynamicSegmentTreeTest, Simple) {
+  dynamic_segment_tree<int> st(10, 1);
+  EXPECT_EQ(st.size(), 10);
+  EXPECT_EQ(st.nodes(), 0);
+  EXPECT_EQ(st.query(0, 10), 10);
+  EXPECT_EQ(st.query(3, 7), 4);
+  EXPECT_EQ(st[5], 1);
+
+  st.update(5, 10);
+  EXPECT_EQ(st.query(0, 10), 19);
+  EXPECT_EQ(st.query(5, 6), 10);
+  EXPECT_EQ(st.query(6, 10), 4);
+  EXPECT_EQ(st.at(5), 10);
+  EXPECT_THROW(static_cast<void>(st.at(10)), std::out_of_range);
+
+  st.assign(3, 2);
+  EXPECT_EQ(st.nodes(), 0);
+  EXPECT_EQ(st.query(0, 3), 6);
+}
+
+TEST(DynamicSegmentTreeTest, HugeIndexSpace) {
+  const size_t size = size_t{1} << 40;
+  dynamic_segment_tree<long long> st(size, 0);
+  std::map<size_t, long long> expected;
+  std::mt19937_64 gen(42);
+  for (int i = 0; i < 1000; ++i) {
+    const size_t index = gen() % size;
+    st.update(index, i);
+    expected[index] = i;
+  }
+  EXPECT_LE(st.nodes(), 1000 * 41);
+
+  for (int i = 0; i < 1000; ++i) {
+    size_t first = gen() % size;
+    size_t last = gen() % size;
+    if (first > last) {
+      std::swap(first, last);
+    }
+    long long sum = 0;
+    for (auto it = expected.lower_bound(first);
+         it != expected.end() && it->first < last; ++it) {
+      sum += it->second;
+    }
+    ASSERT_EQ(st.query(first, last), sum);
+  }
+  EXPECT_EQ(st.query(0, size),
+            st.query(0, size / 2) + st.query(size / 2, size));
+}
+
+TEST(DynamicSegmentTreeTest, NonCommutative) {
+  struct Concat {
+    std::string operator()(const std::string& lhs,
+                           const std::string& rhs) const {
+      return lhs + rhs;
+    }
+  };
+  std::mt19937 gen(42);
+  for (size_t n = 1; n <= 33; ++n) {
+    std::vector<std::string> expected(n, "a");
+    dynamic_segment_tree<std::string, Concat> st(n, "a");
+    for (int i = 0; i < 10; ++i) {
+      const size_t index = gen() % n;
+      expected[index] = std::to_string(i);
+      st.update(index, expected[index]);
+    }
+    const naive_segment_tree<std::string, Concat> naive(expected.begin(),
+                                                        expected.end());
+    for (size_t first = 0; first <= n; ++first) {
+      for (size_t last = first; last <= n; ++last) {
+        ASSERT_EQ(naive.query(first, last), st.query(first, last));
+      }
+    }
+  }
+}
+
+TEST(DynamicSegmentTreeTest, Move) {
+  dynamic_segment_tree<int, maximum<int>> st(100, 0);
+  st.update(42, 7);
+  dynamic_segment_tree<int, maximum<int>> moved = std::move(st);
+  EXPECT_EQ(moved.query(0, 100), 7);
+  EXPECT_EQ(moved.query(43, 100), 0);
+  EXPECT_TRUE(st.empty());
+}
@@ -0,0 +1,108 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <vector>
+
+#include "manavrion/segment_tree/fenwick_tree.h"
+#include "manavrion/segment_tree/naive_segment_tree.h"
+
+using namespace manavrion::segment_tree;
+
+TEST(FenwickTreeTest, Elements) {
+  fenwick_tree<int> st = {3, -1, 4, 1, -5, 9, 2, -6};
+  EXPECT_EQ(std::vector<int>(st.begin(), st.end()),
+            std::vector<int>({3, -1, 4, 1, -5, 9, 2, -6}));
+  EXPECT_EQ(st.at(5), 9);
+  EXPECT_THROW(static_cast<void>(st.at(8)), std::out_of_range);
+
+  st[5] = 7;
+  st.add(0, 2);
+  EXPECT_EQ(st[5], 7);
+  EXPECT_EQ(st[0], 5);
+  EXPECT_EQ(st.query(0, 8), 7);
+  EXPECT_EQ(std::vector<int>(st.rbegin(), st.rend()),
+            std::vector<int>({-6, 2, 7, -5, 1, 4, -1, 5}));
+
+  const fenwick_tree<int> copy = st;
+  EXPECT_EQ(copy, st);
+  st.update(1, 0);
+  EXPECT_NE(copy, st);
+}
+
+TEST(FenwickTreeTest, Xor) {
+  using xor_tree = fenwick_tree<unsigned, std::bit_xor<unsigned>,
+                                std::bit_xor<unsigned>>;
+  std::mt19937 gen(42);
+  std::vector<unsigned> as(100);
+  for (auto& a : as) {
+    a = gen();
+  }
+  xor_tree st(as.begin(), as.end());
+  naive_segment_tree<unsigned, std::bit_xor<unsigned>> canonical(as.begin(),
+                                                                 as.end());
+  for (size_t step = 0; step < 1000; ++step) {
+    const size_t index = gen() % as.size();
+    const unsigned value = gen();
+    st.update(index, value);
+    canonical.update(index, value);
+    const size_t first = gen() % (as.size() + 1);
+    const size_t last = first + gen() % (as.size() + 1 - first);
+    ASSERT_EQ(st.query(first, last), canonical.query(first, last));
+  }
+}
+
+TEST(FenwickTreeTest, RangeAdd) {
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<> dist(-5, 5);
+  for (size_t size = 0; size < 40; ++size) {
+    std::vector<long long> as(size);
+    for (auto& a : as) {
+      a = dist(gen);
+    }
+    range_fenwick_tree<long long> st(as.begin(), as.end());
+    for (size_t step = 0; step < 50; ++step) {
+      const size_t first = gen() % (size + 1);
+      const size_t last = first + gen() % (size + 1 - first);
+      const long long value = dist(gen);
+      if (step % 2 == 0) {
+        st.add(first, last, value);
+        std::for_each(as.begin() + first, as.begin() + last,
+                      [&](long long& a) { a += value; });
+      } else if (first < size) {
+        st.update(first, value);
+        as[first] = value;
+      }
+      for (size_t i = 0; i < size; ++i) {
+        ASSERT_EQ(st[i], as[i]);
+      }
+      for (size_t l = 0; l <= size; ++l) {
+        long long sum = 0;
+        for (size_t r = l; r <= size; ++r) {
+          ASSERT_EQ(st.query(l, r), sum);
+          if (r < size) {
+            sum += as[r];
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(FenwickTreeTest, RangeAssign) {
+  range_fenwick_tree<int> st;
+  st.assign(10, 3);
+  EXPECT_EQ(st.query(0, 10), 30);
+  EXPECT_EQ(st.at(9), 3);
+  st.add(0, 10, -3);
+  EXPECT_EQ(st.query(2, 7), 0);
+  EXPECT_EQ(st.bytes_used(), 2 * 10 * sizeof(int));
+  st.clear();
+  EXPECT_TRUE(st.empty());
+}
@@ -0,0 +1,274 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "manavrion/segment_tree/file_storage.h"
+#include "manavrion/segment_tree/functional.h"
+#include "manavrion/segment_tree/mapped_segment_tree.h"
+#include "manavrion/segment_tree/naive_segment_tree.h"
+#include "manavrion/segment_tree/segment_tree.h"
+
+#ifdef MANAVRION_SEGMENT_TREE_HAS_MMAP
+
+using namespace manavrion::segment_tree;
+
+namespace {
+
+std::string TempPath(const std::string& name) {
+  return testing::TempDir() + "file_storage_test_" + name;
+}
+
+template <typename SegmentTree>
+void ExpectQueries(const std::vector<int>& expected, const SegmentTree& st) {
+  ASSERT_EQ(expected.size(), st.size());
+  const naive_segment_tree<int> naive(expected.begin(), expected.end());
+  for (size_t first = 0; first <= expected.size(); ++first) {
+    for (size_t last = first; last <= expected.size(); ++last) {
+      ASSERT_EQ(naive.query(first, last), st.query(first, last))
+          << "[" << first << ", " << last << ")";
+    }
+  }
+}
+
+template <typename SegmentTree, typename FileSegmentTree>
+void SaveOpenTest(const std::string& name) {
+  const std::string path = TempPath(name);
+  for (size_t size = 0; size < 40; ++size) {
+    std::vector<int> as(size);
+    std::iota(as.begin(), as.end(), 1);
+    save_file(SegmentTree(as.begin(), as.end()), path);
+
+    {
+      const auto st = open_file<FileSegmentTree>(path);
+      ExpectQueries(as, st);
+    }
+    if (size == 0) {
+      continue;
+    }
+
+    // Private updates do not change the file.
+    {
+      auto st = open_file<FileSegmentTree>(path, open_mode::copy_on_write);
+      st.update(size / 2, 100);
+      std::vector<int> updated = as;
+      updated[size / 2] = 100;
+      ExpectQueries(updated, st);
+    }
+    ExpectQueries(as, open_file<FileSegmentTree>(path));
+
+    // Shared updates are written to the file.
+    {
+      auto st = open_file<FileSegmentTree>(path, open_mode::read_write);
+      st.update(0, -1);
+      st.get_allocator().flush();
+    }
+    as[0] = -1;
+    ExpectQueries(as, open_file<FileSegmentTree>(path));
+  }
+  std::remove(path.c_str());
+}
+
+// Trivially copyable, but not trivially default constructible.
+struct Initialized {
+  int value = 0;
+
+  Initialized operator+(const Initialized& other) const {
+    return {value + other.value};
+  }
+};
+
+// Overwrites the header field at offset of the file at path.
+void PatchHeader(const std::string& path, size_t offset, uint64_t value) {
+  std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+  file.seekp(static_cast<std::streamoff>(offset));
+  file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Checks that both open_file() and load_file() reject the file at path.
+template <typename SegmentTree, typename FileSegmentTree>
+void ExpectCorrupted(const std::string& path) {
+  EXPECT_THROW(static_cast<void>(open_file<FileSegmentTree>(path)),
+               std::runtime_error);
+  EXPECT_THROW(static_cast<void>(load_file<SegmentTree>(path)),
+               std::runtime_error);
+}
+
+}  // namespace
+
+TEST(FileStorageTest, SimpleSegmentTree) {
+  SaveOpenTest<segment_tree<int>, file_segment_tree<int>>("simple");
+}
+
+TEST(FileStorageTest, SimpleSegmentTreeVebLayout) {
+  SaveOpenTest<
+      segment_tree<int, std::plus<int>, std::allocator<int>, veb_layout>,
+      file_segment_tree<int, std::plus<int>, veb_layout>>("simple_veb");
+}
+
+TEST(FileStorageTest, MappedSegmentTree) {
+  SaveOpenTest<mapped_segment_tree<int>, file_mapped_segment_tree<int>>(
+      "mapped");
+}
+
+TEST(FileStorageTest, MappedSegmentTreeVebLayout) {
+  SaveOpenTest<
+      mapped_segment_tree<int, std::plus<int>, details::default_mapper,
+                          std::allocator<int>, std::allocator<int>,
+                          veb_layout>,
+      file_mapped_segment_tree<int, std::plus<int>, details::default_mapper,
+                               veb_layout>>("mapped_veb");
+}
+
+TEST(FileStorageTest, Load) {
+  const std::string path = TempPath("load");
+  save_file(mapped_segment_tree<int>{1, 2, 3, 4, 5}, path);
+  ExpectQueries({1, 2, 3, 4, 5}, load_file<mapped_segment_tree<int>>(path));
+  save_file(segment_tree<int>{5, 4, 3}, path);
+  ExpectQueries({5, 4, 3}, load_file<segment_tree<int>>(path));
+  EXPECT_THROW(static_cast<void>(load_file<mapped_segment_tree<int>>(path)),
+               std::runtime_error);
+
+  // The leaves are not halved yet, so the shift is of a tree of eight.
+  segment_tree<int> popped{1, 2, 3, 4, 5};
+  popped.pop_back();
+  save_file(popped, path);
+  ExpectQueries({1, 2, 3, 4}, load_file<segment_tree<int>>(path));
+  ExpectQueries({1, 2, 3, 4}, open_file<file_segment_tree<int>>(path));
+  mapped_segment_tree<int> mapped_popped{1, 2, 3, 4, 5};
+  mapped_popped.pop_back();
+  save_file(mapped_popped, path);
+  ExpectQueries({1, 2, 3, 4}, load_file<mapped_segment_tree<int>>(path));
+  ExpectQueries({1, 2, 3, 4}, open_file<file_mapped_segment_tree<int>>(path));
+  std::remove(path.c_str());
+}
+
+TEST(FileStorageTest, GrowsOnHeap) {
+  const std::string path = TempPath("grow");
+  save_file(segment_tree<int>{1, 2, 3}, path);
+  auto st = open_file<file_segment_tree<int>>(path, open_mode::read_only);
+  const file_segment_tree<int> copy = st;
+  st.push_back(4);
+  ExpectQueries({1, 2, 3, 4}, st);
+  ExpectQueries({1, 2, 3}, copy);
+  ExpectQueries({1, 2, 3}, open_file<file_segment_tree<int>>(path));
+  std::remove(path.c_str());
+}
+
+TEST(FileStorageTest, DefaultMemberInitializer) {
+  const std::string path = TempPath("initialized");
+  const std::vector<Initialized> as{{1}, {2}, {3}, {4}, {5}};
+  save_file(segment_tree<Initialized>(as.begin(), as.end()), path);
+  for (open_mode mode : {open_mode::read_only, open_mode::copy_on_write,
+                         open_mode::read_write}) {
+    const auto st = open_file<file_segment_tree<Initialized>>(path, mode);
+    EXPECT_EQ(st.query(0, 5).value, 15);
+    EXPECT_EQ(st[0].value, 1);
+  }
+  save_file(mapped_segment_tree<Initialized>(as.begin(), as.end()), path);
+  for (open_mode mode : {open_mode::read_only, open_mode::copy_on_write,
+                         open_mode::read_write}) {
+    const auto st =
+        open_file<file_mapped_segment_tree<Initialized>>(path, mode);
+    EXPECT_EQ(st.query(0, 5).value, 15);
+    EXPECT_EQ(st[0].value, 1);
+  }
+  std::remove(path.c_str());
+}
+
+TEST(FileStorageTest, ResizeValueInitializes) {
+  const std::string path = TempPath("resize");
+  save_file(mapped_segment_tree<int>{1, 2, 3}, path);
+  auto st = open_file<file_mapped_segment_tree<int>>(path);
+  st.resize(40);
+  std::vector<int> expected(40);
+  expected[0] = 1;
+  expected[1] = 2;
+  expected[2] = 3;
+  ExpectQueries(expected, st);
+  std::remove(path.c_str());
+}
+
+TEST(FileStorageTest, Errors) {
+  const std::string path = TempPath("errors");
+  EXPECT_THROW(static_cast<void>(open_file<file_segment_tree<int>>(path)),
+               std::system_error);
+
+  save_file(segment_tree<int>{1, 2, 3}, path);
+  EXPECT_THROW(
+      static_cast<void>(open_file<file_segment_tree<int, maximum<int>>>(path)),
+      std::runtime_error);
+  EXPECT_THROW(static_cast<void>(open_file<file_segment_tree<long>>(path)),
+               std::runtime_error);
+  EXPECT_THROW(
+      static_cast<void>(open_file<file_mapped_segment_tree<int>>(path)),
+      std::runtime_error);
+  std::remove(path.c_str());
+}
+
+TEST(FileStorageTest, CorruptedHeader) {
+  using details::file_header;
+  const std::string path = TempPath("corrupted");
+  const std::vector<int> as{1, 2, 3, 4, 5};
+  using simple = segment_tree<int>;
+  using file_simple = file_segment_tree<int>;
+  using mapped = mapped_segment_tree<int>;
+  using file_mapped = file_mapped_segment_tree<int>;
+  using mapped_veb =
+      mapped_segment_tree<int, std::plus<int>, details::default_mapper,
+                          std::allocator<int>, std::allocator<int>,
+                          veb_layout>;
+  using file_mapped_veb =
+      file_mapped_segment_tree<int, std::plus<int>, details::default_mapper,
+                               veb_layout>;
+
+  // The shift is not the one of a tree of five elements.
+  for (uint64_t shift : {0, 3, 6}) {
+    save_file(simple(as.begin(), as.end()), path);
+    PatchHeader(path, offsetof(file_header, shift), shift);
+    PatchHeader(path, offsetof(file_header, tree_count), shift + as.size());
+    ExpectCorrupted<simple, file_simple>(path);
+
+    save_file(mapped_veb(as.begin(), as.end()), path);
+    PatchHeader(path, offsetof(file_header, shift), shift);
+    PatchHeader(path, offsetof(file_header, tree_count), shift);
+    ExpectCorrupted<mapped_veb, file_mapped_veb>(path);
+  }
+
+  // The number of nodes of mapped_segment_tree does not match its size.
+  for (uint64_t tree_count : {0, 1, 2, 4}) {
+    save_file(mapped(as.begin(), as.end()), path);
+    PatchHeader(path, offsetof(file_header, tree_count), tree_count);
+    ExpectCorrupted<mapped, file_mapped>(path);
+  }
+
+  // Offsets which wrap around when the array size is added.
+  for (size_t field : {offsetof(file_header, data_offset),
+                       offsetof(file_header, tree_offset)}) {
+    const uint64_t offset = std::numeric_limits<uint64_t>::max() - 7;
+    save_file(mapped(as.begin(), as.end()), path);
+    PatchHeader(path, field, offset);
+    ExpectCorrupted<mapped, file_mapped>(path);
+    save_file(simple(as.begin(), as.end()), path);
+    PatchHeader(path, field, offset);
+    ExpectCorrupted<simple, file_simple>(path);
+  }
+
+  save_file(mapped(as.begin(), as.end()), path);
+  ExpectQueries(as, open_file<file_mapped>(path));
+  std::remove(path.c_str());
+}
+
+#endif  // MANAVRION_SEGMENT_TREE_HAS_MMAP
@@ -0,0 +1,108 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <random>
+#include <vector>
+
+#include "manavrion/segment_tree/fixed_segment_tree.h"
+#include "manavrion/segment_tree/functional.h"
+#include "manavrion/segment_tree/segment_tree.h"
+
+using namespace manavrion::segment_tree;
+
+namespace {
+
+constexpr fixed_segment_tree<int, 8> lite_tree = {0, 1, 2, 3, 4, 5, 6, 7};
+static_assert(lite_tree.query(0, 0) == 0);
+static_assert(lite_tree.query(2, 5) == 9);
+static_assert(lite_tree.query(0, 8) == 28);
+static_assert(lite_tree[6] == 6);
+
+// The table of squares is built at compile time and then updated.
+constexpr auto make_squares() {
+  std::array<int, 10> squares{};
+  for (int i = 0; i < 10; ++i) {
+    squares[i] = i * i;
+  }
+  fixed_segment_tree<int, 10, maximum<int>> tree(squares);
+  tree.update(3, 100);
+  return tree;
+}
+
+constexpr auto squares = make_squares();
+static_assert(squares.query(0, 3) == 4);
+static_assert(squares.query(0, 5) == 100);
+static_assert(squares.query(4, 10) == 81);
+
+template <size_t N, typename Reducer>
+void FixedSegmentTreeTest() {
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<> dist(-5, 5);
+
+  std::vector<int> as(N);
+  for (auto& a : as) {
+    a = dist(gen);
+  }
+  fixed_segment_tree<int, N, Reducer> test(as.begin(), as.end());
+  segment_tree<int, Reducer> canonical(as.begin(), as.end());
+
+  auto make_all_query = [&]() {
+    ASSERT_TRUE(std::equal(test.begin(), test.end(), canonical.begin(),
+                           canonical.end()));
+    for (size_t first_index = 0; first_index <= N; ++first_index) {
+      for (size_t last_index = first_index; last_index <= N; ++last_index) {
+        ASSERT_EQ(test.query(first_index, last_index),
+                  canonical.query(first_index, last_index));
+      }
+    }
+  };
+  make_all_query();
+
+  for (size_t update_count = 0; update_count < 100; ++update_count) {
+    const size_t index = gen() % N;
+    const int value = dist(gen);
+    test.update(index, value);
+    canonical.update(index, value);
+  }
+  make_all_query();
+}
+
+template <typename Reducer>
+void FixedSegmentTreeTest() {
+  FixedSegmentTreeTest<1, Reducer>();
+  FixedSegmentTreeTest<2, Reducer>();
+  FixedSegmentTreeTest<3, Reducer>();
+  FixedSegmentTreeTest<5, Reducer>();
+  FixedSegmentTreeTest<8, Reducer>();
+  FixedSegmentTreeTest<13, Reducer>();
+  FixedSegmentTreeTest<64, Reducer>();
+  FixedSegmentTreeTest<100, Reducer>();
+}
+
+}  // namespace
+
+TEST(FixedSegmentTreeTest, Plus) { FixedSegmentTreeTest<std::plus<int>>(); }
+
+TEST(FixedSegmentTreeTest, Minimum) { FixedSegmentTreeTest<minimum<int>>(); }
+
+TEST(FixedSegmentTreeTest, Maximum) { FixedSegmentTreeTest<maximum<int>>(); }
+
+TEST(FixedSegmentTreeTest, Elements) {
+  fixed_segment_tree<int, 5> st = {1, 2, 3};
+  EXPECT_EQ(std::vector<int>(st.begin(), st.end()),
+            std::vector<int>({1, 2, 3, 0, 0}));
+  EXPECT_EQ(std::vector<int>(st.rbegin(), st.rend()),
+            std::vector<int>({0, 0, 3, 2, 1}));
+  EXPECT_EQ(st.at(2), 3);
+  EXPECT_THROW(static_cast<void>(st.at(5)), std::out_of_range);
+  st.assign({4, 5, 6, 7, 8});
+  EXPECT_EQ(st.query(1, 4), 18);
+  EXPECT_EQ(st.size(), 5u);
+  // 7 nodes above 8 leaves and 5 elements.
+  EXPECT_EQ(st.bytes_used(), 12 * sizeof(int));
+}
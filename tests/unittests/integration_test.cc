@@ -6,10 +6,14 @@
 #include <gtest/gtest.h>
 
 #include <random>
+#include <vector>
 
+#include "manavrion/segment_tree/compact_segment_tree.h"
+#include "manavrion/segment_tree/fenwick_tree.h"
 #include "manavrion/segment_tree/mapped_segment_tree.h"
 #include "manavrion/segment_tree/naive_segment_tree.h"
 #include "manavrion/segment_tree/segment_tree.h"
+#include "manavrion/segment_tree/wide_segment_tree.h"
 
 using namespace manavrion::segment_tree;
 
@@ -84,8 +88,159 @@ void IntegrationTest() {
   }
 }
 
+template <typename SegmentTree>
+void UniformAssignTest() {
+  SegmentTree test;
+  for (size_t size = 0; size < 70; ++size) {
+    const int value = static_cast<int>(size % 7) - 3;
+    test.assign(size, value);
+    const std::vector<int> as(size, value);
+    const SegmentTree canonical(as.begin(), as.end());
+    ASSERT_EQ(test.size(), size);
+    for (size_t first_index = 0; first_index <= size; ++first_index) {
+      for (size_t last_index = first_index; last_index <= size; ++last_index) {
+        ASSERT_EQ(test.query(first_index, last_index),
+                  canonical.query(first_index, last_index));
+      }
+    }
+  }
+}
+
+template <typename SegmentTree>
+void PushBackTest() {
+  using Canonical = naive_segment_tree<int>;
+
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<> dist(-5, 5);
+
+  SegmentTree test;
+  Canonical canonical;
+  auto make_all_query = [&]() {
+    ASSERT_EQ(test.size(), canonical.size());
+    for (size_t first_index = 0; first_index <= test.size(); ++first_index) {
+      for (size_t last_index = first_index; last_index <= test.size();
+           ++last_index) {
+        ASSERT_EQ(test.query(first_index, last_index),
+                  canonical.query(first_index, last_index));
+      }
+    }
+  };
+
+  for (size_t step = 0; step < 300; ++step) {
+    // Appends are more likely, so the size crosses several powers of two.
+    if (canonical.size() == 0 || gen() % 3 != 0) {
+      const int value = dist(gen);
+      test.push_back(value);
+      canonical.insert(canonical.end(), value);
+    } else {
+      test.pop_back();
+      canonical.erase(std::prev(canonical.end()));
+    }
+    make_all_query();
+  }
+
+  while (!test.empty()) {
+    test.pop_back();
+    canonical.erase(std::prev(canonical.end()));
+    make_all_query();
+  }
+  test.emplace_back(3);
+  test.clear();
+  test.push_back(4);
+  EXPECT_EQ(test.query(0, 1), 4);
+
+  // The appended value refers to an element, also when the tree grows.
+  test.clear();
+  canonical.clear();
+  for (int value : {7, 8}) {
+    test.push_back(value);
+    canonical.insert(canonical.end(), value);
+  }
+  for (size_t step = 0; step < 40; ++step) {
+    const size_t index = step % test.size();
+    canonical.insert(canonical.end(), canonical[index]);
+    test.push_back(test[index]);
+    make_all_query();
+  }
+}
+
+// Counts the calls, so a rebuild of the whole tree is visible.
+size_t plus_calls = 0;
+
+struct CountingPlus {
+  int operator()(int a, int b) const {
+    ++plus_calls;
+    return a + b;
+  }
+};
+
+// Alternating push_back() and pop_back() at a power of two must not grow and
+// shrink the tree every time.
+template <typename SegmentTree>
+void PushPopBoundaryTest() {
+  const std::vector<int> as(1024, 1);
+  SegmentTree test(as.begin(), as.end());
+  test.push_back(1);
+  plus_calls = 0;
+  for (size_t step = 0; step < 100; ++step) {
+    test.pop_back();
+    ASSERT_EQ(test.query(0, test.size()), 1024);
+    test.push_back(1);
+    ASSERT_EQ(test.query(0, test.size()), 1025);
+  }
+  // Each call updates the ancestors of one leaf of 2048 and each query
+  // visits two nodes per level, a rebuild alone takes over 1024 calls.
+  EXPECT_LT(plus_calls, 200 * 3 * 12);
+
+  while (test.size() > 200) {
+    test.pop_back();
+    ASSERT_EQ(test.query(0, test.size()), static_cast<int>(test.size()));
+    ASSERT_EQ(test.query(test.size() / 2, test.size()),
+              static_cast<int>(test.size() - test.size() / 2));
+  }
+}
+
 }  // namespace
 
+TEST(IntegrationTest, PushPopBoundary) {
+  PushPopBoundaryTest<segment_tree<int, CountingPlus>>();
+  PushPopBoundaryTest<mapped_segment_tree<int, CountingPlus>>();
+  PushPopBoundaryTest<
+      segment_tree<int, CountingPlus, std::allocator<int>, veb_layout>>();
+  PushPopBoundaryTest<
+      mapped_segment_tree<int, CountingPlus, details::default_mapper,
+                          std::allocator<int>, std::allocator<int>,
+                          veb_layout>>();
+}
+
+TEST(IntegrationTest, PushBack) {
+  PushBackTest<segment_tree<int>>();
+  PushBackTest<mapped_segment_tree<int>>();
+  PushBackTest<
+      segment_tree<int, std::plus<int>, std::allocator<int>, veb_layout>>();
+  PushBackTest<
+      mapped_segment_tree<int, std::plus<int>, details::default_mapper,
+                          std::allocator<int>, std::allocator<int>,
+                          veb_layout>>();
+}
+
+TEST(IntegrationTest, UniformAssign) {
+  struct Square {
+    long long operator()(int v) const { return 1LL * v * v; }
+  };
+  UniformAssignTest<segment_tree<int>>();
+  UniformAssignTest<mapped_segment_tree<int>>();
+  UniformAssignTest<mapped_segment_tree<int, std::plus<long long>, Square>>();
+  UniformAssignTest<
+      segment_tree<int, std::plus<int>, std::allocator<int>, veb_layout>>();
+}
+
+TEST(IntegrationTest, CompactSegmentTree) {
+  IntegrationTest<compact_segment_tree<int>>();
+}
+
+TEST(IntegrationTest, FenwickTree) { IntegrationTest<fenwick_tree<int>>(); }
+
 TEST(IntegrationTest, MappedSegmentTree) {
   IntegrationTest<mapped_segment_tree<int>>();
 }
@@ -93,3 +248,21 @@ TEST(IntegrationTest, MappedSegmentTree) {
 TEST(IntegrationTest, SimpleSegmentTree) {
   IntegrationTest<segment_tree<int>>();
 }
+
+TEST(IntegrationTest, MappedSegmentTreeVebLayout) {
+  using mapped_veb_segment_tree =
+      mapped_segment_tree<int, std::plus<int>, details::default_mapper,
+                          std::allocator<int>, std::allocator<int>,
+                          veb_layout>;
+  IntegrationTest<mapped_veb_segment_tree>();
+}
+
+TEST(IntegrationTest, SimpleSegmentTreeVebLayout) {
+  IntegrationTest<
+      segment_tree<int, std::plus<int>, std::allocator<int>, veb_layout>>();
+}
+
+TEST(IntegrationTest, WideSegmentTree) {
+  IntegrationTest<wide_segment_tree<int>>();
+  IntegrationTest<wide_segment_tree<int, std::plus<int>, 4>>();
+}
@@ -0,0 +1,71 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "manavrion/segment_tree/layout.h"
+
+using namespace manavrion::segment_tree;
+
+namespace {
+
+template <typename Layout>
+void PermutationTest() {
+  for (size_t height = 1; height <= 16; ++height) {
+    const size_t nodes = (size_t{1} << height) - 1;
+    std::vector<bool> used(nodes);
+    for (size_t node = 0; node < nodes; ++node) {
+      const size_t position = Layout::position(node, nodes);
+      ASSERT_LT(position, nodes);
+      EXPECT_FALSE(used[position]);
+      used[position] = true;
+    }
+    EXPECT_EQ(Layout::position(nodes, nodes), nodes);
+  }
+}
+
+template <typename Layout>
+void AncestorPositionsTest() {
+  for (size_t height = 1; height <= 12; ++height) {
+    const size_t nodes = (size_t{1} << height) - 1;
+    std::vector<size_t> positions(height + 1);
+    std::vector<size_t> siblings(height + 1);
+    for (size_t node = 0; node < 2 * nodes + 1; ++node) {
+      const size_t depth = Layout::ancestor_positions(
+          node, nodes, positions.data(), siblings.data());
+      size_t ancestor = node;
+      for (size_t i = depth; i != 0; --i) {
+        const size_t sibling =
+            ancestor % 2 != 0 ? ancestor + 1 : ancestor - 1;
+        EXPECT_EQ(positions[i], Layout::position(ancestor, nodes));
+        EXPECT_EQ(siblings[i], Layout::position(sibling, nodes));
+        ancestor = (ancestor - 1) / 2;
+      }
+      EXPECT_EQ(positions[0], 0);
+    }
+  }
+}
+
+}  // namespace
+
+TEST(LayoutTest, HeapLayout) {
+  PermutationTest<heap_layout>();
+  AncestorPositionsTest<heap_layout>();
+}
+
+TEST(LayoutTest, VebLayout) {
+  PermutationTest<veb_layout>();
+  AncestorPositionsTest<veb_layout>();
+}
+
+TEST(LayoutTest, VebLayoutOrder) {
+  const std::vector<size_t> expected = {0, 1, 2,  3,  6,  9,  12, 4,
+                                        5, 7, 8, 10, 11, 13, 14};
+  for (size_t node = 0; node < expected.size(); ++node) {
+    EXPECT_EQ(veb_layout::position(node, expected.size()), expected[node]);
+  }
+}
@@ -0,0 +1,128 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include "manavrion/segment_tree/lazy_segment_tree.h"
+#include "manavrion/segment_tree/naive_segment_tree.h"
+
+using namespace manavrion::segment_tree;
+
+namespace {
+
+template <typename LazySegmentTree, typename MakeTag, typename ApplyTag>
+void LazyIntegrationTestImpl(const std::vector<int> as, MakeTag make_tag,
+                             ApplyTag apply_tag) {
+  std::random_device rd;
+  std::mt19937 gen(rd());
+  std::uniform_int_distribution<> dist(-5, 5);
+
+  LazySegmentTree test(as.begin(), as.end());
+  naive_segment_tree<int> canonical(as.begin(), as.end());
+
+  auto make_all_query = [&]() {
+    for (size_t i = 0; i < as.size(); ++i) {
+      EXPECT_EQ(test[i], canonical[i]);
+    }
+    for (size_t first_index = 0; first_index <= as.size(); ++first_index) {
+      for (size_t last_index = first_index; last_index <= as.size();
+           ++last_index) {
+        auto test_res = test.query(first_index, last_index);
+        auto canonical_res = canonical.query(first_index, last_index);
+        EXPECT_EQ(test_res, canonical_res);
+      }
+    }
+  };
+  make_all_query();
+
+  for (size_t first_index = 0; first_index <= as.size(); ++first_index) {
+    for (size_t last_index = first_index; last_index <= as.size();
+         ++last_index) {
+      const auto tag = make_tag(gen);
+      test.apply(first_index, last_index, tag);
+      for (size_t i = first_index; i < last_index; ++i) {
+        canonical.update(i, apply_tag(canonical[i], tag));
+      }
+      const size_t query_first = std::min(first_index, as.size() / 2);
+      EXPECT_EQ(test.query(query_first, last_index),
+                canonical.query(query_first, last_index));
+    }
+  }
+  make_all_query();
+
+  if (!as.empty()) {
+    std::uniform_int_distribution<> dist_indexes(0, as.size() - 1);
+    for (size_t update_count = 0; update_count < 100; ++update_count) {
+      const size_t index = dist_indexes(gen);
+      int value = dist(gen);
+      test.update(index, value);
+      canonical.update(index, value);
+    }
+  }
+  make_all_query();
+}
+
+template <typename LazySegmentTree, typename MakeTag, typename ApplyTag>
+void LazyIntegrationTest(MakeTag make_tag, ApplyTag apply_tag) {
+  std::random_device rd;
+  std::mt19937 gen(rd());
+  std::uniform_int_distribution<> dist(-5, 5);
+
+  for (size_t size = 0; size < 40; ++size) {
+    for (size_t repeat = 0; repeat < 3; ++repeat) {
+      std::vector<int> as(size);
+      for (auto& a : as) {
+        a = dist(gen);
+      }
+      LazyIntegrationTestImpl<LazySegmentTree>(std::move(as), make_tag,
+                                               apply_tag);
+    }
+  }
+}
+
+}  // namespace
+
+TEST(LazySegmentTreeTest, Lite) {
+  lazy_segment_tree<int> st = {0, 1, 2, 3, 4, 5, 6, 7};
+  EXPECT_EQ(st.query(0, 0), 0);
+  EXPECT_EQ(st.query(2, 5), 9);
+
+  st.apply(1, 7, 10);
+  EXPECT_EQ(st.query(0, 8), 88);
+  EXPECT_EQ(st.query(2, 5), 39);
+  EXPECT_EQ(st[0], 0);
+  EXPECT_EQ(st[6], 16);
+  EXPECT_EQ(st.at(7), 7);
+  EXPECT_THROW((void)st.at(8), std::out_of_range);
+}
+
+TEST(LazySegmentTreeTest, RangeAdd) {
+  LazyIntegrationTest<lazy_segment_tree<int>>(
+      [](auto& gen) { return std::uniform_int_distribution<>(-5, 5)(gen); },
+      [](int value, int tag) { return value + tag; });
+}
+
+TEST(LazySegmentTreeTest, RangeAssign) {
+  LazyIntegrationTest<lazy_segment_tree<int, std::plus<int>, assign_action<int>,
+                                        assign_compose<int>>>(
+      [](auto& gen) { return std::uniform_int_distribution<>(-5, 5)(gen); },
+      [](int, int tag) { return tag; });
+}
+
+TEST(LazySegmentTreeTest, RangeAffine) {
+  LazyIntegrationTest<lazy_segment_tree<int, std::plus<int>, affine_action<int>,
+                                        affine_compose<int>>>(
+      [](auto& gen) {
+        // Multipliers are kept in [-1, 1], so values can not overflow.
+        std::uniform_int_distribution<> mul_dist(-1, 1);
+        std::uniform_int_distribution<> add_dist(-2, 2);
+        return std::make_pair(mul_dist(gen), add_dist(gen));
+      },
+      [](int value, std::pair<int, int> tag) {
+        return tag.first * value + tag.second;
+      });
+}
@@ -5,9 +5,14 @@
 
 #include <gtest/gtest.h>
 
+#include <vector>
+
+#include "manavrion/segment_tree/compact_segment_tree.h"
+#include "manavrion/segment_tree/fenwick_tree.h"
 #include "manavrion/segment_tree/mapped_segment_tree.h"
 #include "manavrion/segment_tree/naive_segment_tree.h"
 #include "manavrion/segment_tree/segment_tree.h"
+#include "manavrion/segment_tree/wide_segment_tree.h"
 
 using namespace manavrion::segment_tree;
 
@@ -26,8 +31,40 @@ void LiteTest() {
 
 }  // namespace
 
+TEST(LiteTest, CompactSegmentTree) { LiteTest<compact_segment_tree<int>>(); }
+
+TEST(LiteTest, CompactSegmentTreeBytesUsed) {
+  // segment_tree pads n to a power of two and takes up to 3n values.
+  for (size_t n : {5, 17, 1025}) {
+    const std::vector<int> numbers(n);
+    compact_segment_tree<int> compact_st(numbers.begin(), numbers.end());
+    segment_tree<int> st(numbers.begin(), numbers.end());
+    EXPECT_EQ(compact_st.bytes_used(), 2 * n * sizeof(int));
+    EXPECT_LT(compact_st.bytes_used(), st.bytes_used());
+  }
+}
+
+TEST(LiteTest, FenwickTree) {
+  LiteTest<fenwick_tree<int>>();
+  LiteTest<range_fenwick_tree<int>>();
+}
+
+TEST(LiteTest, FenwickTreeBytesUsed) {
+  for (size_t n : {5, 17, 1025}) {
+    const std::vector<int> numbers(n);
+    fenwick_tree<int> fenwick(numbers.begin(), numbers.end());
+    EXPECT_EQ(fenwick.bytes_used(), n * sizeof(int));
+  }
+}
+
 TEST(LiteTest, MappedSegmentTree) { LiteTest<mapped_segment_tree<int>>(); }
 
 TEST(LiteTest, NaiveSegmentTree) { LiteTest<naive_segment_tree<int>>(); }
 
 TEST(LiteTest, SimpleSegmentTree) { LiteTest<segment_tree<int>>(); }
+
+TEST(LiteTest, WideSegmentTree) {
+  LiteTest<wide_segment_tree<int>>();
+  LiteTest<wide_segment_tree<int, std::plus<int>, 2>>();
+  LiteTest<wide_segment_tree<int, std::plus<int>, 3>>();
+}
@@ -0,0 +1,148 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#include <gtest/gtest.h>
+
+#include <climits>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "manavrion/segment_tree/compact_segment_tree.h"
+#include "manavrion/segment_tree/functional.h"
+#include "manavrion/segment_tree/mapped_segment_tree.h"
+#include "manavrion/segment_tree/naive_segment_tree.h"
+#include "manavrion/segment_tree/segment_tree.h"
+
+using namespace manavrion::segment_tree;
+
+namespace {
+
+// Concatenation of strings, which has the identity but is not commutative.
+struct concat_reducer {
+  std::string operator()(const std::string& lhs,
+                         const std::string& rhs) const {
+    return lhs + rhs;
+  }
+};
+
+}  // namespace
+
+namespace manavrion::segment_tree {
+
+template <>
+struct monoid_traits<concat_reducer, std::string> {
+  static constexpr bool has_identity = true;
+  static constexpr bool is_commutative = false;
+  static constexpr bool is_idempotent = false;
+  static constexpr bool is_invertible = false;
+  static std::string identity() { return {}; }
+};
+
+}  // namespace manavrion::segment_tree
+
+namespace {
+
+static_assert(monoid_traits<std::plus<int>, int>::identity() == 0);
+static_assert(monoid_traits<std::plus<int>, int>::is_invertible);
+static_assert(monoid_traits<std::multiplies<>, long>::identity() == 1);
+static_assert(monoid_traits<minimum<int>, int>::identity() == INT_MAX);
+static_assert(monoid_traits<maximum<int>, int>::identity() == INT_MIN);
+static_assert(monoid_traits<minimum<double>, double>::is_idempotent);
+static_assert(!monoid_traits<std::plus<int>, int>::is_idempotent);
+static_assert(!monoid_traits<std::plus<std::string>, std::string>::
+                  has_identity);
+static_assert(!monoid_traits<std::plus<std::string>, std::string>::
+                  is_commutative);
+
+template <template <typename, typename> typename SegmentTree>
+void EmptyQueryTest() {
+  const std::vector<int> numbers = {3, 1, 4, 1, 5};
+  SegmentTree<int, std::multiplies<int>> mul(numbers.begin(), numbers.end());
+  SegmentTree<int, minimum<int>> min(numbers.begin(), numbers.end());
+  SegmentTree<int, maximum<int>> max(numbers.begin(), numbers.end());
+
+  EXPECT_EQ(mul.query(2, 2), 1);
+  EXPECT_EQ(min.query(2, 2), INT_MAX);
+  EXPECT_EQ(max.query(2, 2), INT_MIN);
+  EXPECT_EQ(mul.query(0, 5), 60);
+  EXPECT_EQ(min.query(0, 5), 1);
+  EXPECT_EQ(max.query(0, 5), 5);
+}
+
+template <typename T, typename Reducer>
+using segment_tree_t = segment_tree<T, Reducer>;
+
+template <typename T, typename Reducer>
+using compact_segment_tree_t = compact_segment_tree<T, Reducer>;
+
+template <typename T, typename Reducer>
+using mapped_segment_tree_t = mapped_segment_tree<T, Reducer>;
+
+template <typename T, typename Reducer>
+using naive_segment_tree_t = naive_segment_tree<T, Reducer>;
+
+// The letters of the segment must be concatenated in their order.
+template <typename SegmentTree, bool WithBatch>
+void OrderTest() {
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<> dist('a', 'z');
+
+  for (size_t size = 0; size < 40; ++size) {
+    std::vector<std::string> letters(size);
+    for (auto& letter : letters) {
+      letter = std::string(1, static_cast<char>(dist(gen)));
+    }
+    SegmentTree test(letters.begin(), letters.end());
+
+    std::string word;
+    for (const auto& letter : letters) {
+      word += letter;
+    }
+
+    std::vector<std::pair<size_t, size_t>> queries;
+    for (size_t first_index = 0; first_index <= size; ++first_index) {
+      for (size_t last_index = first_index; last_index <= size; ++last_index) {
+        ASSERT_EQ(test.query(first_index, last_index),
+                  word.substr(first_index, last_index - first_index));
+        queries.emplace_back(first_index, last_index);
+      }
+    }
+
+    if constexpr (WithBatch) {
+      std::vector<std::string> results(queries.size());
+      test.query_batch(queries.begin(), queries.end(), results.begin());
+      for (size_t i = 0; i < queries.size(); ++i) {
+        const auto [first_index, last_index] = queries[i];
+        ASSERT_EQ(results[i],
+                  word.substr(first_index, last_index - first_index));
+      }
+    }
+  }
+}
+
+template <typename Reducer>
+void OrderTest() {
+  OrderTest<segment_tree<std::string, Reducer>, true>();
+  OrderTest<compact_segment_tree<std::string, Reducer>, false>();
+  OrderTest<mapped_segment_tree<std::string, Reducer>, true>();
+  OrderTest<naive_segment_tree<std::string, Reducer>, false>();
+}
+
+}  // namespace
+
+TEST(MonoidTraitsTest, EmptyQuery) {
+  EmptyQueryTest<segment_tree_t>();
+  EmptyQueryTest<compact_segment_tree_t>();
+  EmptyQueryTest<mapped_segment_tree_t>();
+  EmptyQueryTest<naive_segment_tree_t>();
+}
+
+TEST(MonoidTraitsTest, OrderWithIdentity) { OrderTest<concat_reducer>(); }
+
+TEST(MonoidTraitsTest, OrderWithoutIdentity) {
+  OrderTest<std::plus<std::string>>();
+}
@@ -0,0 +1,102 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#include "manavrion/segment_tree/functional.h"
+#include "manavrion/segment_tree/mapped_segment_tree.h"
+#include "manavrion/segment_tree/segment_tree.h"
+
+using namespace manavrion::segment_tree;
+
+namespace {
+
+template <typename SegmentTree>
+void ExpectSameQueries(const SegmentTree& expected, const SegmentTree& actual) {
+  ASSERT_EQ(expected.size(), actual.size());
+  for (size_t first = 0; first <= expected.size(); ++first) {
+    for (size_t last = first; last <= expected.size(); ++last) {
+      ASSERT_EQ(expected.query(first, last), actual.query(first, last))
+          << "[" << first << ", " << last << ")";
+    }
+  }
+}
+
+std::vector<int> GetNumbers(size_t n) {
+  std::vector<int> numbers(n);
+  std::iota(numbers.begin(), numbers.end(), 1);
+  return numbers;
+}
+
+struct Square {
+  int operator()(int v) const { return v * v; }
+};
+
+template <typename SegmentTree>
+void ParallelBuildTest() {
+  for (size_t n = 0; n <= 70; ++n) {
+    const auto numbers = GetNumbers(n);
+    const SegmentTree expected(numbers.begin(), numbers.end());
+    for (size_t threads = 1; threads <= 8; ++threads) {
+      const SegmentTree actual(parallel_build(threads), numbers.begin(),
+                               numbers.end());
+      ExpectSameQueries(expected, actual);
+
+      SegmentTree assigned;
+      assigned.assign(parallel_build(threads), numbers.begin(), numbers.end());
+      ExpectSameQueries(expected, assigned);
+    }
+  }
+}
+
+}  // namespace
+
+TEST(ParallelBuildTest, SegmentTree) {
+  ParallelBuildTest<segment_tree<int>>();
+  ParallelBuildTest<segment_tree<int, minimum<int>>>();
+}
+
+TEST(ParallelBuildTest, SegmentTreeVebLayout) {
+  ParallelBuildTest<
+      segment_tree<int, std::plus<int>, std::allocator<int>, veb_layout>>();
+}
+
+TEST(ParallelBuildTest, MappedSegmentTree) {
+  ParallelBuildTest<mapped_segment_tree<int>>();
+  ParallelBuildTest<mapped_segment_tree<int, std::plus<int>, Square>>();
+}
+
+TEST(ParallelBuildTest, MappedSegmentTreeVebLayout) {
+  ParallelBuildTest<
+      mapped_segment_tree<int, std::plus<int>, Square, std::allocator<int>,
+                          std::allocator<int>, veb_layout>>();
+}
+
+TEST(ParallelBuildTest, DefaultThreads) {
+  const auto numbers = GetNumbers(1000);
+  const segment_tree<int> st(parallel_build(), numbers.begin(), numbers.end());
+  EXPECT_GE(parallel_build().threads, 1);
+  EXPECT_EQ(st.query(0, 1000), 500500);
+}
+
+TEST(ParallelBuildTest, MapperException) {
+  struct ThrowingMapper {
+    int operator()(int v) const {
+      if (v == 50) {
+        throw std::runtime_error("mapper");
+      }
+      return v;
+    }
+  };
+  const auto numbers = GetNumbers(64);
+  using SegmentTree = mapped_segment_tree<int, std::plus<int>, ThrowingMapper>;
+  EXPECT_THROW(SegmentTree(parallel_build(4), numbers.begin(), numbers.end()),
+               std::runtime_error);
+}
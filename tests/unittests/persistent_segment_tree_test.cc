@@ -0,0 +1,107 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "manavrion/segment_tree/functional.h"
+#include "manavrion/segment_tree/naive_segment_tree.h"
+#include "manavrion/segment_tree/persistent_segment_tree.h"
+
+using namespace manavrion::segment_tree;
+
+namespace {
+
+template <typename T, typename Reducer>
+void ExpectVersion(const std::vector<T>& expected,
+                   const persistent_segment_tree<T, Reducer>& st,
+                   size_t version) {
+  const naive_segment_tree<T, Reducer> naive(expected.begin(), expected.end());
+  for (size_t first = 0; first <= expected.size(); ++first) {
+    for (size_t last = first; last <= expected.size(); ++last) {
+      ASSERT_EQ(naive.query(first, last), st.query(version, first, last))
+          << "version " << version << " [" << first << ", " << last << ")";
+    }
+  }
+  for (size_t i = 0; i < expected.size(); ++i) {
+    ASSERT_EQ(expected[i], st.at(version, i));
+  }
+}
+
+}  // namespace
+
+TEST(PersistentSegmentTreeTest, Simple) {
+  persistent_segment_tree<int> st{1, 2, 3, 4, 5};
+  EXPECT_EQ(st.size(), 5);
+  EXPECT_EQ(st.versions(), 1);
+  EXPECT_EQ(st.query(0, 5), 15);
+
+  EXPECT_EQ(st.update(2, 10), 1);
+  EXPECT_EQ(st.update(0, 0), 2);
+  EXPECT_EQ(st.query(0, 5), 21);
+  EXPECT_EQ(st.query(1, 0, 5), 22);
+  EXPECT_EQ(st.query(0, 0, 5), 15);
+
+  // Branching from an old version.
+  EXPECT_EQ(st.update(0, 4, 50), 3);
+  EXPECT_EQ(st.query(3, 0, 5), 60);
+  EXPECT_EQ(st.query(2, 0, 5), 21);
+
+  EXPECT_EQ(st.at(1, 2), 10);
+  EXPECT_THROW(static_cast<void>(st.at(4, 0)), std::out_of_range);
+  EXPECT_THROW(static_cast<void>(st.at(0, 5)), std::out_of_range);
+}
+
+TEST(PersistentSegmentTreeTest, Empty) {
+  persistent_segment_tree<int> st;
+  EXPECT_TRUE(st.empty());
+  EXPECT_EQ(st.versions(), 1);
+  EXPECT_EQ(st.query(0, 0), 0);
+}
+
+TEST(PersistentSegmentTreeTest, RandomVersions) {
+  std::mt19937 gen(42);
+  for (size_t n = 1; n <= 33; ++n) {
+    std::vector<std::vector<std::string>> expected(1);
+    for (size_t i = 0; i < n; ++i) {
+      expected[0].push_back(std::to_string(i));
+    }
+    persistent_segment_tree<std::string> st(expected[0].begin(),
+                                            expected[0].end());
+    st.reserve(20);
+    for (int i = 0; i < 20; ++i) {
+      const size_t version = gen() % st.versions();
+      const size_t index = gen() % n;
+      const std::string value = "v" + std::to_string(i);
+      ASSERT_EQ(st.update(version, index, value), expected.size());
+      expected.push_back(expected[version]);
+      expected.back()[index] = value;
+    }
+    for (size_t version = 0; version < expected.size(); ++version) {
+      ExpectVersion(expected[version], st, version);
+    }
+  }
+}
+
+TEST(PersistentSegmentTreeTest, Minimum) {
+  persistent_segment_tree<int, minimum<int>> st{5, 3, 8, 1};
+  st.update(3, 9);
+  EXPECT_EQ(st.query(0, 0, 4), 1);
+  EXPECT_EQ(st.query(1, 0, 4), 3);
+  ExpectVersion<int, minimum<int>>({5, 3, 8, 9}, st, 1);
+}
+
+TEST(PersistentSegmentTreeTest, Move) {
+  persistent_segment_tree<int> st{1, 2, 3};
+  st.update(1, 20);
+  persistent_segment_tree<int> moved = std::move(st);
+  EXPECT_EQ(moved.query(0, 0, 3), 6);
+  EXPECT_EQ(moved.query(1, 0, 3), 24);
+  EXPECT_GT(moved.bytes_used(), 0);
+}
@@ -0,0 +1,167 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "manavrion/segment_tree/functional.h"
+#include "manavrion/segment_tree/naive_segment_tree.h"
+#include "manavrion/segment_tree/rope_segment_tree.h"
+
+using namespace manavrion::segment_tree;
+
+namespace {
+
+template <typename T, typename Reducer>
+void ExpectRope(const std::vector<T>& expected,
+                const rope_segment_tree<T, Reducer>& st) {
+  ASSERT_EQ(expected.size(), st.size());
+  const naive_segment_tree<T, Reducer> naive(expected.begin(), expected.end());
+  for (size_t first = 0; first <= expected.size(); ++first) {
+    for (size_t last = first; last <= expected.size(); ++last) {
+      ASSERT_EQ(naive.query(first, last), st.query(first, last))
+          << "[" << first << ", " << last << ")";
+    }
+  }
+  std::vector<T> elements;
+  st.for_each([&](const T& value) { elements.push_back(value); });
+  ASSERT_EQ(expected, elements);
+}
+
+}  // namespace
+
+TEST(RopeSegmentTreeTest, Simple) {
+  rope_segment_tree<int> st{1, 2, 3, 4, 5};
+  EXPECT_EQ(st.size(), 5);
+  EXPECT_EQ(st.query(0, 5), 15);
+
+  st.insert(2, 10);
+  EXPECT_EQ(st.size(), 6);
+  EXPECT_EQ(st[2], 10);
+  EXPECT_EQ(st.query(0, 3), 13);
+
+  st.erase(0);
+  EXPECT_EQ(st.query(0, 5), 24);
+
+  st.update(4, 50);
+  EXPECT_EQ(st.at(4), 50);
+  EXPECT_THROW(static_cast<void>(st.at(5)), std::out_of_range);
+  ExpectRope<int, std::plus<int>>({2, 10, 3, 4, 50}, st);
+}
+
+TEST(RopeSegmentTreeTest, Empty) {
+  rope_segment_tree<int> st;
+  EXPECT_TRUE(st.empty());
+  EXPECT_EQ(st.query(0, 0), 0);
+  EXPECT_EQ(st.bytes_used(), 0);
+
+  st.push_back(1);
+  st.pop_back();
+  EXPECT_TRUE(st.empty());
+}
+
+TEST(RopeSegmentTreeTest, SplitConcat) {
+  rope_segment_tree<int> st{1, 2, 3, 4, 5, 6};
+  rope_segment_tree<int> right = st.split(4);
+  ExpectRope<int, std::plus<int>>({1, 2, 3, 4}, st);
+  ExpectRope<int, std::plus<int>>({5, 6}, right);
+
+  // Both ropes are modified through the shared pool.
+  right.insert(0, 7);
+  st.erase(0, 2);
+  ExpectRope<int, std::plus<int>>({3, 4}, st);
+  ExpectRope<int, std::plus<int>>({7, 5, 6}, right);
+
+  right.concat(std::move(st));
+  EXPECT_TRUE(st.empty());
+  ExpectRope<int, std::plus<int>>({7, 5, 6, 3, 4}, right);
+
+  // Ropes with different pools.
+  rope_segment_tree<int> other{8, 9};
+  right.concat(std::move(other));
+  EXPECT_TRUE(other.empty());
+  ExpectRope<int, std::plus<int>>({7, 5, 6, 3, 4, 8, 9}, right);
+}
+
+TEST(RopeSegmentTreeTest, Copy) {
+  rope_segment_tree<int> st{1, 2, 3};
+  rope_segment_tree<int> right = st.split(1);
+  rope_segment_tree<int> copy = right;
+  copy.update(0, 20);
+  ExpectRope<int, std::plus<int>>({2, 3}, right);
+  ExpectRope<int, std::plus<int>>({20, 3}, copy);
+
+  rope_segment_tree<int> moved = std::move(copy);
+  EXPECT_TRUE(copy.empty());
+  ExpectRope<int, std::plus<int>>({20, 3}, moved);
+}
+
+TEST(RopeSegmentTreeTest, Random) {
+  std::mt19937 gen(42);
+  std::vector<std::string> expected;
+  for (int i = 0; i < 20; ++i) {
+    expected.push_back(std::to_string(i));
+  }
+  rope_segment_tree<std::string> st(expected.begin(), expected.end());
+  for (int i = 0; i < 300; ++i) {
+    const std::string value = "v" + std::to_string(i);
+    switch (gen() % 5) {
+      case 0: {
+        const size_t pos = gen() % (expected.size() + 1);
+        st.insert(pos, value);
+        expected.insert(expected.begin() + pos, value);
+        break;
+      }
+      case 1: {
+        if (expected.empty()) {
+          break;
+        }
+        const size_t first = gen() % expected.size();
+        const size_t last = first + gen() % (expected.size() - first + 1);
+        st.erase(first, last);
+        expected.erase(expected.begin() + first, expected.begin() + last);
+        break;
+      }
+      case 2: {
+        const size_t pos = gen() % (expected.size() + 1);
+        rope_segment_tree<std::string> right = st.split(pos);
+        right.concat(std::move(st));
+        st = std::move(right);
+        std::rotate(expected.begin(), expected.begin() + pos, expected.end());
+        break;
+      }
+      case 3: {
+        const size_t pos = gen() % (expected.size() + 1);
+        const std::vector<std::string> values{value, value + "a"};
+        st.insert(pos, values.begin(), values.end());
+        expected.insert(expected.begin() + pos, values.begin(), values.end());
+        break;
+      }
+      default: {
+        if (expected.empty()) {
+          break;
+        }
+        const size_t pos = gen() % expected.size();
+        st.update(pos, value);
+        expected[pos] = value;
+        break;
+      }
+    }
+    ExpectRope<std::string, std::plus<std::string>>(expected, st);
+  }
+}
+
+TEST(RopeSegmentTreeTest, Minimum) {
+  rope_segment_tree<int, minimum<int>> st{5, 3, 8, 1};
+  st.erase(3);
+  st.insert(0, 4);
+  EXPECT_EQ(st.query(0, 4), 3);
+  EXPECT_EQ(st.query(2, 4), 3);
+  ExpectRope<int, minimum<int>>({4, 5, 3, 8}, st);
+}
@@ -0,0 +1,205 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "manavrion/segment_tree/functional.h"
+#include "manavrion/segment_tree/mapped_segment_tree.h"
+#include "manavrion/segment_tree/naive_segment_tree.h"
+#include "manavrion/segment_tree/segment_tree.h"
+
+using namespace manavrion::segment_tree;
+
+namespace {
+
+// Checks max_right() and min_left() with sum thresholds against the naive
+// linear search.
+template <typename SegmentTree>
+void SumSearchTest() {
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<> dist(0, 5);
+
+  for (size_t size = 0; size < 70; ++size) {
+    std::vector<int> as(size);
+    for (auto& a : as) {
+      a = dist(gen);
+    }
+    const SegmentTree test(as.begin(), as.end());
+    const naive_segment_tree<int> canonical(as.begin(), as.end());
+
+    for (int limit = 0; limit <= 12; limit += 3) {
+      auto pred = [limit](int sum) { return sum <= limit; };
+      for (size_t first_index = 0; first_index <= size; ++first_index) {
+        size_t expected = first_index;
+        while (expected < size &&
+               pred(canonical.query(first_index, expected + 1))) {
+          ++expected;
+        }
+        ASSERT_EQ(test.max_right(first_index, pred), expected)
+            << "size " << size << " first " << first_index;
+      }
+      for (size_t last_index = 0; last_index <= size; ++last_index) {
+        size_t expected = last_index;
+        while (expected > 0 &&
+               pred(canonical.query(expected - 1, last_index))) {
+          --expected;
+        }
+        ASSERT_EQ(test.min_left(last_index, pred), expected)
+            << "size " << size << " last " << last_index;
+      }
+    }
+
+    int prefix = 0;
+    for (size_t i = 0; i < size; ++i) {
+      prefix += as[i];
+      const size_t expected =
+          std::find_if(as.begin(), as.end(),
+                       [&, sum = 0](int a) mutable {
+                         return (sum += a) >= prefix;
+                       }) -
+          as.begin();
+      ASSERT_EQ(test.lower_bound_prefix(prefix), expected);
+    }
+    ASSERT_EQ(test.lower_bound_prefix(prefix + 1), size);
+  }
+}
+
+}  // namespace
+
+TEST(SearchTest, SimpleSegmentTree) { SumSearchTest<segment_tree<int>>(); }
+
+TEST(SearchTest, SimpleSegmentTreeVebLayout) {
+  SumSearchTest<segment_tree<int, std::plus<int>, std::allocator<int>,
+                             veb_layout>>();
+}
+
+TEST(SearchTest, MappedSegmentTree) {
+  SumSearchTest<mapped_segment_tree<int>>();
+}
+
+TEST(SearchTest, MappedSegmentTreeVebLayout) {
+  SumSearchTest<
+      mapped_segment_tree<int, std::plus<int>, details::default_mapper,
+                          std::allocator<int>, std::allocator<int>,
+                          veb_layout>>();
+}
+
+TEST(SearchTest, Maximum) {
+  const std::vector<int> as{1, 4, 2, 7, 3, 9, 1};
+  const segment_tree<int, maximum<int>> st(as.begin(), as.end());
+  auto below_seven = [](int max) { return max < 7; };
+  EXPECT_EQ(st.max_right(0, below_seven), 3);
+  EXPECT_EQ(st.max_right(4, below_seven), 5);
+  EXPECT_EQ(st.max_right(6, below_seven), 7);
+  EXPECT_EQ(st.min_left(7, below_seven), 6);
+  EXPECT_EQ(st.min_left(3, below_seven), 0);
+}
+
+TEST(SearchTest, NonCommutative) {
+  const std::vector<std::string> as{"a", "bc", "d", "ef", "g"};
+  const segment_tree<std::string> st(as.begin(), as.end());
+  const mapped_segment_tree<std::string> mapped(as.begin(), as.end());
+  auto pred = [](const std::string& s) { return s.size() <= 3; };
+  EXPECT_EQ(st.max_right(0, pred), 2);
+  EXPECT_EQ(st.max_right(1, pred), 3);
+  EXPECT_EQ(st.min_left(5, pred), 3);
+  EXPECT_EQ(mapped.max_right(0, pred), 2);
+  EXPECT_EQ(mapped.min_left(5, pred), 3);
+  // The order of reduction is checked by a prefix which is rejected.
+  auto no_cd = [](const std::string& s) {
+    return s.find("cd") == std::string::npos;
+  };
+  EXPECT_EQ(st.max_right(0, no_cd), 2);
+  EXPECT_EQ(st.min_left(5, no_cd), 2);
+}
+
+namespace {
+
+// Nodes which cover indices past size() are partial, push_back() and
+// pop_back() leave them stale and the searches must not read them.
+template <typename SegmentTree>
+void GrowingSearchTest() {
+  std::mt19937 gen(7);
+  std::uniform_int_distribution<> dist(0, 5);
+
+  SegmentTree test;
+  std::vector<int> as;
+  auto check = [&] {
+    int prefix = 0;
+    for (size_t i = 0; i < as.size(); ++i) {
+      prefix += as[i];
+      size_t expected = 0;
+      for (int sum = 0; expected < as.size() && (sum += as[expected]) < prefix;
+           ++expected) {
+      }
+      ASSERT_EQ(test.lower_bound_prefix(prefix), expected)
+          << "size " << as.size() << " prefix " << prefix;
+    }
+    ASSERT_EQ(test.lower_bound_prefix(prefix + 1), as.size());
+    for (size_t first_index = 0; first_index <= as.size(); ++first_index) {
+      ASSERT_EQ(test.max_right(first_index, [](int) { return true; }),
+                as.size());
+    }
+  };
+
+  for (size_t size = 0; size < 70; ++size) {
+    as.push_back(dist(gen));
+    test.push_back(as.back());
+    check();
+  }
+  while (!as.empty()) {
+    as.pop_back();
+    test.pop_back();
+    check();
+  }
+}
+
+}  // namespace
+
+TEST(SearchTest, SimpleSegmentTreePushPop) {
+  GrowingSearchTest<segment_tree<int>>();
+}
+
+TEST(SearchTest, MappedSegmentTreePushPop) {
+  GrowingSearchTest<mapped_segment_tree<int>>();
+}
+
+TEST(SearchTest, PushBackOnes) {
+  segment_tree<int> st{1, 1, 1, 1};
+  st.push_back(1);
+  EXPECT_EQ(st.lower_bound_prefix(5), 4);
+  EXPECT_EQ(st.lower_bound_prefix(6), 5);
+}
+
+TEST(SearchTest, MinimumAndMaximumAfterUpdate) {
+  for (size_t size = 1; size < 40; ++size) {
+    const std::vector<int> as(size, 5);
+    segment_tree<int, minimum<int>> min_st(as.begin(), as.end());
+    segment_tree<int, maximum<int>> max_st(as.begin(), as.end());
+    mapped_segment_tree<int, minimum<int>> min_mapped(as.begin(), as.end());
+    for (size_t i = 0; i < size; ++i) {
+      min_st.update(i, 5);
+      max_st.update(i, 5);
+      min_mapped.update(i, 5);
+    }
+    for (size_t first_index = 0; first_index <= size; ++first_index) {
+      EXPECT_EQ(min_st.max_right(first_index, [](int m) { return m > 3; }),
+                size);
+      EXPECT_EQ(max_st.max_right(first_index, [](int m) { return m < 7; }),
+                size);
+      EXPECT_EQ(min_mapped.max_right(first_index, [](int m) { return m > 3; }),
+                size);
+    }
+    min_st.update(size / 2, 1);
+    max_st.update(size / 2, 9);
+    EXPECT_EQ(min_st.max_right(0, [](int m) { return m > 3; }), size / 2);
+    EXPECT_EQ(max_st.max_right(0, [](int m) { return m < 7; }), size / 2);
+  }
+}
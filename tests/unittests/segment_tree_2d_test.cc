@@ -0,0 +1,120 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "manavrion/segment_tree/functional.h"
+#include "manavrion/segment_tree/segment_tree_2d.h"
+
+using namespace manavrion::segment_tree;
+
+namespace {
+
+// Reduces the rectangle of the matrix, which is stored row by row.
+template <typename Reducer>
+int Reduce(const std::vector<int>& matrix, size_t cols, size_t first_row,
+           size_t last_row, size_t first_col, size_t last_col) {
+  Reducer reduce;
+  int result = details::empty_result<Reducer, int>();
+  for (size_t row = first_row; row < last_row; ++row) {
+    for (size_t col = first_col; col < last_col; ++col) {
+      result = reduce(result, matrix[row * cols + col]);
+    }
+  }
+  return result;
+}
+
+template <typename Reducer>
+void SegmentTree2dTest(size_t rows, size_t cols) {
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<> dist(-5, 5);
+
+  std::vector<int> matrix(rows * cols);
+  for (auto& a : matrix) {
+    a = dist(gen);
+  }
+  segment_tree_2d<int, Reducer> test(matrix.begin(), matrix.end(), cols);
+  ASSERT_EQ(test.rows(), cols == 0 ? 0 : rows);
+  ASSERT_EQ(test.cols(), cols);
+
+  auto make_all_query = [&]() {
+    for (size_t row = 0; row < test.rows(); ++row) {
+      for (size_t col = 0; col < cols; ++col) {
+        ASSERT_EQ(test(row, col), matrix[row * cols + col]);
+      }
+    }
+    for (size_t first_row = 0; first_row <= test.rows(); ++first_row) {
+      for (size_t last_row = first_row; last_row <= test.rows(); ++last_row) {
+        for (size_t first_col = 0; first_col <= cols; ++first_col) {
+          for (size_t last_col = first_col; last_col <= cols; ++last_col) {
+            ASSERT_EQ(test.query(first_row, last_row, first_col, last_col),
+                      Reduce<Reducer>(matrix, cols, first_row, last_row,
+                                      first_col, last_col));
+          }
+        }
+      }
+    }
+  };
+  make_all_query();
+
+  if (test.empty()) {
+    return;
+  }
+  for (size_t update_count = 0; update_count < 20; ++update_count) {
+    const size_t row = gen() % rows;
+    const size_t col = gen() % cols;
+    const int value = dist(gen);
+    test.update(row, col, value);
+    matrix[row * cols + col] = value;
+  }
+  make_all_query();
+}
+
+template <typename Reducer>
+void SegmentTree2dTest() {
+  for (size_t rows : {0, 1, 2, 3, 5, 8, 11}) {
+    for (size_t cols : {0, 1, 2, 4, 7, 9}) {
+      SegmentTree2dTest<Reducer>(rows, cols);
+    }
+  }
+}
+
+}  // namespace
+
+TEST(SegmentTree2dTest, Plus) { SegmentTree2dTest<std::plus<int>>(); }
+
+TEST(SegmentTree2dTest, Minimum) { SegmentTree2dTest<minimum<int>>(); }
+
+TEST(SegmentTree2dTest, Maximum) { SegmentTree2dTest<maximum<int>>(); }
+
+TEST(SegmentTree2dTest, Lite) {
+  segment_tree_2d<int> st = {{1, 2, 3}, {4, 5, 6}};
+  EXPECT_EQ(st.query(0, 2, 0, 3), 21);
+  EXPECT_EQ(st.query(1, 2, 1, 3), 11);
+  EXPECT_EQ(st.query(0, 2, 1, 2), 7);
+  EXPECT_EQ(st.query(0, 0, 0, 3), 0);
+  EXPECT_EQ(st.at(1, 2), 6);
+  EXPECT_THROW(static_cast<void>(st.at(2, 0)), std::out_of_range);
+  EXPECT_THROW(static_cast<void>(st.at(0, 3)), std::out_of_range);
+
+  segment_tree_2d<int> other(2, 3, 1);
+  EXPECT_EQ(other.query(0, 2, 0, 3), 6);
+  EXPECT_NE(st, other);
+  other.assign({{1, 2, 3}, {4, 5, 6}});
+  EXPECT_EQ(st, other);
+
+  st.update(0, 0, 10);
+  EXPECT_EQ(st.query(0, 1, 0, 3), 15);
+  EXPECT_EQ(st.query(0, 2, 0, 1), 14);
+  // 3 row nodes of 6 column nodes.
+  EXPECT_EQ(st.size(), 6u);
+  EXPECT_EQ(st.bytes_used(), 18 * sizeof(int));
+  st.clear();
+  EXPECT_TRUE(st.empty());
+}
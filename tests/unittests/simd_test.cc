@@ -0,0 +1,90 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <random>
+#include <type_traits>
+
+#include "manavrion/segment_tree/functional.h"
+#include "manavrion/segment_tree/mapped_segment_tree.h"
+#include "manavrion/segment_tree/naive_segment_tree.h"
+#include "manavrion/segment_tree/segment_tree.h"
+
+using namespace manavrion::segment_tree;
+
+namespace {
+
+// Checks trees, which are built with vectorized reducers, on sizes around
+// the vector widths.
+template <typename SegmentTree, typename T, typename Reducer>
+void SimdBuildTest() {
+  std::random_device rd;
+  std::mt19937 gen(rd());
+  // Products of signed values are kept in range by drawing them from {-1, 1},
+  // unsigned products wrap around.
+  constexpr bool signed_product =
+      std::is_same_v<Reducer, std::multiplies<T>> && std::is_signed_v<T>;
+  std::uniform_int_distribution<> dist(signed_product ? 0 : 1, 3);
+
+  for (size_t size = 0; size < 140; ++size) {
+    std::vector<T> as(size);
+    for (auto& a : as) {
+      const int value = dist(gen);
+      a = static_cast<T>(signed_product ? 2 * (value % 2) - 1 : value);
+    }
+    SegmentTree test(as.begin(), as.end());
+    naive_segment_tree<T, Reducer> canonical(as.begin(), as.end());
+
+    for (size_t first_index = 0; first_index <= size; ++first_index) {
+      for (size_t last_index = first_index; last_index <= size; ++last_index) {
+        EXPECT_EQ(test.query(first_index, last_index),
+                  canonical.query(first_index, last_index));
+      }
+    }
+  }
+}
+
+template <typename T, typename Reducer>
+void SimdBuildTest() {
+  SimdBuildTest<segment_tree<T, Reducer>, T, Reducer>();
+  SimdBuildTest<mapped_segment_tree<T, Reducer>, T, Reducer>();
+}
+
+}  // namespace
+
+TEST(SimdBuildTest, Int32) {
+  SimdBuildTest<int32_t, std::plus<int32_t>>();
+  SimdBuildTest<int32_t, std::multiplies<int32_t>>();
+  SimdBuildTest<int32_t, minimum<int32_t>>();
+  SimdBuildTest<int32_t, maximum<int32_t>>();
+}
+
+TEST(SimdBuildTest, UInt32) {
+  SimdBuildTest<uint32_t, std::plus<uint32_t>>();
+  SimdBuildTest<uint32_t, std::multiplies<uint32_t>>();
+  SimdBuildTest<uint32_t, minimum<uint32_t>>();
+  SimdBuildTest<uint32_t, maximum<uint32_t>>();
+}
+
+TEST(SimdBuildTest, Int64) {
+  SimdBuildTest<int64_t, std::plus<int64_t>>();
+  SimdBuildTest<int64_t, minimum<int64_t>>();
+}
+
+TEST(SimdBuildTest, Float) {
+  SimdBuildTest<float, std::plus<float>>();
+  SimdBuildTest<float, std::multiplies<float>>();
+  SimdBuildTest<float, minimum<float>>();
+  SimdBuildTest<float, maximum<float>>();
+}
+
+TEST(SimdBuildTest, Double) {
+  SimdBuildTest<double, std::plus<double>>();
+  SimdBuildTest<double, std::multiplies<double>>();
+  SimdBuildTest<double, minimum<double>>();
+  SimdBuildTest<double, maximum<double>>();
+}
@@ -7,9 +7,11 @@
 
 #include <array>
 
+#include "manavrion/segment_tree/compact_segment_tree.h"
 #include "manavrion/segment_tree/mapped_segment_tree.h"
 #include "manavrion/segment_tree/naive_segment_tree.h"
 #include "manavrion/segment_tree/segment_tree.h"
+#include "manavrion/segment_tree/wide_segment_tree.h"
 
 using namespace manavrion::segment_tree;
 
@@ -45,6 +47,10 @@ void SimpleFunctorTest() {
 
 }  // namespace
 
+TEST(SimpleFunctorTest, CompactSegmentTree) {
+  SimpleFunctorTest<compact_segment_tree<int, min_test_reducer>>();
+}
+
 TEST(SimpleFunctorTest, MappedSegmentTree) {
   SimpleFunctorTest<mapped_segment_tree<int, min_test_reducer>>();
 }
@@ -56,3 +62,9 @@ TEST(SimpleFunctorTest, NaiveSegmentTree) {
 TEST(SimpleFunctorTest, SimpleSegmentTree) {
   SimpleFunctorTest<segment_tree<int, min_test_reducer>>();
 }
+
+TEST(SimpleFunctorTest, WideSegmentTree) {
+  SimpleFunctorTest<wide_segment_tree<int, min_test_reducer>>();
+  SimpleFunctorTest<wide_segment_tree<int, min_test_reducer, 4>>();
+  SimpleFunctorTest<wide_segment_tree<int, minimum<int>>>();
+}
@@ -0,0 +1,163 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "manavrion/segment_tree/naive_segment_tree.h"
+#include "manavrion/segment_tree/sparse_table.h"
+
+using namespace manavrion::segment_tree;
+
+static_assert(monoid_traits<minimum<int>, int>::is_idempotent);
+static_assert(monoid_traits<std::bit_or<>, unsigned>::is_idempotent);
+static_assert(monoid_traits<gcd<unsigned>, unsigned>::is_idempotent);
+static_assert(!monoid_traits<std::plus<int>, int>::is_idempotent);
+static_assert(!monoid_traits<gcd<int>, int>::is_idempotent);
+
+namespace {
+
+struct min_sum {
+  int min;
+  long long sum;
+};
+
+struct min_sum_mapper {
+  min_sum operator()(int value) const { return min_sum{value, value}; }
+};
+
+struct min_sum_reducer {
+  min_sum operator()(const min_sum& lhs, const min_sum& rhs) const {
+    return min_sum{std::min(lhs.min, rhs.min), lhs.sum + rhs.sum};
+  }
+};
+
+// The value closest to zero, the smaller one of a tie. It is declared
+// idempotent by a specialization of monoid_traits.
+struct closest_to_zero {
+  int operator()(int lhs, int rhs) const {
+    const int lhs_abs = lhs < 0 ? -lhs : lhs;
+    const int rhs_abs = rhs < 0 ? -rhs : rhs;
+    if (lhs_abs != rhs_abs) {
+      return lhs_abs < rhs_abs ? lhs : rhs;
+    }
+    return std::min(lhs, rhs);
+  }
+};
+
+}  // namespace
+
+namespace manavrion::segment_tree {
+
+template <>
+struct monoid_traits<closest_to_zero, int> {
+  static constexpr bool has_identity = false;
+  static constexpr bool is_commutative = true;
+  static constexpr bool is_idempotent = true;
+  static constexpr bool is_invertible = false;
+};
+
+}  // namespace manavrion::segment_tree
+
+namespace {
+
+// Compares every query with naive_segment_tree for sizes up to 70.
+template <typename Table, typename T, typename Reducer>
+void SparseTableTestImpl() {
+  std::mt19937 gen(42);
+  for (size_t size = 0; size < 70; ++size) {
+    std::vector<T> as(size);
+    for (auto& a : as) {
+      if constexpr (std::is_same_v<T, std::string>) {
+        a = std::string(1, static_cast<char>('a' + gen() % 26));
+      } else if constexpr (std::is_signed_v<T>) {
+        a = static_cast<T>(static_cast<int>(gen() % 1000) - 500);
+      } else {
+        a = static_cast<T>(gen() % 1000);
+      }
+    }
+    const Table test(as.begin(), as.end());
+    const naive_segment_tree<T, Reducer> canonical(as.begin(), as.end());
+    ASSERT_EQ(test.size(), size);
+    for (size_t first_index = 0; first_index <= size; ++first_index) {
+      for (size_t last_index = first_index; last_index <= size;
+           ++last_index) {
+        ASSERT_EQ(test.query(first_index, last_index),
+                  canonical.query(first_index, last_index));
+      }
+    }
+  }
+}
+
+template <typename T, typename Reducer>
+void SparseTableTest() {
+  SparseTableTestImpl<sparse_table<T, Reducer>, T, Reducer>();
+}
+
+template <typename T, typename Reducer>
+void DisjointSparseTableTest() {
+  SparseTableTestImpl<disjoint_sparse_table<T, Reducer>, T, Reducer>();
+}
+
+}  // namespace
+
+TEST(SparseTableTest, Idempotent) {
+  SparseTableTest<int, minimum<int>>();
+  SparseTableTest<int, maximum<int>>();
+  SparseTableTest<long long, minimum<long long>>();
+  SparseTableTest<double, maximum<double>>();
+  SparseTableTest<unsigned, gcd<unsigned>>();
+  SparseTableTest<unsigned, std::bit_or<unsigned>>();
+  SparseTableTest<unsigned, std::bit_and<>>();
+  SparseTableTest<int, closest_to_zero>();
+}
+
+TEST(SparseTableTest, Elements) {
+  sparse_table<int> st = {5, 3, 8, 1};
+  EXPECT_EQ(std::vector<int>(st.begin(), st.end()),
+            std::vector<int>({5, 3, 8, 1}));
+  EXPECT_EQ(st.at(2), 8);
+  EXPECT_THROW(static_cast<void>(st.at(4)), std::out_of_range);
+  EXPECT_EQ(st.query(0, 3), 3);
+  EXPECT_EQ(st.bytes_used(), 3 * 4 * sizeof(int));
+  st.assign(6, 7);
+  EXPECT_EQ(st.query(1, 6), 7);
+  st.clear();
+  EXPECT_TRUE(st.empty());
+}
+
+TEST(SparseTableTest, Disjoint) {
+  DisjointSparseTableTest<int, std::plus<int>>();
+  DisjointSparseTableTest<int, minimum<int>>();
+  DisjointSparseTableTest<unsigned, std::bit_xor<unsigned>>();
+  DisjointSparseTableTest<std::string, std::plus<std::string>>();
+}
+
+TEST(SparseTableTest, DisjointMapped) {
+  std::mt19937 gen(42);
+  std::vector<int> as(100);
+  for (auto& a : as) {
+    a = static_cast<int>(gen() % 1000) - 500;
+  }
+  const disjoint_sparse_table<int, min_sum_reducer, min_sum_mapper> test(
+      as.begin(), as.end());
+  for (size_t first_index = 0; first_index < as.size(); ++first_index) {
+    int min = as[first_index];
+    long long sum = 0;
+    for (size_t last_index = first_index + 1; last_index <= as.size();
+         ++last_index) {
+      min = std::min(min, as[last_index - 1]);
+      sum += as[last_index - 1];
+      const min_sum result = test.query(first_index, last_index);
+      ASSERT_EQ(result.min, min);
+      ASSERT_EQ(result.sum, sum);
+    }
+  }
+}
@@ -0,0 +1,186 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "manavrion/segment_tree/layout.h"
+#include "manavrion/segment_tree/mapped_segment_tree.h"
+#include "manavrion/segment_tree/storage.h"
+
+using namespace manavrion::segment_tree;
+
+namespace {
+
+struct stats {
+  int sum;
+  int min;
+  int max;
+};
+
+bool operator==(const stats& lhs, const stats& rhs) {
+  return lhs.sum == rhs.sum && lhs.min == rhs.min && lhs.max == rhs.max;
+}
+
+struct stats_reducer {
+  stats operator()(const stats& lhs, const stats& rhs) const {
+    return stats{lhs.sum + rhs.sum, std::min(lhs.min, rhs.min),
+                 std::max(lhs.max, rhs.max)};
+  }
+};
+
+struct stats_mapper {
+  stats operator()(int arg) const { return stats{arg, arg, arg}; }
+};
+
+using sum_count = std::pair<int, long>;
+
+struct sum_count_reducer {
+  sum_count operator()(const sum_count& lhs, const sum_count& rhs) const {
+    return {lhs.first + rhs.first, lhs.second + rhs.second};
+  }
+};
+
+struct sum_count_mapper {
+  sum_count operator()(int arg) const { return {arg, 1}; }
+};
+
+}  // namespace
+
+template <>
+struct manavrion::segment_tree::soa_fields<stats> {
+  static constexpr auto members =
+      std::make_tuple(&stats::sum, &stats::min, &stats::max);
+};
+
+namespace {
+
+template <typename Reducer, typename Mapper, typename Layout>
+using soa_tree =
+    mapped_segment_tree<int, Reducer, Mapper, std::allocator<int>,
+                        std::allocator<std::invoke_result_t<Mapper, int>>,
+                        Layout, soa_storage>;
+
+// SoA and AoS trees must give the same results after every operation.
+template <typename Reducer, typename Mapper, typename Layout = heap_layout>
+void StorageTest() {
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<> dist(-5, 5);
+
+  using aos_tree = mapped_segment_tree<
+      int, Reducer, Mapper, std::allocator<int>,
+      std::allocator<std::invoke_result_t<Mapper, int>>, Layout>;
+
+  for (size_t size = 0; size < 70; ++size) {
+    std::vector<int> as(size);
+    for (auto& a : as) {
+      a = dist(gen);
+    }
+    soa_tree<Reducer, Mapper, Layout> test(as.begin(), as.end());
+    aos_tree canonical(as.begin(), as.end());
+
+    auto make_all_query = [&]() {
+      ASSERT_TRUE(std::equal(test.begin(), test.end(), canonical.begin(),
+                             canonical.end()));
+      std::vector<std::pair<size_t, size_t>> queries;
+      for (size_t first_index = 0; first_index <= test.size(); ++first_index) {
+        for (size_t last_index = first_index; last_index <= test.size();
+             ++last_index) {
+          ASSERT_EQ(test.query(first_index, last_index),
+                    canonical.query(first_index, last_index));
+          queries.emplace_back(first_index, last_index);
+        }
+      }
+      std::vector<typename aos_tree::tree_value_type> results(queries.size());
+      test.query_batch(queries.begin(), queries.end(), results.begin());
+      for (size_t i = 0; i < queries.size(); ++i) {
+        const auto [first_index, last_index] = queries[i];
+        ASSERT_EQ(results[i], canonical.query(first_index, last_index));
+      }
+    };
+    make_all_query();
+
+    if (size != 0) {
+      for (size_t update_count = 0; update_count < 20; ++update_count) {
+        const size_t index = gen() % size;
+        const int value = dist(gen);
+        test.update(index, value);
+        canonical.update(index, value);
+      }
+      make_all_query();
+    }
+
+    // The nodes move between the levels when the tree grows and shrinks.
+    for (size_t i = 0; i < size + 1; ++i) {
+      const int value = dist(gen);
+      test.push_back(value);
+      canonical.push_back(value);
+    }
+    make_all_query();
+    for (size_t i = 0; i < size + 1; ++i) {
+      test.pop_back();
+      canonical.pop_back();
+    }
+    make_all_query();
+
+    test.assign(size, 3);
+    canonical.assign(size, 3);
+    make_all_query();
+  }
+}
+
+}  // namespace
+
+TEST(StorageTest, Fields) { StorageTest<stats_reducer, stats_mapper>(); }
+
+TEST(StorageTest, TupleLike) {
+  StorageTest<sum_count_reducer, sum_count_mapper>();
+}
+
+TEST(StorageTest, VebLayout) {
+  StorageTest<stats_reducer, stats_mapper, veb_layout>();
+}
+
+TEST(StorageTest, MoveAndCopy) {
+  using tree = soa_tree<stats_reducer, stats_mapper, heap_layout>;
+  tree st = {1, 2, 3, 4, 5};
+  tree copy = st;
+  tree moved = std::move(st);
+  EXPECT_EQ(copy.query(1, 4), (stats{9, 2, 4}));
+  EXPECT_EQ(moved.query(0, 5), (stats{15, 1, 5}));
+  moved.swap(copy);
+  moved.update(0, 10);
+  EXPECT_EQ(moved.query(0, 2), (stats{12, 2, 10}));
+  EXPECT_EQ(copy.query(0, 2), (stats{3, 1, 2}));
+}
+
+TEST(StorageTest, ElementsAreNodes) {
+  // The parents of the elements are reduced from the elements directly.
+  using tree = mapped_segment_tree<
+      sum_count, sum_count_reducer,
+      details::deduce_mapper<sum_count, sum_count_reducer>,
+      std::allocator<sum_count>, std::allocator<sum_count>, heap_layout,
+      soa_storage>;
+  std::vector<sum_count> as;
+  for (int i = 0; i < 37; ++i) {
+    as.emplace_back(i, 1);
+  }
+  tree st(as.begin(), as.end());
+  for (size_t first_index = 0; first_index <= as.size(); ++first_index) {
+    for (size_t last_index = first_index; last_index <= as.size();
+         ++last_index) {
+      const int first = static_cast<int>(first_index);
+      const int last = static_cast<int>(last_index);
+      ASSERT_EQ(st.query(first_index, last_index),
+                sum_count((first + last - 1) * (last - first) / 2,
+                          last - first));
+    }
+  }
+}
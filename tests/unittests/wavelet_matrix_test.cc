@@ -0,0 +1,97 @@
+//
+// Copyright (C) 2020 Ruslan Manaev (manavrion@gmail.com)
+// This file is part of the segment_tree header-only library.
+//
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "manavrion/segment_tree/wavelet_matrix.h"
+
+using namespace manavrion::segment_tree;
+
+namespace {
+
+template <typename Compare>
+void WaveletMatrixTest(int max_value) {
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<> dist(-max_value, max_value);
+  Compare less;
+
+  for (size_t size = 0; size < 70; ++size) {
+    std::vector<int> as(size);
+    for (auto& a : as) {
+      a = dist(gen);
+    }
+    wavelet_matrix<int, Compare> test(as.begin(), as.end());
+    ASSERT_EQ(test.size(), size);
+    for (size_t i = 0; i < size; ++i) {
+      ASSERT_EQ(test[i], as[i]);
+    }
+
+    for (size_t first_index = 0; first_index <= size; ++first_index) {
+      for (size_t last_index = first_index; last_index <= size; ++last_index) {
+        std::vector<int> sorted(as.begin() + first_index,
+                                as.begin() + last_index);
+        std::sort(sorted.begin(), sorted.end(), less);
+        for (size_t k = 0; k < sorted.size(); ++k) {
+          ASSERT_EQ(test.kth_smallest(first_index, last_index, k), sorted[k]);
+        }
+        for (int value = -max_value - 1; value <= max_value + 1;
+             value += std::max(1, max_value / 8)) {
+          const size_t expected =
+              std::lower_bound(sorted.begin(), sorted.end(), value, less) -
+              sorted.begin();
+          ASSERT_EQ(test.count_less(first_index, last_index, value),
+                    expected);
+        }
+        const int lower = dist(gen);
+        const int upper = dist(gen);
+        const size_t expected = std::count_if(
+            sorted.begin(), sorted.end(), [&](int a) {
+              return !less(a, lower) && less(a, upper);
+            });
+        ASSERT_EQ(test.range_freq(first_index, last_index, lower, upper),
+                  expected);
+      }
+    }
+  }
+}
+
+}  // namespace
+
+TEST(WaveletMatrixTest, Less) {
+  WaveletMatrixTest<std::less<int>>(0);
+  WaveletMatrixTest<std::less<int>>(1);
+  WaveletMatrixTest<std::less<int>>(5);
+  WaveletMatrixTest<std::less<int>>(1000);
+}
+
+TEST(WaveletMatrixTest, Greater) {
+  WaveletMatrixTest<std::greater<int>>(5);
+}
+
+TEST(WaveletMatrixTest, Lite) {
+  wavelet_matrix<int> wm = {5, 1, 4, 1, 5, 9, 2, 6};
+  EXPECT_EQ(wm.kth_smallest(0, 8, 0), 1);
+  EXPECT_EQ(wm.kth_smallest(0, 8, 7), 9);
+  EXPECT_EQ(wm.kth_smallest(2, 6, 1), 4);
+  EXPECT_EQ(wm.count_less(0, 8, 5), 4u);
+  EXPECT_EQ(wm.count_less(4, 8, 100), 4u);
+  EXPECT_EQ(wm.range_freq(0, 8, 2, 6), 4u);
+  EXPECT_EQ(wm.range_freq(0, 8, 6, 2), 0u);
+  EXPECT_EQ(wm.at(5), 9);
+  EXPECT_THROW(static_cast<void>(wm.at(8)), std::out_of_range);
+
+  wavelet_matrix<int> other = {5, 1, 4, 1, 5, 9, 2, 6};
+  EXPECT_EQ(wm, other);
+  other.assign({1, 2});
+  EXPECT_NE(wm, other);
+  other.clear();
+  EXPECT_TRUE(other.empty());
+}
@@ -0,0 +1,9 @@
+list(APPEND CMAKE_MODULE_PATH "${CMAKE_CURRENT_SOURCE_DIR}/toolchain")
+include(default_toolchain)
+
+# Compiler
+set(CMAKE_C_COMPILER clang-9)
+set(CMAKE_CXX_COMPILER clang++-9)
+
+# Enables AVX2 kernels of build_tree, wide_segment_tree and sparse_table
+set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -mavx2 -mfma")
@@ -10,6 +10,9 @@ set(CMAKE_CXX_EXTENSIONS OFF)
 set(CMAKE_C_COMPILER clang-9)
 set(CMAKE_CXX_COMPILER clang++-9)
 
+# Enables AVX2 kernels of build_tree
+set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -march=native")
+
 # Options
 set(SEGMENT_TREE_BENCHMARKS
     ON